@@ -0,0 +1,126 @@
+#include "Autotuner.h"
+
+#include <chrono>
+
+void Autotuner::Run(Physics* physics, std::vector<PhysObject> objects, float startTimestep, float totalTime)
+{
+	candidates = {};
+	found = false;
+	candidatesDone = 0;
+	finished = false;
+
+	Physics::ConvertObjectsToBaseUnits(&objects);
+	float pilotTime = std::min(totalTime, pilotSteps * startTimestep);
+	int algorithmCount = sizeof(physics->algorithms) / sizeof(physics->algorithms[0]);
+	candidateCount = algorithmCount * (2 * ladderSize + 1);
+
+	//a separate Physics, so the pilots can switch algorithms without touching the one the UI is using
+	Physics pilot;
+	pilot.deterministic = physics->deterministic;
+	pilot.threadCount = physics->threadCount;
+
+	//end state of each algorithm's first pilot. Algorithms that aren't implemented yet fall back to another one,
+	//and there's no point timing the same integrator twice
+	std::vector<std::vector<PhysObject>> firstEnds = {};
+
+	for (int algorithm = 0; algorithm < algorithmCount && !cancel; algorithm++) {
+		pilot.selectedAlgorithm = algorithm;
+		bool first = true;
+
+		for (int rung = ladderSize; rung >= -ladderSize && !cancel; rung--, candidatesDone++) {
+			float dt = startTimestep * powf(2.0f, rung);
+			//too few steps to say anything about the error
+			if (pilotTime / dt < 10.0f)
+				continue;
+
+			std::vector<PhysObject> end;
+			AutotuneCandidate candidate = Pilot(&pilot, objects, dt, pilotTime, totalTime, &end);
+			if (cancel)
+				break;
+
+			if (first) {
+				first = false;
+				bool duplicate = false;
+				for (int i = 0; i < firstEnds.size() && !duplicate; i++) {
+					duplicate = true;
+					for (int j = 0; j < end.size() && duplicate; j++)
+						duplicate = std::equal(end[j].position.value, end[j].position.value + 3, firstEnds[i][j].position.value) &&
+							std::equal(end[j].velocity.value, end[j].velocity.value + 3, firstEnds[i][j].velocity.value);
+				}
+				firstEnds.push_back(end);
+				if (duplicate) {
+					candidatesDone += rung + ladderSize + 1;
+					break;
+				}
+			}
+
+			candidates.push_back(candidate);
+			//smaller steps only cost more from here
+			if (candidate.meetsTarget) {
+				candidatesDone += rung + ladderSize + 1;
+				break;
+			}
+		}
+	}
+
+	for (int i = 0; i < candidates.size(); i++) {
+		if (candidates[i].meetsTarget && (!found || candidates[i].predictedSeconds < best.predictedSeconds)) {
+			best = candidates[i];
+			found = true;
+		}
+	}
+	for (int i = 0; i < candidates.size() && !found; i++) {
+		if (i == 0 || candidates[i].predictedError < best.predictedError)
+			best = candidates[i];
+	}
+
+	candidatesDone = candidateCount.load();
+	finished = true;
+}
+
+//integrates objects (in base units) for pilotTime, tracking the relative drift of the energy and angular momentum.
+//The drift of a symplectic integrator like velocity verlet stays bounded, while others grow steadily, so the growth between
+//the first half and the whole pilot decides how the error is extrapolated to totalTime
+AutotuneCandidate Autotuner::Pilot(Physics* pilot, std::vector<PhysObject> objects, float dt, float pilotTime, float totalTime, std::vector<PhysObject>* end)
+{
+	AutotuneCandidate candidate;
+	candidate.algorithm = pilot->selectedAlgorithm;
+	candidate.timestep = dt;
+
+	double startEnergy = pilot->GetEnergy(objects);
+	double startMomentum[3];
+	Physics::GetAngularMomentum(objects, startMomentum);
+	double startMomentumMagnitude = sqrt(startMomentum[0] * startMomentum[0] + startMomentum[1] * startMomentum[1] + startMomentum[2] * startMomentum[2]);
+
+	int steps = round(pilotTime / dt);
+	double halfError = 0.0;
+	double energyError = 0.0, momentumError = 0.0;
+	double seconds = 0.0;
+	for (int step = 1; step <= steps && !cancel; step++) {
+		double potentialEnergy;
+		auto start = std::chrono::high_resolution_clock::now();
+		pilot->Advance(dt, &objects, &potentialEnergy);
+		seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		double momentum[3];
+		Physics::GetAngularMomentum(objects, momentum);
+		double difference[3] = { momentum[0] - startMomentum[0], momentum[1] - startMomentum[1], momentum[2] - startMomentum[2] };
+		energyError = std::max(energyError, fabs((Physics::GetKineticEnergy(objects) + potentialEnergy) / startEnergy - 1.0));
+		momentumError = std::max(momentumError, sqrt(difference[0] * difference[0] + difference[1] * difference[1] + difference[2] * difference[2]) / startMomentumMagnitude);
+
+		if (step == steps / 2)
+			halfError = std::max(energyError, momentumError);
+	}
+
+	double error = std::max(energyError, momentumError);
+	double growth = halfError > 0.0 ? std::max(0.0, std::min(1.0, log2(error / halfError))) : 1.0;
+
+	candidate.energyError = energyError;
+	candidate.angularMomentumError = momentumError;
+	candidate.predictedError = error * pow(std::max(1.0, (double)totalTime / pilotTime), growth);
+	candidate.predictedSeconds = seconds / std::max(steps, 1) * totalTime / dt;
+	candidate.meetsTarget = candidate.predictedError <= targetError;
+
+	*end = objects;
+	return candidate;
+}
@@ -0,0 +1,58 @@
+#ifndef AUTOTUNER_H
+#define AUTOTUNER_H
+
+#pragma once
+#include "Physics.h"
+
+#include <atomic>
+#include <vector>
+
+//one pilot integration, and what it predicts for a full run
+struct AutotuneCandidate
+{
+	int algorithm = VELOCITY_VERLET;
+	//base units (years)
+	float timestep = 0.0f;
+	//largest relative drift of the total energy and angular momentum during the pilot
+	float energyError = 0.0f;
+	float angularMomentumError = 0.0f;
+	//the worse of the two, extrapolated to the full run
+	float predictedError = 0.0f;
+	float predictedSeconds = 0.0f;
+	bool meetsTarget = false;
+};
+
+//Picks the algorithm and timestep for a run. Every algorithm gets short pilot integrations at a ladder of timesteps, from the largest down,
+//until one keeps energy and angular momentum within targetError over the whole run. The cheapest of those wins.
+class Autotuner
+{
+public:
+	Autotuner() {};
+	~Autotuner() {};
+
+	//timesteps are tried from startTimestep * 2^ladderSize down to startTimestep / 2^ladderSize. Times in base units
+	void Run(Physics* physics, std::vector<PhysObject> objects, float startTimestep, float totalTime);
+
+	//relative error allowed at the end of totalTime. Errors much below 1e-7 are lost in float roundoff
+	float targetError = 0.00001f;
+	//length of the pilot runs, in steps of startTimestep
+	int pilotSteps = 500;
+	int ladderSize = 4;
+
+	//every pilot that was run, in order
+	std::vector<AutotuneCandidate> candidates;
+	//the cheapest candidate that meets the target, or the most accurate one if none do
+	AutotuneCandidate best;
+	bool found = false;
+
+	//progress, readable from other threads while Run is going
+	std::atomic<int> candidatesDone = { 0 };
+	std::atomic<int> candidateCount = { 0 };
+	std::atomic<bool> finished = { false };
+	std::atomic<bool> cancel = { false };
+
+private:
+	AutotuneCandidate Pilot(Physics* pilot, std::vector<PhysObject> objects, float dt, float pilotTime, float totalTime, std::vector<PhysObject>* end);
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include "BatchIntegrator.h"
+
+BatchIntegrator::BatchIntegrator(float G, int objectCount) : objectCount(objectCount), G(G)
+{
+	positions.assign(3 * objectCount * BATCH_LANES, 0.0f);
+	velocities.assign(3 * objectCount * BATCH_LANES, 0.0f);
+	masses.assign(objectCount * BATCH_LANES, 0.0f);
+	accelerations.assign(3 * objectCount * BATCH_LANES, 0.0f);
+}
+
+void BatchIntegrator::SetLane(int lane, const std::vector<PhysObject>& objects)
+{
+	for (int i = 0; i < objectCount; i++) {
+		masses[i * BATCH_LANES + lane] = objects[i].mass.value;
+		for (int k = 0; k < 3; k++) {
+			positions[(3 * i + k) * BATCH_LANES + lane] = objects[i].position.value[k];
+			velocities[(3 * i + k) * BATCH_LANES + lane] = objects[i].velocity.value[k];
+		}
+	}
+}
+
+void BatchIntegrator::GetLane(int lane, std::vector<PhysObject>* objects)
+{
+	for (int i = 0; i < objectCount; i++) {
+		for (int k = 0; k < 3; k++) {
+			(*objects)[i].position.value[k] = positions[(3 * i + k) * BATCH_LANES + lane];
+			(*objects)[i].velocity.value[k] = velocities[(3 * i + k) * BATCH_LANES + lane];
+		}
+	}
+}
+
+//same steps as Physics::velocityVerlet. Every component of every lane is independent, so the kick and drift run over the whole arrays
+void BatchIntegrator::Step(float dt)
+{
+	UpdateAccelerations();
+	Physics::HalfKick(dt, accelerations.data(), velocities.data(), velocities.size());
+	Physics::Drift(dt, velocities.data(), positions.data(), positions.size());
+
+	UpdateAccelerations();
+	Physics::HalfKick(dt, accelerations.data(), velocities.data(), velocities.size());
+}
+
+//same pair loop and summation order as Physics::AccumulatePairs, with the innermost loop over lanes so it vectorizes
+void BatchIntegrator::UpdateAccelerations()
+{
+	std::fill(accelerations.begin(), accelerations.end(), 0.0f);
+
+	for (int i = 0; i < objectCount; i++) {
+		for (int j = i + 1; j < objectCount; j++) {
+			const float* positionI = &positions[3 * i * BATCH_LANES];
+			const float* positionJ = &positions[3 * j * BATCH_LANES];
+			const float* massI = &masses[i * BATCH_LANES];
+			const float* massJ = &masses[j * BATCH_LANES];
+			float* accelerationI = &accelerations[3 * i * BATCH_LANES];
+			float* accelerationJ = &accelerations[3 * j * BATCH_LANES];
+
+			for (int l = 0; l < BATCH_LANES; l++) {
+				float d[3] = {
+					positionI[l] - positionJ[l],
+					positionI[BATCH_LANES + l] - positionJ[BATCH_LANES + l],
+					positionI[2 * BATCH_LANES + l] - positionJ[2 * BATCH_LANES + l]
+				};
+
+				float r = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+				float scale = G / (r * r * r);
+				for (int k = 0; k < 3; k++) {
+					accelerationI[k * BATCH_LANES + l] += -massJ[l] * scale * d[k];
+					accelerationJ[k * BATCH_LANES + l] += massI[l] * scale * d[k];
+				}
+			}
+		}
+	}
+}
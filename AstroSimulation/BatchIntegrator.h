@@ -0,0 +1,42 @@
+#ifndef BATCHINTEGRATOR_H
+#define BATCHINTEGRATOR_H
+
+#pragma once
+#include "Physics.h"
+
+#include <vector>
+
+//number of systems advanced together. 16 floats fill an AVX-512 register, and two AVX2 / four SSE registers
+#define BATCH_LANES 16
+
+//velocity verlet for BATCH_LANES independent copies of the same small system, such as ensemble members.
+//Per-system vectorization doesn't get far with ~10 objects, so instead every lane holds the same object from a different system
+//and each loop runs across the lanes. Each lane gets the same result as Physics::Advance on a single system
+//with the fast reduction mode (apart from rotation, which isn't integrated).
+class BatchIntegrator
+{
+public:
+	BatchIntegrator(float G, int objectCount);
+	~BatchIntegrator() {};
+
+	//objects must be in base units
+	void SetLane(int lane, const std::vector<PhysObject>& objects);
+	//copies the lane's positions and velocities into objects, which must be the objects the lane was set from
+	void GetLane(int lane, std::vector<PhysObject>* objects);
+
+	void Step(float dt);
+
+	int objectCount;
+	//component k of object i in lane l is at [(3 * i + k) * BATCH_LANES + l], and the mass of object i at [i * BATCH_LANES + l]
+	std::vector<float> positions;
+	std::vector<float> velocities;
+	std::vector<float> masses;
+
+private:
+	void UpdateAccelerations();
+
+	float G;
+	std::vector<float> accelerations;
+};
+
+#endif
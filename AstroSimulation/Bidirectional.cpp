@@ -0,0 +1,39 @@
+#include "Bidirectional.h"
+
+std::vector<std::vector<PhysObject>> Bidirectional::Run(Physics* physics, std::vector<PhysObject> initialObjects, float dt, int backwardSteps, int forwardSteps)
+{
+	backwardDone = 0;
+	forwardDone = 0;
+	finished = false;
+
+	//Advance doesn't touch anything shared, so both halves can use the same Physics
+	std::vector<std::vector<PhysObject>> backwardFrames = {};
+	std::thread backwardThread([&]() {
+		Integrate(physics, initialObjects, -dt, backwardSteps, &backwardFrames, &backwardDone);
+	});
+
+	std::vector<std::vector<PhysObject>> forwardFrames = {};
+	Integrate(physics, initialObjects, dt, forwardSteps, &forwardFrames, &forwardDone);
+	backwardThread.join();
+
+	std::vector<std::vector<PhysObject>> frames = {};
+	if (!cancel) {
+		//the backward half comes out furthest from the epoch last, so it gets flipped
+		frames.assign(backwardFrames.rbegin(), backwardFrames.rend());
+		epochIndex = frames.size();
+		frames.push_back(initialObjects);
+		frames.insert(frames.end(), forwardFrames.begin(), forwardFrames.end());
+	}
+
+	finished = true;
+	return frames;
+}
+
+void Bidirectional::Integrate(Physics* physics, std::vector<PhysObject> objects, float dt, int steps, std::vector<std::vector<PhysObject>>* frames, std::atomic<int>* done)
+{
+	for (int i = 0; i < steps && !cancel; i++) {
+		physics->Advance(dt, &objects);
+		frames->push_back(objects);
+		(*done)++;
+	}
+}
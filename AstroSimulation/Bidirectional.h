@@ -0,0 +1,35 @@
+#ifndef BIDIRECTIONAL_H
+#define BIDIRECTIONAL_H
+
+#pragma once
+#include "Physics.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//Integrates backward (negative timestep) and forward from the same starting state at the same time, on two threads,
+//then stitches both halves into one timeline. The starting state ends up at epochIndex, with the history before it.
+class Bidirectional
+{
+public:
+	Bidirectional() {};
+	~Bidirectional() {};
+
+	//returns backwardSteps + forwardSteps + 1 frames in time order, or nothing if cancelled
+	std::vector<std::vector<PhysObject>> Run(Physics* physics, std::vector<PhysObject> initialObjects, float dt, int backwardSteps, int forwardSteps);
+
+	//index of initialObjects in the frames returned by Run
+	int epochIndex = 0;
+
+	//progress, readable from other threads while Run is going
+	std::atomic<int> backwardDone = { 0 };
+	std::atomic<int> forwardDone = { 0 };
+	std::atomic<bool> finished = { false };
+	std::atomic<bool> cancel = { false };
+
+private:
+	void Integrate(Physics* physics, std::vector<PhysObject> objects, float dt, int steps, std::vector<std::vector<PhysObject>>* frames, std::atomic<int>* done);
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include "ChebyshevChunk.h"
+
+#include <algorithm>
+#include <cfloat>
+
+void ChebyshevChunk::Fit(const std::vector<std::vector<PhysObject>>& frames, const std::vector<double>& times, double tolerance)
+{
+	objects = {};
+	firstFrame = frames.empty() ? std::vector<PhysObject>() : frames[0];
+	int m = frames.size();
+	if (m == 0)
+		return;
+
+	double maxStep = 0.0;
+	for (int f = 1; f < m; f++)
+		maxStep = std::max(maxStep, times[f] - times[f - 1]);
+
+	for (int o = 0; o < firstFrame.size(); o++) {
+		ObjectFit fit;
+
+		//6 values per frame: position then velocity, in base units
+		std::vector<double> values(6 * m);
+		double maxPosition = 0.0, maxVelocity = 0.0;
+		for (int f = 0; f < m; f++) {
+			ValueWithUnits3<UnitType::Distance> position = frames[f][o].position;
+			ValueWithUnits3<UnitType::Velocity> velocity = frames[f][o].velocity;
+			float basePosition[3], baseVelocity[3];
+			position.GetBaseValue(basePosition);
+			velocity.GetBaseValue(baseVelocity);
+			for (int k = 0; k < 3; k++) {
+				values[6 * f + k] = basePosition[k];
+				values[6 * f + k + 3] = baseVelocity[k];
+				maxPosition = std::max(maxPosition, (double)fabsf(basePosition[k]));
+				maxVelocity = std::max(maxVelocity, (double)fabsf(baseVelocity[k]));
+			}
+		}
+
+		//a velocity error of velocityTolerance moves the object by about positionTolerance over a step
+		double positionTolerance = std::max(tolerance, 4.0 * FLT_EPSILON * maxPosition);
+		double velocityTolerance = std::max(maxStep > 0.0 ? positionTolerance / maxStep : 0.0, 4.0 * FLT_EPSILON * maxVelocity);
+
+		if (m > 1)
+			fit.rotationRate = (frames[m - 1][o].rotationDegrees - frames[0][o].rotationDegrees) / (times[m - 1] - times[0]);
+
+		for (int segments = 1; fit.segments == 0 && m / segments >= CHEBYSHEV_MIN_FRAMES; segments *= 2) {
+			//at least two frames per coefficient, or it's not saving anything
+			for (int degree = 3; degree <= CHEBYSHEV_MAX_DEGREE && 2 * (degree + 1) <= m / segments; degree += 2) {
+				if (FitSegments(times, values, segments, degree, positionTolerance, velocityTolerance, &fit.coefficients)) {
+					fit.segments = segments;
+					fit.degree = degree;
+					break;
+				}
+			}
+		}
+
+		if (fit.segments == 0) {
+			fit.coefficients = {};
+			fit.raw.assign(values.begin(), values.end());
+		}
+		objects.push_back(fit);
+	}
+}
+
+void ChebyshevChunk::Evaluate(const std::vector<double>& times, std::vector<std::vector<PhysObject>>* frames) const
+{
+	frames->assign(times.size(), firstFrame);
+	for (int f = 0; f < times.size(); f++) {
+		for (int o = 0; o < objects.size(); o++)
+			EvaluateObject(times, f, o, &(*frames)[f][o]);
+	}
+}
+
+//only sets the position, velocity and rotation. The rest of object should already be a copy of firstFrame[index]
+void ChebyshevChunk::EvaluateObject(const std::vector<double>& times, int frame, int index, PhysObject* object) const
+{
+	const ObjectFit& fit = objects[index];
+	int m = times.size();
+
+	double values[6];
+	if (fit.segments == 0) {
+		for (int c = 0; c < 6; c++)
+			values[c] = fit.raw[6 * frame + c];
+	}
+	else {
+		int segment = std::min(frame * fit.segments / m, fit.segments - 1);
+		while (segment > 0 && segment * m / fit.segments > frame)
+			segment--;
+		int first = segment * m / fit.segments;
+		int last = (segment + 1) * m / fit.segments - 1;
+		double x = 2.0 * (times[frame] - times[first]) / (times[last] - times[first]) - 1.0;
+
+		int stride = fit.degree + 1;
+		const double* coefficients = &fit.coefficients[segment * 6 * stride];
+		for (int c = 0; c < 6; c++)
+			values[c] = Clenshaw(coefficients + c * stride, fit.degree, x);
+	}
+
+	//the values are in base units, and go back into the units of the first frame
+	ValueWithUnits3<UnitType::Distance> positionUnits = firstFrame[index].position;
+	ValueWithUnits3<UnitType::Velocity> velocityUnits = firstFrame[index].velocity;
+	float positionScale[3], velocityScale[3];
+	for (int k = 0; k < 3; k++) {
+		positionUnits.value[k] = 1.0f;
+		velocityUnits.value[k] = 1.0f;
+	}
+	positionUnits.GetBaseValue(positionScale);
+	velocityUnits.GetBaseValue(velocityScale);
+
+	for (int k = 0; k < 3; k++) {
+		object->position.value[k] = (float)(values[k] / positionScale[k]);
+		object->velocity.value[k] = (float)(values[k + 3] / velocityScale[k]);
+	}
+	object->rotationDegrees = firstFrame[index].rotationDegrees + fit.rotationRate * (float)(times[frame] - times[0]);
+}
+
+size_t ChebyshevChunk::Bytes() const
+{
+	size_t bytes = sizeof(ChebyshevChunk) + firstFrame.size() * sizeof(PhysObject);
+	for (int o = 0; o < objects.size(); o++)
+		bytes += sizeof(ObjectFit) + objects[o].coefficients.size() * sizeof(double) + objects[o].raw.size() * sizeof(float);
+	return bytes;
+}
+
+//least squares fit of every segment, through the normal equations. Chebyshev polynomials are close enough to orthogonal
+//on the frames for that to be well conditioned at these degrees. Returns false if any value is off by more than its tolerance
+bool ChebyshevChunk::FitSegments(const std::vector<double>& times, const std::vector<double>& values, int segments, int degree,
+	double positionTolerance, double velocityTolerance, std::vector<double>* coefficients)
+{
+	int m = times.size();
+	int stride = degree + 1;
+	coefficients->assign(segments * 6 * stride, 0.0);
+
+	std::vector<double> basis, normal(stride * stride), right(6 * stride);
+	for (int segment = 0; segment < segments; segment++) {
+		int first = segment * m / segments;
+		int last = (segment + 1) * m / segments - 1;
+		int count = last - first + 1;
+		double span = times[last] - times[first];
+		if (span <= 0.0)
+			return false;
+
+		basis.assign(count * stride, 0.0);
+		for (int j = 0; j < count; j++) {
+			double x = 2.0 * (times[first + j] - times[first]) / span - 1.0;
+			double* row = &basis[j * stride];
+			row[0] = 1.0;
+			if (degree > 0)
+				row[1] = x;
+			for (int k = 2; k <= degree; k++)
+				row[k] = 2.0 * x * row[k - 1] - row[k - 2];
+		}
+
+		std::fill(normal.begin(), normal.end(), 0.0);
+		std::fill(right.begin(), right.end(), 0.0);
+		for (int j = 0; j < count; j++) {
+			const double* row = &basis[j * stride];
+			for (int a = 0; a < stride; a++) {
+				for (int b = 0; b <= a; b++)
+					normal[a * stride + b] += row[a] * row[b];
+				for (int c = 0; c < 6; c++)
+					right[c * stride + a] += row[a] * values[6 * (first + j) + c];
+			}
+		}
+
+		//cholesky, in place in the lower triangle
+		for (int a = 0; a < stride; a++) {
+			for (int b = 0; b <= a; b++) {
+				double sum = normal[a * stride + b];
+				for (int k = 0; k < b; k++)
+					sum -= normal[a * stride + k] * normal[b * stride + k];
+				if (a == b) {
+					if (sum <= 0.0)
+						return false;
+					normal[a * stride + a] = sqrt(sum);
+				}
+				else
+					normal[a * stride + b] = sum / normal[b * stride + b];
+			}
+		}
+
+		double* result = &(*coefficients)[segment * 6 * stride];
+		for (int c = 0; c < 6; c++) {
+			double* y = result + c * stride;
+			for (int a = 0; a < stride; a++) {
+				double sum = right[c * stride + a];
+				for (int k = 0; k < a; k++)
+					sum -= normal[a * stride + k] * y[k];
+				y[a] = sum / normal[a * stride + a];
+			}
+			for (int a = stride - 1; a >= 0; a--) {
+				double sum = y[a];
+				for (int k = a + 1; k < stride; k++)
+					sum -= normal[k * stride + a] * y[k];
+				y[a] = sum / normal[a * stride + a];
+			}
+		}
+
+		for (int j = 0; j < count; j++) {
+			const double* row = &basis[j * stride];
+			for (int c = 0; c < 6; c++) {
+				double value = 0.0;
+				for (int k = 0; k < stride; k++)
+					value += row[k] * result[c * stride + k];
+				if (fabs(value - values[6 * (first + j) + c]) > (c < 3 ? positionTolerance : velocityTolerance))
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+double ChebyshevChunk::Clenshaw(const double* coefficients, int degree, double x)
+{
+	double next = 0.0, nextNext = 0.0;
+	for (int k = degree; k >= 1; k--) {
+		double current = coefficients[k] + 2.0 * x * next - nextNext;
+		nextNext = next;
+		next = current;
+	}
+	return coefficients[0] + x * next - nextNext;
+}
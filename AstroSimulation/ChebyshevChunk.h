@@ -0,0 +1,54 @@
+#ifndef CHEBYSHEVCHUNK_H
+#define CHEBYSHEVCHUNK_H
+
+#pragma once
+#include "PhysObject.h"
+
+#include <vector>
+
+//highest degree of the series. Chunks are split into 1, 2, 4, ... segments until every one fits
+#define CHEBYSHEV_MAX_DEGREE 23
+//fewest frames per segment. Objects that don't fit with segments this short keep their frames as floats
+#define CHEBYSHEV_MIN_FRAMES 8
+
+//A chunk of frames stored as Chebyshev series in time instead of frames. Orbits are smooth, so a few coefficients per
+//object cover a long stretch of frames. Positions and velocities are fitted separately (least squares), each object with
+//the fewest fixed-length segments and lowest degree that stay within the tolerance at every frame.
+//Everything else comes from the first frame, except the rotation, which turns at a constant rate
+class ChebyshevChunk
+{
+public:
+	ChebyshevChunk() {};
+	~ChebyshevChunk() {};
+
+	//tolerance is in gigameters. Objects far from the origin can't do better than their float positions,
+	//so the tolerance of each object is never less than a few floating point steps
+	void Fit(const std::vector<std::vector<PhysObject>>& frames, const std::vector<double>& times, double tolerance);
+	//rebuilds the frames, in the units of the first frame
+	void Evaluate(const std::vector<double>& times, std::vector<std::vector<PhysObject>>* frames) const;
+	void EvaluateObject(const std::vector<double>& times, int frame, int index, PhysObject* object) const;
+	size_t Bytes() const;
+
+	//units, masses, names and so on. Changing units here changes them for every frame of the chunk
+	std::vector<PhysObject> firstFrame;
+
+private:
+	struct ObjectFit
+	{
+		//0 = couldn't be fitted, and the base positions and velocities are kept in raw instead
+		int segments = 0;
+		int degree = 0;
+		//segment by segment: x, y, z position series, then x, y, z velocity series, each degree + 1 long, in base units
+		std::vector<double> coefficients;
+		std::vector<float> raw;
+		float rotationRate = 0.0f;
+	};
+
+	static bool FitSegments(const std::vector<double>& times, const std::vector<double>& values, int segments, int degree,
+		double positionTolerance, double velocityTolerance, std::vector<double>* coefficients);
+	static double Clenshaw(const double* coefficients, int degree, double x);
+
+	std::vector<ObjectFit> objects;
+};
+
+#endif
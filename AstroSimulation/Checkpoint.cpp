@@ -0,0 +1,267 @@
+#include "Checkpoint.h"
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char checkpointMagic[8] = "ASTCKPT";
+
+//an index is only usable if it names one of the units, some of the tables are longer than their list of names
+template <size_t N> static bool ValidUnit(int32_t index, const char* const (&names)[N])
+{
+	return index >= 0 && index < (int32_t)N && names[index] != nullptr;
+}
+
+void Checkpoint::Start(std::string filename, const std::string& scenario)
+{
+	Stop();
+	this->filename = filename;
+	this->scenario = scenario;
+	hasPending = false;
+	stopping = false;
+	writtenFrame = -1;
+	failed = false;
+	writer = std::thread([this]() { WriterLoop(); });
+}
+
+void Checkpoint::Submit(const State& state)
+{
+	std::lock_guard<std::mutex> lock(pendingMutex);
+	pending = state;
+	hasPending = true;
+	pendingChanged.notify_one();
+}
+
+void Checkpoint::Stop()
+{
+	if (!writer.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		stopping = true;
+		pendingChanged.notify_one();
+	}
+	writer.join();
+}
+
+Checkpoint::State Checkpoint::Capture(Physics* physics)
+{
+	State state;
+	state.timestep = physics->timestep;
+	state.algorithm = physics->selectedAlgorithm;
+	state.deterministic = physics->deterministic;
+	state.threadCount = physics->threadCount > 0 ? physics->threadCount : ThreadPool::Shared().GetThreadCount();
+	state.conservationStart = physics->conservationStart;
+	return state;
+}
+
+Checkpoint::State Checkpoint::State::At(const std::vector<PhysObject>& objects, long long frame, double time) const
+{
+	State state;
+	state.frame = frame;
+	state.time = time;
+	state.timestep = timestep;
+	state.algorithm = algorithm;
+	state.deterministic = deterministic;
+	state.threadCount = threadCount;
+	state.conservationStart = conservationStart;
+	state.objects = objects;
+	return state;
+}
+
+void Checkpoint::State::ApplyTo(Physics* physics) const
+{
+	physics->timestep = timestep;
+	physics->selectedAlgorithm = algorithm;
+	physics->deterministic = deterministic;
+	physics->threadCount = threadCount;
+	physics->conservationStart = conservationStart;
+}
+
+//the state is taken out under the lock, and written without it, so Submit never waits for the disk
+void Checkpoint::WriterLoop()
+{
+	while (true) {
+		State state;
+		bool last;
+		{
+			std::unique_lock<std::mutex> lock(pendingMutex);
+			pendingChanged.wait(lock, [this]() { return hasPending || stopping; });
+			if (!hasPending)
+				return;
+			state = std::move(pending);
+			pending = State();
+			hasPending = false;
+			last = stopping;
+		}
+
+		if (Write(state))
+			writtenFrame = state.frame;
+		else
+			failed = true;
+		if (last)
+			return;
+	}
+}
+
+bool Checkpoint::Write(const State& state)
+{
+	Header header = {};
+	std::memcpy(header.magic, checkpointMagic, sizeof(header.magic));
+	header.version = CHECKPOINT_VERSION;
+	header.objectCount = state.objects.size();
+	header.scenarioBytes = scenario.size();
+	header.frame = state.frame;
+	header.time = state.time;
+	header.timestep = state.timestep.value;
+	header.timestepUnits = state.timestep.unitIndex;
+	header.algorithm = state.algorithm;
+	header.deterministic = state.deterministic;
+	header.threadCount = state.threadCount;
+	header.conservationEnergy = state.conservationStart.energy;
+	std::memcpy(header.conservationMomentum, state.conservationStart.momentum, sizeof(header.conservationMomentum));
+	header.conservationMomentumScale = state.conservationStart.momentumScale;
+	std::memcpy(header.conservationAngularMomentum, state.conservationStart.angularMomentum, sizeof(header.conservationAngularMomentum));
+
+	std::vector<ObjectRecord> records(state.objects.size());
+	for (int i = 0; i < state.objects.size(); i++) {
+		const PhysObject& object = state.objects[i];
+		ObjectRecord& record = records[i];
+		record = {};
+		record.mass = object.mass.value;
+		std::memcpy(record.position, object.position.value, sizeof(record.position));
+		std::memcpy(record.velocity, object.velocity.value, sizeof(record.velocity));
+		record.radius = object.radius.value;
+		record.axialTilt = object.axialTilt.value;
+		record.rotationPeriod = object.rotationPeriod.value;
+		record.rotationDegrees = object.rotationDegrees;
+		record.massUnits = object.mass.unitIndex;
+		record.positionUnits = object.position.unitIndex;
+		record.velocityUnits = object.velocity.unitIndex;
+		record.radiusUnits = object.radius.unitIndex;
+		record.axialTiltUnits = object.axialTilt.unitIndex;
+		record.rotationPeriodUnits = object.rotationPeriod.unitIndex;
+	}
+
+	std::string temporary = filename + ".tmp";
+	std::FILE* file = nullptr;
+#ifdef _WIN32
+	fopen_s(&file, temporary.c_str(), "wb");
+#else
+	file = std::fopen(temporary.c_str(), "wb");
+#endif
+	if (!file)
+		return false;
+
+	bool written = std::fwrite(&header, sizeof(Header), 1, file) == 1
+		&& std::fwrite(scenario.data(), 1, scenario.size(), file) == scenario.size()
+		&& (records.empty() || std::fwrite(records.data(), sizeof(ObjectRecord), records.size(), file) == records.size())
+		&& std::fflush(file) == 0;
+	//on disk before the rename, or a crash right after it could leave the new name with nothing in it
+#ifdef _WIN32
+	written = written && _commit(_fileno(file)) == 0;
+#else
+	written = written && fsync(fileno(file)) == 0;
+#endif
+	written = std::fclose(file) == 0 && written;
+	if (!written) {
+		std::remove(temporary.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	return MoveFileExA(temporary.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return std::rename(temporary.c_str(), filename.c_str()) == 0;
+#endif
+}
+
+//the counts in the header are checked against the size of the file before anything is allocated for them
+bool Checkpoint::Read(std::string filename, std::string* scenario, State* state)
+{
+	MappedFile file;
+	if (!file.Open(filename) || file.Size() < sizeof(Header))
+		return false;
+
+	Header header;
+	std::memcpy(&header, file.Data(), sizeof(Header));
+	uint64_t size = file.Size() - sizeof(Header);
+	if (std::memcmp(header.magic, checkpointMagic, sizeof(header.magic)) != 0 || header.version > CHECKPOINT_VERSION || header.objectCount == 0
+		|| header.scenarioBytes > size || (uint64_t)header.objectCount * sizeof(ObjectRecord) != size - header.scenarioBytes)
+		return false;
+
+	//the indices go straight into the conversion tables, so a damaged file must not get that far
+	UnitData units;
+	if (!ValidUnit(header.timestepUnits, units.timeUnits) || header.algorithm < VELOCITY_VERLET || header.algorithm > RK_ADAPTIVE_STEPSIZE
+		|| header.threadCount < 0)
+		return false;
+
+	scenario->assign(file.Data() + sizeof(Header), header.scenarioBytes);
+	std::vector<ObjectRecord> records(header.objectCount);
+	std::memcpy(records.data(), file.Data() + sizeof(Header) + header.scenarioBytes, records.size() * sizeof(ObjectRecord));
+	for (const ObjectRecord& record : records)
+		if (!ValidUnit(record.massUnits, units.massUnits) || !ValidUnit(record.positionUnits, units.positionUnits)
+			|| !ValidUnit(record.velocityUnits, units.velocityUnits) || !ValidUnit(record.radiusUnits, units.positionUnits)
+			|| !ValidUnit(record.axialTiltUnits, units.angleUnits) || !ValidUnit(record.rotationPeriodUnits, units.timeUnits))
+			return false;
+
+	state->frame = header.frame;
+	state->time = header.time;
+	state->timestep = ValueWithUnits<UnitType::Time>(header.timestep, header.timestepUnits);
+	state->algorithm = header.algorithm;
+	state->deterministic = header.deterministic != 0;
+	state->threadCount = header.threadCount;
+	state->conservationStart.energy = header.conservationEnergy;
+	std::memcpy(state->conservationStart.momentum, header.conservationMomentum, sizeof(header.conservationMomentum));
+	state->conservationStart.momentumScale = header.conservationMomentumScale;
+	std::memcpy(state->conservationStart.angularMomentum, header.conservationAngularMomentum, sizeof(header.conservationAngularMomentum));
+
+	//the rest of each object (name, satellites) is filled in from the scenario by Restore
+	state->objects.assign(records.size(), PhysObject());
+	for (int i = 0; i < records.size(); i++) {
+		const ObjectRecord& record = records[i];
+		PhysObject& object = state->objects[i];
+		object.mass = ValueWithUnits<UnitType::Mass>(record.mass, record.massUnits);
+		object.position = ValueWithUnits3<UnitType::Distance>((float*)record.position, record.positionUnits);
+		object.velocity = ValueWithUnits3<UnitType::Velocity>((float*)record.velocity, record.velocityUnits);
+		object.radius = ValueWithUnits<UnitType::Distance>(record.radius, record.radiusUnits);
+		object.axialTilt = ValueWithUnits<UnitType::Angle>(record.axialTilt, record.axialTiltUnits);
+		object.rotationPeriod = ValueWithUnits<UnitType::Time>(record.rotationPeriod, record.rotationPeriodUnits);
+		object.rotationDegrees = record.rotationDegrees;
+	}
+	return true;
+}
+
+bool Checkpoint::Restore(Physics* physics, std::string filename, std::vector<std::string> textureFolders, State* state)
+{
+	std::string scenario;
+	pugi::xml_document doc;
+	if (!Read(filename, &scenario, state) || !doc.load_buffer(scenario.data(), scenario.size())
+		|| doc.select_nodes("/SavedState/Physics/Objects/PhysObject").size() != state->objects.size())
+		return false;
+
+	Physics::FromXml(physics, doc, textureFolders);
+	std::vector<PhysObject> objects = physics->computedData[0];
+	for (int i = 0; i < objects.size(); i++) {
+		PhysObject& object = state->objects[i];
+		object.name = objects[i].name;
+		object.satellites = objects[i].satellites;
+	}
+
+	physics->computedData = FrameHistory({ state->objects }, state->time, 0.0);
+	physics->time = (float)state->time;
+	physics->epochTime = physics->time;
+	physics->epochIndex = 0;
+	physics->dataIndex = 0;
+	state->ApplyTo(physics);
+	physics->conservation = {};
+	return true;
+}
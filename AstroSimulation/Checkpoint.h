@@ -0,0 +1,125 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#pragma once
+#include "Physics.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//files newer than this can't be read
+#define CHECKPOINT_VERSION 1
+
+//Everything a streaming run needs to carry on exactly where it was, written every so often while it runs, so a crash or a closed
+//window only loses the frames since the last one. The objects are kept as the raw floats of the frame, in its own units
+//(a save file rounds them), along with the time, the frame number, the settings that change how a step rounds, and the totals
+//the conservation errors are measured against. Names, settings and so on come from the same xml a save file has.
+//The run only hands over a copy of its state, and a thread of its own does the writing, so the run never waits for the disk.
+//The file is written under another name first and then renamed over the last one, so there is always one whole checkpoint.
+//Only streaming runs have checkpoints. They are the ones with no end; the other long jobs (Compute, ensembles, stability maps)
+//have a fixed length, and the ui can start them over
+class Checkpoint
+{
+public:
+	struct State
+	{
+		//frame number since the run started, and its time in years
+		long long frame = 0;
+		double time = 0.0;
+		ValueWithUnits<UnitType::Time> timestep;
+		int algorithm = 0;
+		bool deterministic = false;
+		//threads the force calculation was split over. In fast mode the rounding depends on it, so a machine with another core count
+		//is given the same number instead of its own
+		int threadCount = 0;
+		ConservedTotals conservationStart;
+		std::vector<PhysObject> objects;
+
+		//a copy with the objects of a run at frame and time
+		State At(const std::vector<PhysObject>& objects, long long frame, double time) const;
+		//sets the step settings and conservation totals of physics to these
+		void ApplyTo(Physics* physics) const;
+	};
+
+	Checkpoint() {};
+	~Checkpoint() { Stop(); };
+
+	//starts the writer. scenario is the xml the run started from
+	void Start(std::string filename, const std::string& scenario);
+	//hands state to the writer, without waiting for it. If the last one hasn't been written yet, it is skipped for this one
+	void Submit(const State& state);
+	//writes the state still waiting, if there is one, and stops the writer
+	void Stop();
+	bool IsRunning() const { return writer.joinable(); }
+	//the step settings of physics, without any objects. Taken on the ui thread when a run starts, since the run's thread
+	//can't read physics while the ui may be changing it
+	static State Capture(Physics* physics);
+
+	//frame of the last checkpoint that made it to disk, readable from other threads. failed is set if one didn't
+	std::atomic<long long> writtenFrame = { -1 };
+	std::atomic<bool> failed = { false };
+
+	static bool Read(std::string filename, std::string* scenario, State* state);
+	//loads the scenario into physics, then puts back the exact objects, time and step settings of the checkpoint.
+	//computedData ends up with just the checkpoint's frame
+	static bool Restore(Physics* physics, std::string filename, std::vector<std::string> textureFolders, State* state);
+
+private:
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t objectCount;
+		uint64_t scenarioBytes;
+		int64_t frame;
+		double time;
+		float timestep;
+		int32_t timestepUnits;
+		int32_t algorithm;
+		int32_t deterministic;
+		int32_t threadCount;
+		//ConservedTotals, a field at a time, so a change to the struct can't change the file
+		double conservationEnergy;
+		double conservationMomentum[3];
+		double conservationMomentumScale;
+		double conservationAngularMomentum[3];
+	};
+
+	//one per object, after the scenario
+	struct ObjectRecord
+	{
+		float mass;
+		float position[3];
+		float velocity[3];
+		float radius;
+		float axialTilt;
+		float rotationPeriod;
+		float rotationDegrees;
+		int32_t massUnits;
+		int32_t positionUnits;
+		int32_t velocityUnits;
+		int32_t radiusUnits;
+		int32_t axialTiltUnits;
+		int32_t rotationPeriodUnits;
+	};
+
+	bool Write(const State& state);
+	void WriterLoop();
+
+	std::string filename;
+	std::string scenario;
+
+	std::thread writer;
+	std::mutex pendingMutex;
+	std::condition_variable pendingChanged;
+	State pending;
+	bool hasPending = false;
+	bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "Comparison.h"
+
+#include <chrono>
+
+void Comparison::Run(Physics* physics, std::vector<PhysObject> objects, float totalTime)
+{
+	finished = false;
+	Physics::ConvertObjectsToBaseUnits(&objects);
+
+	int configCount = configs.size();
+	frames = frameCount;
+	objectCount = objects.size();
+	series = std::vector<ComparisonSeries>(configCount);
+	framesDone = std::vector<std::atomic<int>>(configCount);
+	for (int c = 0; c < configCount; c++) {
+		series[c].positions.assign((frames + 1) * 3 * objects.size(), 0.0f);
+		series[c].energyErrors.assign(frames + 1, 0.0f);
+		series[c].seconds.assign(frames + 1, 0.0f);
+		series[c].divergences.assign(frames + 1, 0.0f);
+		framesDone[c] = 0;
+	}
+	started = true;
+
+	//every config gets its own thread. They all start from the same state
+	std::vector<std::thread> threads = {};
+	for (int c = 0; c < configCount; c++) {
+		float dt = configs[c].timestep.GetBaseValue();
+		threads.push_back(std::thread(&Comparison::RunConfig, this, c, objects, dt, totalTime, std::cref(*physics)));
+	}
+	for (int c = 0; c < configCount; c++)
+		threads[c].join();
+
+	finished = true;
+}
+
+//integrates with the config's own timestep. Frames usually fall between steps, so each one is recorded
+//by taking a short extra step on a copy, which leaves the run itself untouched
+void Comparison::RunConfig(int config, std::vector<PhysObject> objects, float dt, float totalTime, const Physics& settings)
+{
+	Physics physics;
+	physics.selectedAlgorithm = configs[config].algorithm;
+	physics.deterministic = settings.deterministic;
+	physics.threadCount = settings.threadCount;
+
+	ComparisonSeries& output = series[config];
+	int n = objects.size();
+	double startEnergy = physics.GetEnergy(objects);
+	double seconds = 0.0;
+	double time = 0.0;
+
+	for (int frame = 0; frame <= frames && !cancel; frame++) {
+		double frameTime = (double)totalTime * frame / frames;
+		while (time + dt <= frameTime + 0.5 * dt && !cancel) {
+			auto start = std::chrono::high_resolution_clock::now();
+			physics.Advance(dt, &objects);
+			seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			time += dt;
+		}
+
+		std::vector<PhysObject> sample = objects;
+		if (fabs(frameTime - time) > 1e-6 * dt)
+			physics.Advance(frameTime - time, &sample);
+
+		for (int i = 0; i < n; i++)
+			std::copy(sample[i].position.value, sample[i].position.value + 3, output.positions.begin() + (frame * n + i) * 3);
+		output.energyErrors[frame] = fabs(physics.GetEnergy(sample) / startEnergy - 1.0);
+		output.seconds[frame] = seconds;
+
+		framesDone[config]++;
+	}
+}
+
+void Comparison::UpdateDivergences()
+{
+	if (!started || series.empty())
+		return;
+
+	int n = objectCount;
+	int referenceDone = framesDone[0];
+	for (int c = 0; c < series.size(); c++) {
+		ComparisonSeries& output = series[c];
+		int done = std::min(referenceDone, framesDone[c].load());
+		for (; output.divergencesDone < done; output.divergencesDone++) {
+			int frame = output.divergencesDone;
+			float largest = 0.0f;
+			for (int i = 0; i < n; i++) {
+				const float* a = &output.positions[(frame * n + i) * 3];
+				const float* b = &series[0].positions[(frame * n + i) * 3];
+				largest = std::max(largest, sqrtf((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2])));
+			}
+			output.divergences[frame] = largest;
+		}
+	}
+}
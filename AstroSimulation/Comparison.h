@@ -0,0 +1,65 @@
+#ifndef COMPARISON_H
+#define COMPARISON_H
+
+#pragma once
+#include "Physics.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//one algorithm / timestep setting to compare
+struct ComparisonConfig
+{
+	int algorithm = VELOCITY_VERLET;
+	ValueWithUnits<UnitType::Time> timestep = ValueWithUnits<UnitType::Time>(0.1f, 2);
+};
+
+//what one config produced, at frameCount + 1 evenly spaced times
+struct ComparisonSeries
+{
+	//flattened object positions of every frame, so the divergence can be worked out once the reference gets there too
+	std::vector<float> positions;
+	//relative change in total energy since the start
+	std::vector<float> energyErrors;
+	//wall clock time spent integrating, up to each frame
+	std::vector<float> seconds;
+	//largest distance between an object and the same object in the reference run (configs[0]), in gigameters
+	std::vector<float> divergences;
+	int divergencesDone = 0;
+};
+
+//Runs the same scenario with several algorithm / timestep settings at once, one thread each, and records how far each one drifts
+//from the first (the reference), how well it keeps energy, and what it costs. Everything is filled in as frames come in,
+//so the results can be plotted while the runs are still going.
+class Comparison
+{
+public:
+	Comparison() {};
+	~Comparison() {};
+
+	void Run(Physics* physics, std::vector<PhysObject> objects, float totalTime);
+	//computes the divergences of every frame that both a config and the reference have finished. Call from one thread only
+	void UpdateDivergences();
+
+	std::vector<ComparisonConfig> configs;
+	//number of frames compared, not counting the start
+	int frameCount = 200;
+
+	//only valid once started is set. The series are sized before that, and never move while Run is going
+	std::vector<ComparisonSeries> series;
+	std::vector<std::atomic<int>> framesDone;
+
+	std::atomic<bool> started = { false };
+	std::atomic<bool> finished = { false };
+	std::atomic<bool> cancel = { false };
+
+private:
+	void RunConfig(int config, std::vector<PhysObject> objects, float dt, float totalTime, const Physics& settings);
+
+	//frameCount and the object count of the current run, since frameCount can be edited while it's going
+	int frames = 0;
+	int objectCount = 0;
+};
+
+#endif
@@ -0,0 +1,236 @@
+#include "Ensemble.h"
+
+bool Ensemble::Run(std::string scenarioFile, std::string outputFile, int algorithm, float dt, int steps)
+{
+	membersDone = 0;
+	finished = false;
+	error = "";
+
+	//one shared Physics for the settings and force calculation. Advance doesn't modify it, so all the members can use it at once
+	Physics physics;
+	if (!Physics::Load(&physics, scenarioFile, {})) {
+		error = "Couldn't load " + scenarioFile;
+		finished = true;
+		return false;
+	}
+	physics.selectedAlgorithm = algorithm;
+
+	std::vector<PhysObject> baseObjects = physics.getCurrentObjects();
+	Physics::ConvertObjectsToBaseUnits(&baseObjects);
+
+	std::ofstream file(outputFile);
+	if (baseObjects.empty() || !file.is_open()) {
+		error = baseObjects.empty() ? "The scenario has no objects" : "Couldn't open " + outputFile;
+		finished = true;
+		return false;
+	}
+
+	WriteHeader(&file, baseObjects);
+
+	//each member in flight holds its objects, a copy made during the step, and the force calculation buffers
+	size_t memberBytes = baseObjects.size() * (2 * sizeof(PhysObject) + (DETERMINISTIC_BLOCKS + 2) * 3 * sizeof(float));
+	size_t maxInFlight = (size_t)memoryBudgetMB * 1024 * 1024 / memberBytes;
+	if (maxInFlight == 0) {
+		error = "One member needs " + std::to_string(memberBytes / (1024 * 1024) + 1) + " MB, more than the memory budget";
+		finished = true;
+		return false;
+	}
+	int threads = (int)std::min(maxInFlight, (size_t)ThreadPool::Shared().GetThreadCount());
+
+	//every algorithm is velocity verlet at the moment, so the batches give the same results as running members one by one.
+	//Bigger systems are better off with the threaded force calculation
+	if (batched && baseObjects.size() < PARALLEL_FORCE_THRESHOLD && maxInFlight >= BATCH_LANES) {
+		int batchCount = (memberCount + BATCH_LANES - 1) / BATCH_LANES;
+		ThreadPool::Shared().ParallelFor(batchCount, [&](int batch) {
+			if (cancel)
+				return;
+
+			int firstMember = batch * BATCH_LANES;
+			int count = std::min(BATCH_LANES, memberCount - firstMember);
+			std::vector<MemberSummary> summaries = RunBatch(&physics, baseObjects, firstMember, count, dt, steps);
+			if (cancel)
+				return;
+
+			std::lock_guard<std::mutex> lock(fileMutex);
+			for (int i = 0; i < count; i++) {
+				WriteSummary(&file, firstMember + i, summaries[i]);
+				membersDone++;
+			}
+		}, (int)std::min(maxInFlight / BATCH_LANES, (size_t)threads));
+	}
+	else {
+		ThreadPool::Shared().ParallelFor(memberCount, [&](int member) {
+			if (cancel)
+				return;
+
+			std::vector<PhysObject> objects = baseObjects;
+			Perturb(&objects, member);
+			MemberSummary summary = RunMember(&physics, objects, dt, steps);
+			if (cancel)
+				return;
+
+			std::lock_guard<std::mutex> lock(fileMutex);
+			WriteSummary(&file, member, summary);
+			membersDone++;
+		}, threads);
+	}
+
+	finished = true;
+	return true;
+}
+
+//objects must be in base units
+void Ensemble::Perturb(std::vector<PhysObject>* objects, int member)
+{
+	std::seed_seq sequence = { seed, (unsigned int)member };
+	std::mt19937 generator(sequence);
+	std::normal_distribution<float> normal(0.0f, 1.0f);
+
+	//velocity jitter is relative to the speed around the primary. A moon's speed around the sun is mostly its planet's
+	std::vector<int> primaries = {};
+	for (int i = 0; i < objects->size(); i++)
+		primaries.push_back(Physics::GetPrimaryIndex(*objects, i));
+
+	std::vector<PhysObject> original = *objects;
+	for (int i = 0; i < objects->size(); i++) {
+		(*objects)[i].mass.value *= std::max(0.0f, 1.0f + massJitter * normal(generator));
+
+		float relativeVelocity[3];
+		for (int k = 0; k < 3; k++)
+			relativeVelocity[k] = original[i].velocity.value[k] - (primaries[i] == -1 ? 0.0f : original[primaries[i]].velocity.value[k]);
+		float speed = sqrtf(relativeVelocity[0] * relativeVelocity[0] + relativeVelocity[1] * relativeVelocity[1] + relativeVelocity[2] * relativeVelocity[2]);
+
+		for (int k = 0; k < 3; k++)
+			(*objects)[i].velocity.value[k] += velocityJitter * speed * normal(generator);
+	}
+}
+
+Ensemble::MemberSummary Ensemble::RunMember(Physics* physics, std::vector<PhysObject> objects, float dt, int steps)
+{
+	int n = objects.size();
+	MemberSummary summary;
+	summary.minDistances.assign(n, INFINITY);
+	summary.closestObjects.assign(n, -1);
+
+	for (int step = 0; step <= steps && !cancel; step++) {
+		if (step > 0)
+			physics->Advance(dt, &objects);
+
+		for (int i = 0; i < n; i++) {
+			for (int j = i + 1; j < n; j++) {
+				float dx = objects[i].position.value[0] - objects[j].position.value[0];
+				float dy = objects[i].position.value[1] - objects[j].position.value[1];
+				float dz = objects[i].position.value[2] - objects[j].position.value[2];
+				float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+				if (distance < summary.minDistances[i]) {
+					summary.minDistances[i] = distance;
+					summary.closestObjects[i] = j;
+				}
+				if (distance < summary.minDistances[j]) {
+					summary.minDistances[j] = distance;
+					summary.closestObjects[j] = i;
+				}
+			}
+		}
+	}
+
+	FinishSummary(physics, objects, &summary);
+	return summary;
+}
+
+//runs count (up to BATCH_LANES) members starting at firstMember together, one per lane
+std::vector<Ensemble::MemberSummary> Ensemble::RunBatch(Physics* physics, const std::vector<PhysObject>& baseObjects, int firstMember, int count, float dt, int steps)
+{
+	int n = baseObjects.size();
+	BatchIntegrator batch(physics->G, n);
+
+	//unused lanes just repeat the last member, so they don't produce infs or nans
+	std::vector<std::vector<PhysObject>> members(count, baseObjects);
+	for (int lane = 0; lane < BATCH_LANES; lane++) {
+		if (lane < count)
+			Perturb(&members[lane], firstMember + lane);
+		batch.SetLane(lane, members[std::min(lane, count - 1)]);
+	}
+
+	//closest approaches, in the same lane-major layout as the batch
+	std::vector<float> minDistances(n * BATCH_LANES, INFINITY);
+	std::vector<int> closestObjects(n * BATCH_LANES, -1);
+
+	for (int step = 0; step <= steps && !cancel; step++) {
+		if (step > 0)
+			batch.Step(dt);
+
+		for (int i = 0; i < n; i++) {
+			for (int j = i + 1; j < n; j++) {
+				for (int l = 0; l < BATCH_LANES; l++) {
+					float dx = batch.positions[3 * i * BATCH_LANES + l] - batch.positions[3 * j * BATCH_LANES + l];
+					float dy = batch.positions[(3 * i + 1) * BATCH_LANES + l] - batch.positions[(3 * j + 1) * BATCH_LANES + l];
+					float dz = batch.positions[(3 * i + 2) * BATCH_LANES + l] - batch.positions[(3 * j + 2) * BATCH_LANES + l];
+					float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+					if (distance < minDistances[i * BATCH_LANES + l]) {
+						minDistances[i * BATCH_LANES + l] = distance;
+						closestObjects[i * BATCH_LANES + l] = j;
+					}
+					if (distance < minDistances[j * BATCH_LANES + l]) {
+						minDistances[j * BATCH_LANES + l] = distance;
+						closestObjects[j * BATCH_LANES + l] = i;
+					}
+				}
+			}
+		}
+	}
+
+	std::vector<MemberSummary> summaries(count);
+	for (int lane = 0; lane < count; lane++) {
+		for (int i = 0; i < n; i++) {
+			summaries[lane].minDistances.push_back(minDistances[i * BATCH_LANES + lane]);
+			summaries[lane].closestObjects.push_back(closestObjects[i * BATCH_LANES + lane]);
+		}
+
+		batch.GetLane(lane, &members[lane]);
+		FinishSummary(physics, members[lane], &summaries[lane]);
+	}
+
+	return summaries;
+}
+
+//fills in the final elements of objects at the end of a member's run
+void Ensemble::FinishSummary(Physics* physics, const std::vector<PhysObject>& objects, MemberSummary* summary)
+{
+	for (int i = 0; i < objects.size(); i++) {
+		OrbitalElements elements = physics->GetOrbitalElements(objects, i);
+		summary->finalElements.push_back(elements);
+		summary->ejected.push_back(Physics::GetPrimaryIndex(objects, i) != -1 && !elements.IsBound());
+	}
+}
+
+void Ensemble::WriteHeader(std::ofstream* file, const std::vector<PhysObject>& objects)
+{
+	objectNames = {};
+	*file << "Member";
+	for (int i = 0; i < objects.size(); i++) {
+		std::string name = objects[i].name;
+		objectNames.push_back(name);
+		*file << "," << name << " SemimajorAxis," << name << " Eccentricity," << name << " Inclination,"
+			<< name << " MinDistance," << name << " Closest," << name << " Ejected";
+	}
+	*file << std::endl;
+}
+
+void Ensemble::WriteSummary(std::ofstream* file, int member, const MemberSummary& summary)
+{
+	*file << member;
+	for (int i = 0; i < summary.finalElements.size(); i++) {
+		int closest = summary.closestObjects[i];
+		*file << "," << summary.finalElements[i].semimajorAxis
+			<< "," << summary.finalElements[i].eccentricity
+			<< "," << summary.finalElements[i].inclination * 180.0f / 3.14159265f
+			<< "," << summary.minDistances[i]
+			<< "," << (closest == -1 ? "" : objectNames[closest])
+			<< "," << (summary.ejected[i] ? 1 : 0);
+	}
+	//flush so a crash or cancel keeps every member that already finished
+	*file << std::endl;
+}
@@ -0,0 +1,69 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#pragma once
+#include "Physics.h"
+#include "BatchIntegrator.h"
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+//Monte Carlo runs of one scenario. Every member gets its own randomly perturbed copy of the initial masses and velocities,
+//and members run in parallel on the thread pool. Only the current state of each member is kept in memory,
+//and only summary statistics are written out, one line per member as they finish.
+class Ensemble
+{
+public:
+	Ensemble() {};
+	~Ensemble() {};
+
+	//runs memberCount members of the scenario in scenarioFile and writes their summaries to outputFile as csv. Returns false, and sets error,
+	//if either file couldn't be opened or a single member doesn't fit in memoryBudgetMB
+	bool Run(std::string scenarioFile, std::string outputFile, int algorithm, float dt, int steps);
+
+	int memberCount = 100;
+	//standard deviation of the perturbations, as a fraction of each object's mass / speed
+	float massJitter = 0.01f;
+	float velocityJitter = 0.001f;
+	//member i is always perturbed the same way for a given seed, no matter which thread runs it
+	unsigned int seed = 1;
+	//memory for the members being run, not counting the loaded scenario. Members only exist while they run and summaries are written
+	//out as they finish, so this is enforced by how many run at once, which also caps the threads used
+	int memoryBudgetMB = 256;
+	//run small systems BATCH_LANES members at a time with BatchIntegrator, if that many fit in memoryBudgetMB
+	bool batched = true;
+
+	//progress, readable from other threads while Run is going
+	std::atomic<int> membersDone = { 0 };
+	std::atomic<bool> finished = { false };
+	std::atomic<bool> cancel = { false };
+	//why the last Run failed. Only read it once finished is set
+	std::string error = "";
+
+private:
+	struct MemberSummary
+	{
+		std::vector<OrbitalElements> finalElements;
+		//closest distance to any other object over the whole run, and which object it was
+		std::vector<float> minDistances;
+		std::vector<int> closestObjects;
+		//unbound from its primary at the end of the run
+		std::vector<bool> ejected;
+	};
+
+	void Perturb(std::vector<PhysObject>* objects, int member);
+	MemberSummary RunMember(Physics* physics, std::vector<PhysObject> objects, float dt, int steps);
+	std::vector<MemberSummary> RunBatch(Physics* physics, const std::vector<PhysObject>& baseObjects, int firstMember, int count, float dt, int steps);
+	void FinishSummary(Physics* physics, const std::vector<PhysObject>& objects, MemberSummary* summary);
+	void WriteHeader(std::ofstream* file, const std::vector<PhysObject>& objects);
+	void WriteSummary(std::ofstream* file, int member, const MemberSummary& summary);
+
+	std::mutex fileMutex;
+	std::vector<std::string> objectNames;
+};
+
+#endif
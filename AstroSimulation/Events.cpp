@@ -0,0 +1,185 @@
+#include "Events.h"
+#include "Hermite.h"
+#include "Physics.h"
+
+#include <algorithm>
+
+void Events::ScanStep(const std::vector<PhysObject>& before, double t0, const std::vector<PhysObject>& after, double t1)
+{
+	if (functions.empty() || t1 <= t0)
+		return;
+
+	std::vector<PhysObject> start = before, end = after;
+	Physics::ConvertObjectsToBaseUnits(&start);
+	Physics::ConvertObjectsToBaseUnits(&end);
+	double h = t1 - t0;
+
+	std::vector<EventRecord> found = {};
+	for (int f = 0; f < functions.size(); f++) {
+		const EventFunction& function = functions[f];
+		int n = start.size();
+		if (function.object >= n || function.other >= n || function.source >= n || function.object == function.other)
+			continue;
+
+		double g0 = Evaluate(function, start, end, h, 0.0);
+		double g1 = Evaluate(function, start, end, h, 1.0);
+		bool rising = g0 < 0.0 && g1 >= 0.0;
+		bool falling = g0 >= 0.0 && g1 < 0.0;
+		if (!(rising && WantsRising(function.type)) && !(falling && WantsFalling(function.type)))
+			continue;
+
+		//a millisecond is about 3e-11 years
+		double s = FindRoot([&](double x) { return Evaluate(function, start, end, h, x); }, 0.0, 1.0, g0, g1, 1e-12 / h);
+
+		EventRecord event;
+		event.time = t0 + h * s;
+		event.function = f;
+		event.rising = rising;
+		found.push_back(event);
+	}
+
+	std::sort(found.begin(), found.end(), [](const EventRecord& x, const EventRecord& y) { return x.time < y.time; });
+	log.insert(log.end(), found.begin(), found.end());
+}
+
+void Events::ScanFrames(const FrameHistory& frames, int first, int last)
+{
+	if (functions.empty())
+		return;
+
+	first = std::max(first, 1);
+	if (first > last)
+		return;
+
+	//frames come back as copies, so each one is only read once
+	std::vector<PhysObject> previous = frames[first - 1];
+	for (int f = first; f <= last; f++) {
+		std::vector<PhysObject> current = frames[f];
+		ScanStep(previous, frames.GetTime(f - 1), current, frames.GetTime(f));
+		previous.swap(current);
+	}
+}
+
+void Events::EraseAfter(double time)
+{
+	while (!log.empty() && log.back().time > time)
+		log.pop_back();
+}
+
+void Events::ClearFunction(int index)
+{
+	log.erase(std::remove_if(log.begin(), log.end(), [index](const EventRecord& event) { return event.function == index; }), log.end());
+}
+
+void Events::RemoveFunction(int index)
+{
+	if (index < 0 || index >= functions.size())
+		return;
+
+	ClearFunction(index);
+	functions.erase(functions.begin() + index);
+	for (int i = 0; i < log.size(); i++) {
+		if (log[i].function > index)
+			log[i].function--;
+	}
+}
+
+std::string Events::Describe(const EventRecord& event, const std::vector<std::string>& objectNames)
+{
+	if (event.function >= functions.size())
+		return "";
+
+	const EventFunction& function = functions[event.function];
+	std::string object = function.object < objectNames.size() ? objectNames[function.object] : "?";
+	std::string other = function.other < objectNames.size() ? objectNames[function.other] : "?";
+
+	switch (function.type) {
+		case EVENT_PERIAPSIS:
+			return object + " periapsis around " + other;
+		case EVENT_APOAPSIS:
+			return object + " apoapsis around " + other;
+		case EVENT_WITHIN_DISTANCE:
+			return object + " within " + std::to_string(function.threshold) + " Gm of " + other;
+		case EVENT_NODE:
+			return object + (event.rising ? " ascending" : " descending") + " node relative to " + other;
+		case EVENT_ECLIPSE: {
+			std::string source = function.source < objectNames.size() ? objectNames[function.source] : "?";
+			return other + " eclipses " + source + " from " + object + (event.rising ? " (start)" : " (end)");
+		}
+	}
+	return "";
+}
+
+bool Events::WriteLog(std::string filename, const std::vector<std::string>& objectNames)
+{
+	std::ofstream file(filename);
+	if (!file.is_open())
+		return false;
+
+	file.precision(12);
+	file << "Time,Function,Rising,Description" << std::endl;
+	for (int i = 0; i < log.size(); i++)
+		file << log[i].time << "," << log[i].function << "," << (log[i].rising ? 1 : 0) << "," << Describe(log[i], objectNames) << "\n";
+	return true;
+}
+
+double Events::Evaluate(const EventFunction& function, const std::vector<PhysObject>& start, const std::vector<PhysObject>& end, double h, double s)
+{
+	double position[3], velocity[3], otherPosition[3], otherVelocity[3];
+	HermiteState(start[function.object], end[function.object], h, s, position, velocity);
+	HermiteState(start[function.other], end[function.other], h, s, otherPosition, otherVelocity);
+
+	double r[3], v[3];
+	for (int k = 0; k < 3; k++) {
+		r[k] = position[k] - otherPosition[k];
+		v[k] = velocity[k] - otherVelocity[k];
+	}
+
+	switch (function.type) {
+		//the radial velocity goes from negative to positive at the closest point, and back at the farthest
+		case EVENT_PERIAPSIS:
+		case EVENT_APOAPSIS:
+			return r[0] * v[0] + r[1] * v[1] + r[2] * v[2];
+		case EVENT_WITHIN_DISTANCE:
+			return function.threshold - sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+		case EVENT_NODE:
+			return r[2];
+		//positive while other's disk covers the line from source to object. Only the geometric shadow, no penumbra
+		case EVENT_ECLIPSE: {
+			double sourcePosition[3], sourceVelocity[3];
+			HermiteState(start[function.source], end[function.source], h, s, sourcePosition, sourceVelocity);
+
+			double line[3], blocker[3];
+			for (int k = 0; k < 3; k++) {
+				line[k] = position[k] - sourcePosition[k];
+				blocker[k] = otherPosition[k] - sourcePosition[k];
+			}
+			double length = sqrt(line[0] * line[0] + line[1] * line[1] + line[2] * line[2]);
+			double along = (blocker[0] * line[0] + blocker[1] * line[1] + blocker[2] * line[2]) / length;
+
+			double offset = 0.0;
+			for (int k = 0; k < 3; k++) {
+				double perpendicular = blocker[k] - along * line[k] / length;
+				offset += perpendicular * perpendicular;
+			}
+			offset = sqrt(offset);
+
+			PhysObject blocking = start[function.other];
+			double radius = blocking.radius.GetBaseValue();
+			if (along <= 0.0 || along >= length)
+				return -offset;
+			return radius - offset;
+		}
+	}
+	return 0.0;
+}
+
+bool Events::WantsRising(int type)
+{
+	return type != EVENT_APOAPSIS;
+}
+
+bool Events::WantsFalling(int type)
+{
+	return type == EVENT_APOAPSIS || type == EVENT_NODE || type == EVENT_ECLIPSE;
+}
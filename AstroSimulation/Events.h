@@ -0,0 +1,107 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#pragma once
+#include "PhysObject.h"
+#include "FrameHistory.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define EVENT_PERIAPSIS 0
+#define EVENT_APOAPSIS 1
+#define EVENT_WITHIN_DISTANCE 2
+#define EVENT_NODE 3
+#define EVENT_ECLIPSE 4
+
+//a scalar function of the state that is watched for sign changes. Everything is relative to other
+struct EventFunction
+{
+	int type = EVENT_PERIAPSIS;
+	int object = 1;
+	int other = 0;
+	//eclipses: other blocks the light from source to object
+	int source = 0;
+	//within distance, in gigameters
+	float threshold = 1.0f;
+};
+
+//one event found, kept small so long runs can log lots of them
+struct EventRecord
+{
+	double time;
+	//index into Events::functions
+	short function;
+	//the event function went from negative to positive. For eclipses and distances that's the start, for nodes the ascending one
+	bool rising;
+};
+
+//Finds events between consecutive frames (which are the integrator's steps) without keeping anything in between.
+//Each step, every function is evaluated at both ends. A sign change is then narrowed down with the Illinois method on
+//the cubic hermite interpolant of the step, the same one Physics::StateAt uses, until the time is known to well under a millisecond
+class Events
+{
+public:
+	Events() {};
+	~Events() {};
+
+	//finds the events between two consecutive steps, and adds them to the log in time order
+	void ScanStep(const std::vector<PhysObject>& before, double t0, const std::vector<PhysObject>& after, double t1);
+	//scans the steps ending at frames first to last
+	void ScanFrames(const FrameHistory& frames, int first, int last);
+	//forgets events after time, when the frames after it are computed again
+	void EraseAfter(double time);
+	//forgets the events of one function, after its settings change
+	void ClearFunction(int index);
+	//removes a function and its events, and renumbers the events of the ones after it
+	void RemoveFunction(int index);
+	std::string Describe(const EventRecord& event, const std::vector<std::string>& objectNames);
+	bool WriteLog(std::string filename, const std::vector<std::string>& objectNames);
+
+	std::vector<EventFunction> functions;
+	std::vector<EventRecord> log;
+
+	const char* types[5] = { "Periapsis", "Apoapsis", "Within Distance", "Node Crossing", "Eclipse" };
+
+	//narrows down where g changes sign between a and b, given ga = g(a) and gb = g(b) on opposite sides of zero, until the bracket is shorter than tolerance.
+	//Illinois: false position, but halving the weight of an end that keeps getting kept, so it can't stall
+	template <typename Function> static double FindRoot(Function g, double a, double b, double ga, double gb, double tolerance);
+
+private:
+	//the event function at fraction s of a step of length h. start and end must be in base units
+	double Evaluate(const EventFunction& function, const std::vector<PhysObject>& start, const std::vector<PhysObject>& end, double h, double s);
+	//which sign changes count as events
+	static bool WantsRising(int type);
+	static bool WantsFalling(int type);
+};
+
+template <typename Function>
+double Events::FindRoot(Function g, double a, double b, double ga, double gb, double tolerance)
+{
+	int side = 0;
+	for (int i = 0; i < 100 && b - a > tolerance; i++) {
+		double s = (a * gb - b * ga) / (gb - ga);
+		if (!(s > a && s < b))
+			s = 0.5 * (a + b);
+
+		double gs = g(s);
+		if ((gs < 0.0) == (ga < 0.0)) {
+			a = s;
+			ga = gs;
+			if (side == -1)
+				gb *= 0.5;
+			side = -1;
+		}
+		else {
+			b = s;
+			gb = gs;
+			if (side == 1)
+				ga *= 0.5;
+			side = 1;
+		}
+	}
+	return 0.5 * (a + b);
+}
+
+#endif
@@ -0,0 +1,312 @@
+#include "FrameHistory.h"
+
+#include <algorithm>
+
+FrameHistory::FrameHistory()
+{
+	chunks = std::make_shared<std::vector<std::shared_ptr<Chunk>>>();
+}
+
+FrameHistory::FrameHistory(const std::vector<std::vector<PhysObject>>& frames, double firstTime, double dt) : FrameHistory()
+{
+	for (int f = 0; f < frames.size(); f++)
+		push_back(frames[f], firstTime + dt * f);
+}
+
+std::vector<PhysObject> FrameHistory::operator[](int index) const
+{
+	if (index < fileFrames) {
+		std::vector<PhysObject> frame = fileTemplate;
+		for (int o = 0; o < frame.size(); o++)
+			file->ReadObject(fileOffset + index, o, &frame[o]);
+		return frame;
+	}
+
+	int position = offset + index - fileFrames;
+	const Chunk& chunk = *(*chunks)[position / HISTORY_CHUNK_FRAMES];
+	if (!chunk.fit)
+		return chunk.frames[position % HISTORY_CHUNK_FRAMES];
+
+	std::vector<PhysObject> frame = chunk.fit->firstFrame;
+	for (int o = 0; o < frame.size(); o++)
+		chunk.fit->EvaluateObject(chunk.times, position % HISTORY_CHUNK_FRAMES, o, &frame[o]);
+	return frame;
+}
+
+PhysObject FrameHistory::GetObject(int index, int object) const
+{
+	if (index < fileFrames) {
+		PhysObject result = fileTemplate[object];
+		file->ReadObject(fileOffset + index, object, &result);
+		return result;
+	}
+
+	int position = offset + index - fileFrames;
+	const Chunk& chunk = *(*chunks)[position / HISTORY_CHUNK_FRAMES];
+	if (!chunk.fit)
+		return chunk.frames[position % HISTORY_CHUNK_FRAMES][object];
+
+	PhysObject result = chunk.fit->firstFrame[object];
+	chunk.fit->EvaluateObject(chunk.times, position % HISTORY_CHUNK_FRAMES, object, &result);
+	return result;
+}
+
+double FrameHistory::GetTime(int index) const
+{
+	if (index < fileFrames)
+		return file->GetTime(fileOffset + index);
+
+	int position = offset + index - fileFrames;
+	return (*chunks)[position / HISTORY_CHUNK_FRAMES]->times[position % HISTORY_CHUNK_FRAMES];
+}
+
+int FrameHistory::FindFrame(double time) const
+{
+	int first = 0, last = size() - 1;
+	while (first < last) {
+		int middle = (first + last + 1) / 2;
+		if (GetTime(middle) <= time)
+			first = middle;
+		else
+			last = middle - 1;
+	}
+	return first;
+}
+
+std::vector<std::vector<PhysObject>> FrameHistory::GetFrames(int first, int last) const
+{
+	std::vector<std::vector<PhysObject>> frames = {};
+	for (int f = first; f <= last; f++)
+		frames.push_back((*this)[f]);
+	return frames;
+}
+
+void FrameHistory::push_back(const std::vector<PhysObject>& frame, double time)
+{
+	push_back(std::vector<PhysObject>(frame), time);
+}
+
+void FrameHistory::push_back(std::vector<PhysObject>&& frame, double time)
+{
+	OwnList();
+
+	int position = offset + count;
+	int chunk = position / HISTORY_CHUNK_FRAMES;
+	if (chunk == chunks->size()) {
+		chunks->push_back(std::make_shared<Chunk>());
+		chunks->back()->frames.reserve(HISTORY_CHUNK_FRAMES);
+		chunks->back()->times.reserve(HISTORY_CHUNK_FRAMES);
+	}
+	else {
+		OwnChunk(chunk);
+		Expand(chunk);
+	}
+
+	//anything in the chunk past the end was truncated away, and now belongs only to this history
+	Chunk& target = *(*chunks)[chunk];
+	target.frames.resize(position % HISTORY_CHUNK_FRAMES);
+	target.times.resize(position % HISTORY_CHUNK_FRAMES);
+	target.frames.push_back(std::move(frame));
+	target.times.push_back(time);
+	count++;
+}
+
+std::vector<PhysObject>& FrameHistory::Edit(int index)
+{
+	if (index < fileFrames) {
+		std::vector<PhysObject> frame = (*this)[index];
+		double time = GetTime(index);
+		fileFrames = index;
+		count = 0;
+		push_back(frame, time);
+	}
+
+	OwnList();
+
+	int position = offset + index - fileFrames;
+	OwnChunk(position / HISTORY_CHUNK_FRAMES);
+	Expand(position / HISTORY_CHUNK_FRAMES);
+	return (*chunks)[position / HISTORY_CHUNK_FRAMES]->frames[position % HISTORY_CHUNK_FRAMES];
+}
+
+void FrameHistory::Set(int index, const std::vector<PhysObject>& frame, double time)
+{
+	if (index == size()) {
+		push_back(frame, time);
+		return;
+	}
+
+	Edit(index) = frame;
+	int position = offset + index - fileFrames;
+	(*chunks)[position / HISTORY_CHUNK_FRAMES]->times[position % HISTORY_CHUNK_FRAMES] = time;
+}
+
+void FrameHistory::Truncate(int frameCount)
+{
+	frameCount = std::max(frameCount, 0);
+	if (frameCount <= fileFrames) {
+		fileFrames = frameCount;
+		count = 0;
+	}
+	else
+		count = std::min(count, frameCount - fileFrames);
+}
+
+void FrameHistory::EraseFront(int frameCount)
+{
+	frameCount = std::max(0, std::min(size(), frameCount));
+	int fromFile = std::min(frameCount, fileFrames);
+	fileOffset += fromFile;
+	fileFrames -= fromFile;
+	EraseMemoryFront(frameCount - fromFile);
+}
+
+void FrameHistory::EraseMemoryFront(int frameCount)
+{
+	frameCount = std::max(0, std::min(count, frameCount));
+	OwnList();
+
+	offset += frameCount;
+	count -= frameCount;
+	int unused = offset / HISTORY_CHUNK_FRAMES;
+	chunks->erase(chunks->begin(), chunks->begin() + unused);
+	offset -= unused * HISTORY_CHUNK_FRAMES;
+}
+
+void FrameHistory::Compress(int last, double tolerance)
+{
+	last = std::min(last, size() - 1) - fileFrames;
+	if (last < 0)
+		return;
+
+	if (pending) {
+		if (pending->done.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return;
+
+		//a chunk changed since its fit started has been copied, and one dropped is gone, so neither is found.
+		//New chunks in place of the old ones, which other histories may still be reading frames from
+		OwnList();
+		for (int i = 0; i < pending->chunks.size() && pending->tolerance == tolerance; i++) {
+			auto found = std::find(chunks->rbegin(), chunks->rend(), pending->chunks[i]);
+			if (found == chunks->rend())
+				continue;
+			std::shared_ptr<Chunk> compressed = std::make_shared<Chunk>();
+			compressed->times = pending->chunks[i]->times;
+			compressed->fit = pending->fits[i];
+			*found = compressed;
+		}
+		pending = nullptr;
+	}
+
+	std::shared_ptr<PendingFits> fitting = std::make_shared<PendingFits>();
+	fitting->tolerance = tolerance;
+	for (int chunk = (offset + last + 1) / HISTORY_CHUNK_FRAMES - 1; chunk >= 0; chunk--) {
+		const std::shared_ptr<Chunk>& target = (*chunks)[chunk];
+		if (target->fit)
+			break;
+		if (target->frames.size() == HISTORY_CHUNK_FRAMES)
+			fitting->chunks.push_back(target);
+	}
+	if (fitting->chunks.empty())
+		return;
+
+	//the thread only reads the chunks it holds, which nothing changes while it does (see OwnChunk)
+	fitting->fits.resize(fitting->chunks.size());
+	PendingFits* fits = fitting.get();
+	fitting->done = std::async(std::launch::async, [fits]() {
+		for (int i = 0; i < fits->chunks.size(); i++) {
+			std::shared_ptr<ChebyshevChunk> fit = std::make_shared<ChebyshevChunk>();
+			fit->Fit(fits->chunks[i]->frames, fits->chunks[i]->times, fits->tolerance);
+			fits->fits[i] = fit;
+		}
+	});
+	pending = fitting;
+}
+
+void FrameHistory::ConvertUnits(int object, int massUnits, int positionUnits, int velocityUnits)
+{
+	OwnList();
+	if (object < fileTemplate.size())
+		ConvertObjectUnits(&fileTemplate[object], massUnits, positionUnits, velocityUnits);
+
+	for (int chunk = 0; chunk < chunks->size(); chunk++) {
+		OwnChunk(chunk);
+		Chunk& target = *(*chunks)[chunk];
+
+		//the units of a compressed chunk all come from its first frame
+		std::vector<PhysObject*> objects = {};
+		std::shared_ptr<ChebyshevChunk> fit;
+		if (target.fit) {
+			fit = std::make_shared<ChebyshevChunk>(*target.fit);
+			objects.push_back(&fit->firstFrame[object]);
+			target.fit = fit;
+		}
+		for (int f = 0; f < target.frames.size(); f++)
+			objects.push_back(&target.frames[f][object]);
+
+		for (int i = 0; i < objects.size(); i++)
+			ConvertObjectUnits(objects[i], massUnits, positionUnits, velocityUnits);
+	}
+}
+
+void FrameHistory::ConvertObjectUnits(PhysObject* object, int massUnits, int positionUnits, int velocityUnits)
+{
+	if (massUnits != -1)
+		object->mass.ConvertToUnits(massUnits);
+	if (positionUnits != -1)
+		object->position.ConvertToUnits(positionUnits);
+	if (velocityUnits != -1)
+		object->velocity.ConvertToUnits(velocityUnits);
+}
+
+//PhysObjects also have their names and satellite lists on the heap, which isn't counted
+void FrameHistory::GetMemoryUse(size_t* bytes, size_t* uncompressedBytes) const
+{
+	*bytes = 0;
+	*uncompressedBytes = 0;
+	for (int chunk = 0; chunk < chunks->size(); chunk++) {
+		const Chunk& target = *(*chunks)[chunk];
+		size_t objectCount = target.fit ? target.fit->firstFrame.size() : (target.frames.empty() ? 0 : target.frames[0].size());
+		size_t frameBytes = target.times.size() * (objectCount * sizeof(PhysObject) + sizeof(std::vector<PhysObject>));
+		*bytes += target.times.size() * sizeof(double) + (target.fit ? target.fit->Bytes() : frameBytes);
+		*uncompressedBytes += target.times.size() * sizeof(double) + frameBytes;
+	}
+}
+
+void FrameHistory::UseFile(std::shared_ptr<HistoryFile> file, long long firstFrame, int frameCount, const std::vector<PhysObject>& templateFrame)
+{
+	EraseMemoryFront(frameCount - fileFrames);
+	this->file = file;
+	fileTemplate = templateFrame;
+	fileOffset = firstFrame;
+	fileFrames = frameCount;
+}
+
+//makes the chunk list this history's own, without any chunks past the last frame. Copies pointers, not frames
+void FrameHistory::OwnList()
+{
+	int used = (offset + count + HISTORY_CHUNK_FRAMES - 1) / HISTORY_CHUNK_FRAMES;
+	if (chunks.use_count() == 1 && chunks->size() == used)
+		return;
+
+	chunks = std::make_shared<std::vector<std::shared_ptr<Chunk>>>(chunks->begin(), chunks->begin() + used);
+}
+
+//a chunk being fitted is held by the fitting too, so it's always copied here rather than changed under it
+void FrameHistory::OwnChunk(int chunk)
+{
+	if ((*chunks)[chunk].use_count() > 1)
+		(*chunks)[chunk] = std::make_shared<Chunk>(*(*chunks)[chunk]);
+}
+
+//a new chunk, since other histories may still be reading from the compressed one
+void FrameHistory::Expand(int chunk)
+{
+	if (!(*chunks)[chunk]->fit)
+		return;
+
+	std::shared_ptr<Chunk> expanded = std::make_shared<Chunk>();
+	expanded->times = (*chunks)[chunk]->times;
+	(*chunks)[chunk]->fit->Evaluate(expanded->times, &expanded->frames);
+	(*chunks)[chunk] = expanded;
+}
@@ -0,0 +1,118 @@
+#ifndef FRAMEHISTORY_H
+#define FRAMEHISTORY_H
+
+#pragma once
+#include "PhysObject.h"
+#include "ChebyshevChunk.h"
+#include "HistoryFile.h"
+
+#include <future>
+#include <memory>
+#include <vector>
+
+//frames per chunk of a FrameHistory
+#define HISTORY_CHUNK_FRAMES 256
+
+//Computed frames and their times, stored in reference counted chunks. Copying a history only copies a pointer, and the copies share every chunk
+//until one of them changes it, which copies just that chunk (copy on write). Branches, and the backup kept for cancelling
+//a computation, cost nothing until they go different ways, and even then share all the frames before that.
+//Full chunks can be compressed into Chebyshev series (see ChebyshevChunk). The series are fitted on another thread, and the chunks
+//are only swapped for them by a later Compress. Reading a frame of a compressed chunk evaluates just that frame, so frames are returned
+//by value, and nothing read stays around. Editing a compressed chunk turns it back into frames.
+//The first frames can also come from a HistoryFile instead of memory. They are read as they're asked for, and cost no memory otherwise.
+//Frames from a file can't be changed there, so editing one of them cuts the history off after it: the frames up to it
+//stay in the file, and the edited frame starts the frames in memory again.
+//Not thread safe. Background threads should work on their own frames, and hand them to the ui thread.
+class FrameHistory
+{
+public:
+	FrameHistory();
+	//frames spaced evenly by dt, starting at firstTime
+	FrameHistory(const std::vector<std::vector<PhysObject>>& frames, double firstTime, double dt);
+
+	int size() const { return fileFrames + count; }
+	bool empty() const { return size() == 0; }
+	//a copy, since compressed frames and frames in a file aren't in memory as frames
+	std::vector<PhysObject> operator[](int index) const;
+	std::vector<PhysObject> back() const { return (*this)[size() - 1]; }
+	//in years. Times always increase with the index, but don't have to be evenly spaced
+	double GetTime(int index) const;
+	//last frame at or before time (binary search), or the first frame if time is before all of them
+	int FindFrame(double time) const;
+	//one object of a frame. Doesn't decode the rest of a compressed chunk
+	PhysObject GetObject(int index, int object) const;
+	//copies of frames first to last
+	std::vector<std::vector<PhysObject>> GetFrames(int first, int last) const;
+
+	void push_back(const std::vector<PhysObject>& frame, double time);
+	//without copying the frame, for big ones
+	void push_back(std::vector<PhysObject>&& frame, double time);
+	//frame index, for changing in place. Copies its chunk first if it is shared
+	std::vector<PhysObject>& Edit(int index);
+	//replaces frame index, or adds it to the end if index is size()
+	void Set(int index, const std::vector<PhysObject>& frame, double time);
+	//keeps the first frameCount frames. The chunks are left alone, so this is O(1)
+	void Truncate(int frameCount);
+	//drops the first frameCount frames, and releases the chunks nothing uses any more
+	void EraseFront(int frameCount);
+
+	//compresses the full chunks up to frame last that aren't yet, to within tolerance (gigameters). Goes back from last, and stops at the first
+	//chunk that is already compressed. The fitting is done on another thread: each call first puts in the chunks the last one fitted, if
+	//it's done, and starts on the next ones. Chunks changed in the meantime keep their frames.
+	//The frames change by up to tolerance, so only this history gets the compressed chunks. Other histories sharing a chunk keep the frames they had
+	void Compress(int last, double tolerance);
+	//changes the units of one object in every frame, without decoding compressed chunks. -1 leaves that unit alone
+	void ConvertUnits(int object, int massUnits, int positionUnits, int velocityUnits);
+	//approximate memory used by the frames, and what they would use uncompressed. Frames in a file don't count
+	void GetMemoryUse(size_t* bytes, size_t* uncompressedBytes) const;
+
+	//makes the first frameCount frames the ones written to file from its frame firstFrame on, dropping any of them that were in memory.
+	//templateFrame has everything but the positions, velocities and rotations, in the units the frames should be in
+	void UseFile(std::shared_ptr<HistoryFile> file, long long firstFrame, int frameCount, const std::vector<PhysObject>& templateFrame);
+	//frames from the start that are read from a file
+	int FileFrames() const { return fileFrames; }
+
+private:
+	struct Chunk
+	{
+		//empty when the chunk is compressed
+		std::vector<std::vector<PhysObject>> frames;
+		std::vector<double> times;
+		std::shared_ptr<const ChebyshevChunk> fit;
+	};
+
+	struct PendingFits
+	{
+		//the chunks as they were when fitting started. Holding them keeps them from being changed in place
+		std::vector<std::shared_ptr<const Chunk>> chunks;
+		std::vector<std::shared_ptr<const ChebyshevChunk>> fits;
+		double tolerance = 0.0;
+		//last, so it's destroyed first, which waits for the fitting to finish with the vectors above
+		std::future<void> done;
+	};
+
+	void OwnList();
+	void OwnChunk(int chunk);
+	//turns a compressed chunk back into frames, so it can be changed
+	void Expand(int chunk);
+	static void ConvertObjectUnits(PhysObject* object, int massUnits, int positionUnits, int velocityUnits);
+	//drops frames from the front of the ones in memory only
+	void EraseMemoryFront(int frameCount);
+
+	//the chunk list is shared too, so copying a history doesn't depend on its length
+	std::shared_ptr<std::vector<std::shared_ptr<Chunk>>> chunks;
+	//position of frame 0 in the first chunk
+	int offset = 0;
+	//frames in memory, which come after the ones in the file
+	int count = 0;
+
+	std::shared_ptr<HistoryFile> file;
+	std::vector<PhysObject> fileTemplate;
+	//frame number in the file of frame 0
+	long long fileOffset = 0;
+	int fileFrames = 0;
+	//null when nothing is being fitted. Copies of the history share it, but only one that calls Compress takes the fits
+	std::shared_ptr<PendingFits> pending;
+};
+
+#endif
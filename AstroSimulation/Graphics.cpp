@@ -417,7 +417,9 @@ void Graphics::drawLines(Physics * physics) {
 	std::vector<PhysObject> objects = physics->getCurrentObjects();
 	for (int i = 0; i < objects.size(); i++) {
 
-		if (physics->paths[i].empty())
+		//the points up to dataIndex. Paths may not have caught up with it yet, and only the points that get drawn are uploaded
+		int count = physics->PathPointsUpTo(i, physics->dataIndex);
+		if (count <= 0)
 			continue;
 
 		glGenVertexArrays(1, &VAO);
@@ -427,7 +429,7 @@ void Graphics::drawLines(Physics * physics) {
 		glGenBuffers(1, &vertexVBO);
 		glEnableVertexAttribArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, vertexVBO);
-		glBufferData(GL_ARRAY_BUFFER, physics->paths[i].size() * sizeof(GLfloat), &(physics->paths)[i][0], GL_STREAM_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, 3 * count * sizeof(GLfloat), &(physics->paths)[i][0], GL_STREAM_DRAW);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
 
 		// Color attribute
@@ -443,7 +445,20 @@ void Graphics::drawLines(Physics * physics) {
 
 		//+1 so that the line connects with the point
 		//single instance, so I can pass just one copy of the color, and have it apply to evry vertex
-		glDrawArraysInstanced(GL_LINE_STRIP, 0, physics->dataIndex + 1, 1);
+		int refined = physics->refinedFrames < 0 ? count : std::min(physics->PathPointsUpTo(i, physics->refinedFrames - 1), count);
+		if (refined > 0)
+			glDrawArraysInstanced(GL_LINE_STRIP, 0, refined, 1);
+
+		//frames that are still a preview are drawn dimmer, starting from the last refined point so the line stays connected
+		if (refined < count) {
+			std::array<float, 3> previewColor = physics->objectSettings[i].color;
+			for (int k = 0; k < previewColor.size(); k++)
+				previewColor[k] *= 0.35f;
+			glBufferData(GL_ARRAY_BUFFER, previewColor.size() * sizeof(GLfloat), &previewColor[0], GL_STREAM_DRAW);
+
+			int first = std::max(refined - 1, 0);
+			glDrawArraysInstanced(GL_LINE_STRIP, first, count - first, 1);
+		}
 		glBindVertexArray(0);
 
 		glDeleteVertexArrays(1, &VAO);
@@ -0,0 +1,28 @@
+#ifndef HERMITE_H
+#define HERMITE_H
+
+#pragma once
+#include "PhysObject.h"
+
+//position and velocity at fraction s of the way from start to end, which are h apart in time, on the cubic hermite curve through
+//both ends' positions and velocities. That curve is the continuous extension of velocity verlet, and matches the frames exactly.
+//Playback interpolates in floats (T = float), and the event and proximity searches in doubles, so the roots they narrow down
+//aren't lost to roundoff. start and end must be in base units
+template <typename T>
+void HermiteState(const PhysObject& start, const PhysObject& end, T h, T s, T position[3], T velocity[3])
+{
+	//hermite basis functions and their derivatives
+	T h00 = 2 * s * s * s - 3 * s * s + 1, h10 = s * s * s - 2 * s * s + s;
+	T h01 = -2 * s * s * s + 3 * s * s, h11 = s * s * s - s * s;
+	T d00 = 6 * s * s - 6 * s, d10 = 3 * s * s - 4 * s + 1;
+	T d01 = -6 * s * s + 6 * s, d11 = 3 * s * s - 2 * s;
+
+	for (int k = 0; k < 3; k++) {
+		T p0 = start.position.value[k], v0 = start.velocity.value[k];
+		T p1 = end.position.value[k], v1 = end.velocity.value[k];
+		position[k] = h00 * p0 + h10 * h * v0 + h01 * p1 + h11 * h * v1;
+		velocity[k] = (d00 * p0 + d10 * h * v0 + d01 * p1 + d11 * h * v1) / h;
+	}
+}
+
+#endif
@@ -0,0 +1,263 @@
+#include "HistoryFile.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+static const char historyMagic[8] = "ASTHIST";
+
+static std::FILE* OpenForWriting(const std::string& filename)
+{
+	std::FILE* file = nullptr;
+#ifdef _WIN32
+	fopen_s(&file, filename.c_str(), "wb+");
+#else
+	file = std::fopen(filename.c_str(), "wb+");
+#endif
+	return file;
+}
+
+//files get far past 2 GB, which fseek can't reach everywhere
+static bool Seek(std::FILE* file, uint64_t position)
+{
+#ifdef _WIN32
+	return _fseeki64(file, (__int64)position, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)position, SEEK_SET) == 0;
+#endif
+}
+
+HistoryFile::~HistoryFile()
+{
+	Close();
+}
+
+bool HistoryFile::Create(std::string filename, const std::string& scenario, int objectCount)
+{
+	Close();
+	std::remove(filename.c_str());
+	output = OpenForWriting(filename);
+	if (!output)
+		return false;
+
+	header = {};
+	std::memcpy(header.magic, historyMagic, sizeof(header.magic));
+	header.version = HISTORY_FILE_VERSION;
+	header.objectCount = objectCount;
+	header.scenarioBytes = scenario.size();
+	//frames start on a page of their own
+	header.dataOffset = (sizeof(Header) + scenario.size() + 4095) / 4096 * 4096;
+	header.frameCount = 0;
+
+	buffer = {};
+	bufferFirst = 0;
+	writtenFrames = 0;
+	failed = false;
+
+	if (!WriteHeader() || std::fwrite(scenario.data(), 1, scenario.size(), output) != scenario.size() || std::fflush(output) != 0) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool HistoryFile::Resume(std::string filename, long long frame, int objectCount)
+{
+	Close();
+#ifdef _WIN32
+	fopen_s(&output, filename.c_str(), "rb+");
+#else
+	output = std::fopen(filename.c_str(), "rb+");
+#endif
+	if (!output)
+		return false;
+
+	buffer = {};
+	failed = false;
+	if (std::fread(&header, sizeof(Header), 1, output) != 1 || std::memcmp(header.magic, historyMagic, sizeof(header.magic)) != 0
+		|| header.version != HISTORY_FILE_VERSION || header.objectCount != objectCount || frame > header.frameCount) {
+		std::fclose(output);
+		output = nullptr;
+		return false;
+	}
+
+	//the last chunk may only be partly written, and is read back so the chunks stay where a new file would have them
+	bufferFirst = header.frameCount / HISTORY_FILE_CHUNK_FRAMES * HISTORY_FILE_CHUNK_FRAMES;
+	buffer.resize((header.frameCount - bufferFirst) * FrameBytes());
+	if (!buffer.empty() && (!Seek(output, header.dataOffset + bufferFirst * FrameBytes()) || std::fread(buffer.data(), 1, buffer.size(), output) != buffer.size())) {
+		std::fclose(output);
+		output = nullptr;
+		buffer = {};
+		return false;
+	}
+	writtenFrames = header.frameCount;
+	return true;
+}
+
+bool HistoryFile::Write(long long frame, const std::vector<PhysObject>& objects, double time)
+{
+	if (!output || objects.size() != header.objectCount)
+		return false;
+
+	uint64_t frameBytes = FrameBytes();
+	long long buffered = buffer.size() / frameBytes;
+	if (frame > bufferFirst + buffered)
+		return false;
+
+	if (frame < bufferFirst) {
+		//back into a chunk that is already on disk. The frames before this one in its chunk are read back,
+		//and the file ends before that chunk until it's full again
+		bufferFirst = frame / HISTORY_FILE_CHUNK_FRAMES * HISTORY_FILE_CHUNK_FRAMES;
+		buffer.resize((frame - bufferFirst) * frameBytes);
+		if (!buffer.empty() && (!Seek(output, header.dataOffset + bufferFirst * frameBytes) || std::fread(buffer.data(), 1, buffer.size(), output) != buffer.size())) {
+			failed = true;
+			return false;
+		}
+		header.frameCount = bufferFirst;
+		writtenFrames = bufferFirst;
+		if (!WriteHeader())
+			return false;
+	}
+	else
+		buffer.resize((frame - bufferFirst) * frameBytes);
+
+	size_t start = buffer.size();
+	buffer.resize(start + frameBytes);
+	char* target = &buffer[start];
+	std::memcpy(target, &time, sizeof(double));
+	target += sizeof(double);
+
+	for (int i = 0; i < objects.size(); i++) {
+		ValueWithUnits3<UnitType::Distance> position = objects[i].position;
+		ValueWithUnits3<UnitType::Velocity> velocity = objects[i].velocity;
+		float basePosition[3], baseVelocity[3];
+		position.GetBaseValue(basePosition);
+		velocity.GetBaseValue(baseVelocity);
+		float values[HISTORY_FILE_VALUES] = { basePosition[0], basePosition[1], basePosition[2], baseVelocity[0], baseVelocity[1], baseVelocity[2], objects[i].rotationDegrees };
+		std::memcpy(target, values, sizeof(values));
+		target += sizeof(values);
+	}
+
+	if (buffer.size() == HISTORY_FILE_CHUNK_FRAMES * frameBytes) {
+		if (!WriteChunk())
+			return false;
+		bufferFirst += HISTORY_FILE_CHUNK_FRAMES;
+		buffer.clear();
+	}
+	return true;
+}
+
+void HistoryFile::Close()
+{
+	if (!output)
+		return;
+
+	if (!buffer.empty())
+		WriteChunk();
+	std::fclose(output);
+	output = nullptr;
+	buffer = {};
+}
+
+bool HistoryFile::WriteChunk()
+{
+	if (!Seek(output, header.dataOffset + bufferFirst * FrameBytes()) || std::fwrite(buffer.data(), 1, buffer.size(), output) != buffer.size()) {
+		failed = true;
+		return false;
+	}
+	header.frameCount = bufferFirst + buffer.size() / FrameBytes();
+	if (!WriteHeader())
+		return false;
+	writtenFrames = header.frameCount;
+	return true;
+}
+
+//the frames have to be flushed before the header that counts them
+bool HistoryFile::WriteHeader()
+{
+	if (std::fflush(output) != 0 || !Seek(output, 0) || std::fwrite(&header, sizeof(Header), 1, output) != 1 || std::fflush(output) != 0) {
+		failed = true;
+		return false;
+	}
+	return true;
+}
+
+bool HistoryFile::Open(std::string filename)
+{
+	return mapped.Open(filename) && ReadHeader();
+}
+
+bool HistoryFile::Refresh()
+{
+	if (!mapped.Data())
+		return false;
+
+	uint64_t count;
+	std::memcpy(&count, mapped.Data() + offsetof(Header, frameCount), sizeof(count));
+	if (count == header.frameCount)
+		return true;
+
+	//what was written inside the mapping shows up in it without mapping again
+	if (header.dataOffset + count * FrameBytes() > mapped.Size())
+		return mapped.Remap() && ReadHeader();
+	header.frameCount = count;
+	frameCount = count;
+	return true;
+}
+
+double HistoryFile::GetTime(long long frame) const
+{
+	double time;
+	std::memcpy(&time, FrameData(frame), sizeof(double));
+	return time;
+}
+
+void HistoryFile::ReadObject(long long frame, int object, PhysObject* result) const
+{
+	float values[HISTORY_FILE_VALUES];
+	std::memcpy(values, FrameData(frame) + sizeof(double) + object * sizeof(values), sizeof(values));
+
+	//the values are in base units, and go back into the units of result
+	ValueWithUnits3<UnitType::Distance> positionUnits = result->position;
+	ValueWithUnits3<UnitType::Velocity> velocityUnits = result->velocity;
+	float positionScale[3], velocityScale[3];
+	for (int k = 0; k < 3; k++) {
+		positionUnits.value[k] = 1.0f;
+		velocityUnits.value[k] = 1.0f;
+	}
+	positionUnits.GetBaseValue(positionScale);
+	velocityUnits.GetBaseValue(velocityScale);
+
+	for (int k = 0; k < 3; k++) {
+		result->position.value[k] = values[k] / positionScale[k];
+		result->velocity.value[k] = values[k + 3] / velocityScale[k];
+	}
+	result->rotationDegrees = values[6];
+}
+
+void HistoryFile::ReadPosition(long long frame, int object, float position[3]) const
+{
+	std::memcpy(position, FrameData(frame) + sizeof(double) + object * HISTORY_FILE_VALUES * sizeof(float), 3 * sizeof(float));
+}
+
+//reads the header of the file as it is mapped now
+bool HistoryFile::ReadHeader()
+{
+	if (mapped.Size() < sizeof(Header)) {
+		mapped.Close();
+		return false;
+	}
+
+	uint64_t size = mapped.Size();
+	std::memcpy(&header, mapped.Data(), sizeof(Header));
+	if (std::memcmp(header.magic, historyMagic, sizeof(header.magic)) != 0 || header.version > HISTORY_FILE_VERSION
+		|| header.objectCount == 0 || header.dataOffset < sizeof(Header) + header.scenarioBytes || sizeof(Header) + header.scenarioBytes > size) {
+		mapped.Close();
+		return false;
+	}
+
+	scenario.assign(mapped.Data() + sizeof(Header), header.scenarioBytes);
+	//in case the file got cut short. Until the first chunk is written, it ends before dataOffset
+	frameCount = size < header.dataOffset ? 0 : (long long)std::min(header.frameCount, (size - header.dataOffset) / FrameBytes());
+	return true;
+}
@@ -0,0 +1,93 @@
+#ifndef HISTORYFILE_H
+#define HISTORYFILE_H
+
+#pragma once
+#include "PhysObject.h"
+#include "MappedFile.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//files newer than this can't be read
+#define HISTORY_FILE_VERSION 1
+//frames written to disk at once
+#define HISTORY_FILE_CHUNK_FRAMES 256
+//floats stored per object and frame: position and velocity (base units), then the rotation in degrees
+#define HISTORY_FILE_VALUES 7
+
+//Every frame of a run, written to disk as it is computed, so runs far too long to keep in memory can still be played back.
+//Layout: a fixed header, the scenario the run started from (the same xml a save file has), then the frames from the first
+//page boundary on. Each frame is its time (double), then HISTORY_FILE_VALUES floats per object. Frames are written a chunk at a time,
+//and the frame count in the header only goes up once the chunk is on disk, so a run that got killed still opens up to its last full chunk.
+//Reading maps the file into memory instead of loading it, so opening a file costs the same however long the run was,
+//and playing it back only keeps the frames near playback in memory
+class HistoryFile
+{
+public:
+	HistoryFile() {};
+	~HistoryFile();
+
+	//writing, from one thread at a time. Any file already there is deleted first, so histories still reading it keep the old one
+	bool Create(std::string filename, const std::string& scenario, int objectCount);
+	//goes on writing a file an earlier run left behind, for a run restarted from its frame number frame. Fails if the file ends before that
+	bool Resume(std::string filename, long long frame, int objectCount);
+	//frame number frame of the run. Has to be at most one past the last frame written. If it is earlier,
+	//the frames from there on are replaced as the run goes on (the run was restarted from an edited frame)
+	bool Write(long long frame, const std::vector<PhysObject>& objects, double time);
+	//writes the frames still waiting for their chunk to fill up
+	void Close();
+	bool IsWriting() const { return output != nullptr; }
+	//frames on disk, readable from other threads while writing. failed is set if a write didn't go through
+	std::atomic<long long> writtenFrames = { 0 };
+	std::atomic<bool> failed = { false };
+
+	//reading
+	bool Open(std::string filename);
+	//picks up the frames written since the last call, for files that are still being written. The file is only mapped again
+	//once they go past the end of the mapping
+	bool Refresh();
+	long long FrameCount() const { return frameCount; }
+	int ObjectCount() const { return header.objectCount; }
+	//xml of the first frame, with the names, masses, settings and so on
+	std::string scenario;
+
+	double GetTime(long long frame) const;
+	//only sets the position, velocity and rotation, in the units result already has
+	void ReadObject(long long frame, int object, PhysObject* result) const;
+	//in gigameters
+	void ReadPosition(long long frame, int object, float position[3]) const;
+
+private:
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t objectCount;
+		uint64_t scenarioBytes;
+		//where the first frame starts
+		uint64_t dataOffset;
+		uint64_t frameCount;
+	};
+
+	uint64_t FrameBytes() const { return sizeof(double) + (uint64_t)header.objectCount * HISTORY_FILE_VALUES * sizeof(float); }
+	const char* FrameData(long long frame) const { return mapped.Data() + header.dataOffset + frame * FrameBytes(); }
+	bool WriteChunk();
+	bool WriteHeader();
+	bool ReadHeader();
+
+	Header header = {};
+	long long frameCount = 0;
+
+	//writing. The chunk being filled starts at frame bufferFirst
+	std::FILE* output = nullptr;
+	std::vector<char> buffer;
+	long long bufferFirst = 0;
+
+	//reading
+	MappedFile mapped;
+};
+
+#endif
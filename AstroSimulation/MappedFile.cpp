@@ -0,0 +1,100 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(std::string filename)
+{
+	Close();
+	path = filename;
+	return Map();
+}
+
+bool MappedFile::Remap()
+{
+	Unmap();
+	return Map();
+}
+
+void MappedFile::Close()
+{
+	Unmap();
+#ifdef _WIN32
+	if (fileHandle)
+		CloseHandle((HANDLE)fileHandle);
+	fileHandle = nullptr;
+#else
+	if (descriptor >= 0)
+		close(descriptor);
+	descriptor = -1;
+#endif
+}
+
+//empty files can't be mapped, and fail too
+bool MappedFile::Map()
+{
+#ifdef _WIN32
+	if (!fileHandle) {
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		fileHandle = file;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx((HANDLE)fileHandle, &fileSize) || fileSize.QuadPart == 0 || fileSize.QuadPart != (SIZE_T)fileSize.QuadPart)
+		return false;
+
+	mappingHandle = CreateFileMappingA((HANDLE)fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mappingHandle)
+		return false;
+	data = (const char*)MapViewOfFile((HANDLE)mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		Unmap();
+		return false;
+	}
+	size = fileSize.QuadPart;
+#else
+	if (descriptor < 0) {
+		descriptor = open(path.c_str(), O_RDONLY);
+		if (descriptor < 0)
+			return false;
+	}
+	struct stat info;
+	if (fstat(descriptor, &info) != 0 || info.st_size == 0)
+		return false;
+
+	void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+	if (view == MAP_FAILED)
+		return false;
+	data = (const char*)view;
+	size = info.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::Unmap()
+{
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mappingHandle)
+		CloseHandle((HANDLE)mappingHandle);
+	mappingHandle = nullptr;
+#else
+	if (data)
+		munmap((void*)data, size);
+#endif
+	data = nullptr;
+	size = 0;
+}
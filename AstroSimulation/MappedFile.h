@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#pragma once
+#include <cstdint>
+#include <string>
+
+//A whole file mapped into memory, read only. The OS only loads the pages that actually get read, and drops them again
+//when memory gets tight, so mapping a file costs the same however big it is.
+//Files bigger than a few GB need a 64 bit build
+class MappedFile
+{
+public:
+	MappedFile() {};
+	~MappedFile();
+
+	bool Open(std::string filename);
+	//maps the file again as it is now, for files that are still being written. The file itself stays open between maps,
+	//so a file created again under the same name isn't picked up
+	bool Remap();
+	void Close();
+
+	const char* Data() const { return data; }
+	uint64_t Size() const { return size; }
+
+private:
+	bool Map();
+	void Unmap();
+
+	std::string path;
+	const char* data = nullptr;
+	uint64_t size = 0;
+	//HANDLEs of the file and its mapping on windows, the file descriptor everywhere else
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+	int descriptor = -1;
+};
+
+#endif
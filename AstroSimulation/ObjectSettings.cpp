@@ -2,7 +2,7 @@
 
 ObjectSettings::ObjectSettings(bool ShowHistory, std::string DisplayType, std::string colorString, int texIndex)
 {
-	showHistory = ShowHistory;
+	historyPolicy = ShowHistory ? HISTORY_FULL : HISTORY_NONE;
 	textureIndex = texIndex;
 	SetColorFromString(colorString);
 	SetDisplayType(DisplayType);
@@ -22,6 +22,21 @@ void ObjectSettings::SetDisplayType(std::string type)
 		displayType = DisplayTypes::Point;
 }
 
+const char* ObjectSettings::historyPolicies[4] = { "None", "Recent", "Full", "Adaptive" };
+
+void ObjectSettings::SetHistoryPolicy(std::string policy)
+{
+	for (int i = 0; i < 4; i++) {
+		if (policy == historyPolicies[i])
+			historyPolicy = i;
+	}
+}
+
+std::string ObjectSettings::HistoryPolicyToString() const
+{
+	return historyPolicies[historyPolicy];
+}
+
 //http://stackoverflow.com/questions/236129/split-a-string-in-c
 void split(const std::string &s, char delim, std::vector<std::string> &elems) {
 	std::stringstream ss;
@@ -77,7 +92,7 @@ void ObjectSettings::SetColorFromString(std::string colorString)
 }
 
 //sad that I have to do this
-std::string ObjectSettings::TypeToString() 
+std::string ObjectSettings::TypeToString() const
 {
 	switch (displayType) 
 	{
@@ -7,6 +7,14 @@
 #include <vector>
 #include <sstream>
 
+//how much of an object's path is kept and drawn
+#define HISTORY_NONE 0
+//the last historyFrames frames
+#define HISTORY_RECENT 1
+#define HISTORY_FULL 2
+//only the points where the path bends, see historyAngle
+#define HISTORY_ADAPTIVE 3
+
 class ObjectSettings
 {
 public:
@@ -15,13 +23,23 @@ public:
 
 	void SetDisplayType(std::string type);
 	void SetColorFromString(std::string colorString);
-	std::string TypeToString();
-	bool showHistory;
+	std::string TypeToString() const;
+	void SetHistoryPolicy(std::string policy);
+	std::string HistoryPolicyToString() const;
+	//ShowHistory in save files is HISTORY_FULL or HISTORY_NONE, for the files from before there were other policies
+	int historyPolicy;
+	int historyFrames = 1000;
+	//degrees the path has to turn before HISTORY_ADAPTIVE keeps another point. Points end up about 2 * angle apart along a circle,
+	//so the drawn path stays within about radius * angle^2 / 2 of the real one (angle in radians), with 180 / angle points per orbit
+	float historyAngle = 2.0f;
+	static const char* historyPolicies[4];
 	enum class DisplayTypes { Point, Image, Sphere};
 
 	DisplayTypes displayType;
 	std::array<float, 3> color;
 	int textureIndex;
+	//name of the texture folder, which is what save files have
+	std::string texture;
 
 private:
 
@@ -0,0 +1,126 @@
+#include "OrbitalElements.h"
+
+//everything is done in doubles internally. Nearly circular and nearly flat orbits lose all their angles to roundoff in floats
+//source: Vallado, Fundamentals of Astrodynamics and Applications, algorithms 9 (RV2COE) and 10 (COE2RV)
+OrbitalElements OrbitalElements::FromState(float mu, const float position[3], const float velocity[3])
+{
+	const double pi = 3.14159265358979323846;
+	double x[3] = { position[0], position[1], position[2] };
+	double v[3] = { velocity[0], velocity[1], velocity[2] };
+
+	double r = sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+	double v2 = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+	double rv = x[0] * v[0] + x[1] * v[1] + x[2] * v[2];
+
+	//angular momentum, and the node vector (z cross h)
+	double h[3] = { x[1] * v[2] - x[2] * v[1], x[2] * v[0] - x[0] * v[2], x[0] * v[1] - x[1] * v[0] };
+	double hMagnitude = sqrt(h[0] * h[0] + h[1] * h[1] + h[2] * h[2]);
+	double n[3] = { -h[1], h[0], 0.0 };
+	double nMagnitude = sqrt(n[0] * n[0] + n[1] * n[1]);
+
+	double e[3];
+	for (int k = 0; k < 3; k++)
+		e[k] = ((v2 - mu / r) * x[k] - rv * v[k]) / mu;
+	double eMagnitude = sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+
+	OrbitalElements elements;
+	elements.eccentricity = eMagnitude;
+	elements.semimajorAxis = 1.0 / (2.0 / r - v2 / mu);
+	elements.inclination = acos(std::fmax(-1.0, std::fmin(1.0, h[2] / hMagnitude)));
+
+	//flat orbits have no ascending node, so measure from the x axis instead
+	bool flat = nMagnitude < 1e-12 * hMagnitude;
+	double node = flat ? 0.0 : atan2(n[1], n[0]);
+
+	//unit vectors of the orbital plane, with p along the node line and q 90 degrees ahead of it in the direction of motion
+	double p[3] = { cos(node), sin(node), 0.0 };
+	double q[3] = { h[1] * p[2] - h[2] * p[1], h[2] * p[0] - h[0] * p[2], h[0] * p[1] - h[1] * p[0] };
+	for (int k = 0; k < 3; k++)
+		q[k] /= hMagnitude;
+
+	//argument of latitude of the object, and of periapsis. Circular orbits have no periapsis, so put it at the node
+	double latitude = atan2(x[0] * q[0] + x[1] * q[1] + x[2] * q[2], x[0] * p[0] + x[1] * p[1] + x[2] * p[2]);
+	double periapsis = eMagnitude < 1e-10 ? 0.0 : atan2(e[0] * q[0] + e[1] * q[1] + e[2] * q[2], e[0] * p[0] + e[1] * p[1] + e[2] * p[2]);
+	double trueAnomaly = latitude - periapsis;
+
+	double meanAnomaly;
+	if (eMagnitude < 1.0) {
+		double eccentricAnomaly = 2.0 * atan(sqrt((1.0 - eMagnitude) / (1.0 + eMagnitude)) * tan(trueAnomaly / 2.0));
+		meanAnomaly = eccentricAnomaly - eMagnitude * sin(eccentricAnomaly);
+	}
+	else {
+		double hyperbolicAnomaly = 2.0 * atanh(sqrt((eMagnitude - 1.0) / (eMagnitude + 1.0)) * tan(trueAnomaly / 2.0));
+		meanAnomaly = eMagnitude * sinh(hyperbolicAnomaly) - hyperbolicAnomaly;
+	}
+
+	elements.longitudeOfAscendingNode = fmod(node + 2.0 * pi, 2.0 * pi);
+	elements.argumentOfPeriapsis = fmod(periapsis + 2.0 * pi, 2.0 * pi);
+	elements.meanAnomaly = eMagnitude < 1.0 ? fmod(meanAnomaly + 2.0 * pi, 2.0 * pi) : meanAnomaly;
+
+	return elements;
+}
+
+void OrbitalElements::ToState(float mu, float position[3], float velocity[3])
+{
+	double e = eccentricity;
+	double a = semimajorAxis;
+
+	double trueAnomaly, r;
+	if (e < 1.0) {
+		double eccentricAnomaly = SolveKepler(meanAnomaly, e);
+		trueAnomaly = 2.0 * atan2(sqrt(1.0 + e) * sin(eccentricAnomaly / 2.0), sqrt(1.0 - e) * cos(eccentricAnomaly / 2.0));
+		r = a * (1.0 - e * cos(eccentricAnomaly));
+	}
+	else {
+		//M = e sinh(F) - F
+		double hyperbolicAnomaly = asinh(meanAnomaly / e);
+		for (int i = 0; i < 50; i++) {
+			double delta = (e * sinh(hyperbolicAnomaly) - hyperbolicAnomaly - meanAnomaly) / (e * cosh(hyperbolicAnomaly) - 1.0);
+			hyperbolicAnomaly -= delta;
+			if (fabs(delta) < 1e-14)
+				break;
+		}
+		trueAnomaly = 2.0 * atan(sqrt((e + 1.0) / (e - 1.0)) * tanh(hyperbolicAnomaly / 2.0));
+		r = a * (1.0 - e * cosh(hyperbolicAnomaly));
+	}
+
+	//position and velocity in the orbital plane, with x towards periapsis
+	double semilatusRectum = a * (1.0 - e * e);
+	double speedScale = sqrt(mu / semilatusRectum);
+	double planePosition[2] = { r * cos(trueAnomaly), r * sin(trueAnomaly) };
+	double planeVelocity[2] = { -speedScale * sin(trueAnomaly), speedScale * (e + cos(trueAnomaly)) };
+
+	//rotate by argument of periapsis, inclination, then longitude of ascending node
+	double cosO = cos(longitudeOfAscendingNode), sinO = sin(longitudeOfAscendingNode);
+	double cosw = cos(argumentOfPeriapsis), sinw = sin(argumentOfPeriapsis);
+	double cosi = cos(inclination), sini = sin(inclination);
+	double rotation[3][2] = {
+		{ cosO * cosw - sinO * sinw * cosi, -cosO * sinw - sinO * cosw * cosi },
+		{ sinO * cosw + cosO * sinw * cosi, -sinO * sinw + cosO * cosw * cosi },
+		{ sinw * sini, cosw * sini }
+	};
+
+	for (int k = 0; k < 3; k++) {
+		position[k] = rotation[k][0] * planePosition[0] + rotation[k][1] * planePosition[1];
+		velocity[k] = rotation[k][0] * planeVelocity[0] + rotation[k][1] * planeVelocity[1];
+	}
+}
+
+bool OrbitalElements::IsBound()
+{
+	return eccentricity < 1.0f && semimajorAxis > 0.0f;
+}
+
+//solves M = E - e sin(E) for E with newton's method
+double OrbitalElements::SolveKepler(double meanAnomaly, double eccentricity)
+{
+	double eccentricAnomaly = eccentricity < 0.8 ? meanAnomaly : 3.14159265358979323846;
+	for (int i = 0; i < 50; i++) {
+		double delta = (eccentricAnomaly - eccentricity * sin(eccentricAnomaly) - meanAnomaly) / (1.0 - eccentricity * cos(eccentricAnomaly));
+		eccentricAnomaly -= delta;
+		if (fabs(delta) < 1e-14)
+			break;
+	}
+
+	return eccentricAnomaly;
+}
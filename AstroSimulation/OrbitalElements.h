@@ -0,0 +1,33 @@
+#ifndef ORBITALELEMENTS_H
+#define ORBITALELEMENTS_H
+
+#pragma once
+#include <cmath>
+
+//Keplerian elements of a two body orbit. Distances in gigameters, angles in radians, relative to the x-y plane and x axis.
+//Unbound (hyperbolic) orbits have a negative semimajor axis and eccentricity > 1.
+//https://en.wikipedia.org/wiki/Orbital_elements
+class OrbitalElements
+{
+public:
+	OrbitalElements() {};
+	~OrbitalElements() {};
+
+	//mu = G * (mass of primary + mass of object). position and velocity are relative to the primary, in base units
+	static OrbitalElements FromState(float mu, const float position[3], const float velocity[3]);
+	void ToState(float mu, float position[3], float velocity[3]);
+
+	bool IsBound();
+
+	float semimajorAxis = 0.0f;
+	float eccentricity = 0.0f;
+	float inclination = 0.0f;
+	float longitudeOfAscendingNode = 0.0f;
+	float argumentOfPeriapsis = 0.0f;
+	float meanAnomaly = 0.0f;
+
+private:
+	static double SolveKepler(double meanAnomaly, double eccentricity);
+};
+
+#endif
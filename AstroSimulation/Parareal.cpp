@@ -0,0 +1,151 @@
+#include "Parareal.h"
+
+std::vector<std::vector<PhysObject>> Parareal::Run(Physics* physics, std::vector<PhysObject> initialObjects, float dt, int totalSteps, int sliceCount, int coarseFactor, float tolerance, int maxIterations)
+{
+	iteration = 0;
+	lastCorrection = 0.0f;
+	converged = false;
+	finished = false;
+
+	std::vector<std::map<std::string, int> > originalUnits = Physics::ConvertObjectsToBaseUnits(&initialObjects);
+
+	int slices = sliceCount > 0 ? sliceCount : ThreadPool::Shared().GetThreadCount();
+	slices = std::max(1, std::min(slices, totalSteps));
+
+	//slice n covers steps [sliceStarts[n], sliceStarts[n + 1])
+	std::vector<int> sliceStarts = {};
+	for (int n = 0; n <= slices; n++)
+		sliceStarts.push_back((int)((long long)totalSteps * n / slices));
+
+	//initial guess for the start of every slice, from a single serial coarse pass
+	std::vector<std::vector<PhysObject>> starts = { initialObjects };
+	std::vector<std::vector<float>> coarseEnds(slices);
+	for (int n = 0; n < slices; n++) {
+		std::vector<PhysObject> objects = starts[n];
+		Coarse(physics, &objects, dt, sliceStarts[n + 1] - sliceStarts[n], coarseFactor);
+		coarseEnds[n] = GetState(objects);
+		starts.push_back(objects);
+
+		//rotation doesn't depend on the orbits, so there is nothing to correct. Just set it directly
+		for (int i = 0; i < objects.size(); i++)
+			starts[n + 1][i].rotationDegrees = initialObjects[i].rotationDegrees + sliceStarts[n + 1] * dt * 360.0f / initialObjects[i].rotationPeriod.GetBaseValue();
+	}
+
+	std::vector<std::vector<float>> fineEnds(slices);
+	std::vector<std::vector<float>> fineStartStates(slices);
+	std::vector<std::vector<std::vector<PhysObject>>> sliceFrames(slices);
+
+	for (int k = 1; k <= maxIterations && !cancel; k++) {
+		iteration = k;
+
+		//the expensive part. Every slice is independent, so they all run at once
+		ThreadPool::Shared().ParallelFor(slices, [&](int n) {
+			std::vector<float> startState = GetState(starts[n]);
+			//the start of this slice didn't change since last time, so neither will the result
+			if (cancel || (!sliceFrames[n].empty() && startState == fineStartStates[n]))
+				return;
+
+			std::vector<PhysObject> end;
+			Fine(physics, starts[n], dt, sliceStarts[n + 1] - sliceStarts[n], &end, &sliceFrames[n]);
+			fineEnds[n] = GetState(end);
+			fineStartStates[n] = startState;
+		});
+
+		if (cancel)
+			break;
+
+		//serial correction sweep: start[n + 1] = coarse(new start[n]) + fine(old start[n]) - coarse(old start[n])
+		float correction = 0.0f;
+		for (int n = 0; n < slices; n++) {
+			std::vector<PhysObject> objects = starts[n];
+			Coarse(physics, &objects, dt, sliceStarts[n + 1] - sliceStarts[n], coarseFactor);
+			std::vector<float> coarseEnd = GetState(objects);
+
+			std::vector<float> corrected(coarseEnd.size());
+			for (int i = 0; i < corrected.size(); i++)
+				corrected[i] = coarseEnd[i] + fineEnds[n][i] - coarseEnds[n][i];
+
+			correction = std::max(correction, GetCorrection(GetState(starts[n + 1]), corrected));
+			coarseEnds[n] = coarseEnd;
+			SetState(&starts[n + 1], corrected);
+		}
+
+		lastCorrection = correction;
+		if (correction < tolerance) {
+			converged = true;
+			break;
+		}
+	}
+
+	std::vector<std::vector<PhysObject>> frames = {};
+	if (!cancel) {
+		frames.push_back(initialObjects);
+		for (int n = 0; n < slices; n++)
+			frames.insert(frames.end(), sliceFrames[n].begin(), sliceFrames[n].end());
+
+		for (int i = 0; i < frames.size(); i++)
+			Physics::ConvertObjectsToUnits(&frames[i], originalUnits);
+	}
+
+	finished = true;
+	return frames;
+}
+
+//velocity verlet with a timestep coarseFactor times bigger than dt. Only used as a predictor, so rotation is left alone
+void Parareal::Coarse(Physics* physics, std::vector<PhysObject>* objects, float dt, int steps, int coarseFactor)
+{
+	int remaining = steps;
+	while (remaining > 0) {
+		int chunk = std::min(std::max(coarseFactor, 1), remaining);
+		physics->velocityVerlet(chunk * dt, objects);
+		remaining -= chunk;
+	}
+}
+
+void Parareal::Fine(Physics* physics, std::vector<PhysObject> start, float dt, int steps, std::vector<PhysObject>* end, std::vector<std::vector<PhysObject>>* frames)
+{
+	frames->clear();
+	for (int i = 0; i < steps; i++) {
+		physics->Advance(dt, &start);
+		frames->push_back(start);
+	}
+
+	*end = start;
+}
+
+//flattens positions and velocities into x, y, z, Vx, Vy, Vz for each object. Objects must already be in base units
+std::vector<float> Parareal::GetState(const std::vector<PhysObject>& objects)
+{
+	std::vector<float> state = {};
+	for (int i = 0; i < objects.size(); i++) {
+		state.insert(state.end(), std::begin(objects[i].position.value), std::end(objects[i].position.value));
+		state.insert(state.end(), std::begin(objects[i].velocity.value), std::end(objects[i].velocity.value));
+	}
+
+	return state;
+}
+
+void Parareal::SetState(std::vector<PhysObject>* objects, const std::vector<float>& state)
+{
+	for (int i = 0; i < objects->size(); i++) {
+		for (int k = 0; k < 3; k++) {
+			(*objects)[i].position.value[k] = state[6 * i + k];
+			(*objects)[i].velocity.value[k] = state[6 * i + 3 + k];
+		}
+	}
+}
+
+//largest change in any position, relative to that object's distance from the origin
+float Parareal::GetCorrection(const std::vector<float>& oldState, const std::vector<float>& newState)
+{
+	float correction = 0.0f;
+	for (int i = 0; i < oldState.size(); i += 6) {
+		float dx = newState[i] - oldState[i];
+		float dy = newState[i + 1] - oldState[i + 1];
+		float dz = newState[i + 2] - oldState[i + 2];
+		float r = sqrtf(newState[i] * newState[i] + newState[i + 1] * newState[i + 1] + newState[i + 2] * newState[i + 2]);
+		correction = std::max(correction, sqrtf(dx * dx + dy * dy + dz * dz) / std::max(r, 0.000001f));
+	}
+
+	return correction;
+}
@@ -0,0 +1,50 @@
+#ifndef PARAREAL_H
+#define PARAREAL_H
+
+#pragma once
+#include "Physics.h"
+
+#include <atomic>
+#include <vector>
+
+//Parallel-in-time integration. The run is cut into time slices. A cheap coarse propagator (velocity verlet with a big timestep)
+//guesses the state at the start of every slice, then the accurate fine propagator (Physics::Advance at the normal timestep)
+//runs all slices at once on separate threads. The difference between the two is used to correct the guesses, and the whole thing
+//repeats until the slice start states stop changing.
+//https://en.wikipedia.org/wiki/Parareal
+class Parareal
+{
+public:
+	Parareal() {};
+	~Parareal() {};
+
+	//returns totalSteps + 1 frames spaced by dt, starting with initialObjects. Units of the output match initialObjects.
+	//The settings are passed in rather than read from the members, so the ui can edit those while this runs
+	std::vector<std::vector<PhysObject>> Run(Physics* physics, std::vector<PhysObject> initialObjects, float dt, int totalSteps, int sliceCount, int coarseFactor, float tolerance, int maxIterations);
+
+	//0 = one slice per thread
+	int sliceCount = 0;
+	//coarse timestep, as a multiple of the fine timestep
+	int coarseFactor = 20;
+	//stop once no slice start position moves by more than this (relative to its distance from the origin) between iterations
+	float tolerance = 0.00001f;
+	int maxIterations = 10;
+
+	//progress, readable from other threads while Run is going
+	std::atomic<int> iteration = { 0 };
+	std::atomic<float> lastCorrection = { 0.0f };
+	//false if maxIterations ran out before the correction got under tolerance. The frames are still returned, but are less accurate
+	std::atomic<bool> converged = { false };
+	std::atomic<bool> finished = { false };
+	std::atomic<bool> cancel = { false };
+
+private:
+	void Coarse(Physics* physics, std::vector<PhysObject>* objects, float dt, int steps, int coarseFactor);
+	void Fine(Physics* physics, std::vector<PhysObject> start, float dt, int steps, std::vector<PhysObject>* end, std::vector<std::vector<PhysObject>>* frames);
+
+	static std::vector<float> GetState(const std::vector<PhysObject>& objects);
+	static void SetState(std::vector<PhysObject>* objects, const std::vector<float>& state);
+	static float GetCorrection(const std::vector<float>& oldState, const std::vector<float>& newState);
+};
+
+#endif
@@ -1,4 +1,11 @@
 #include "Physics.h"
+#include "Hermite.h"
+#include "Snapshot.h"
+#include "XmlImport.h"
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
 
 Physics::Physics()
 {
@@ -28,15 +35,40 @@ std::vector<std::string> Physics::SplitString(std::string str, std::string delim
 	return output;
 }
 
-void Physics::FromXml(Physics *physics, std::string filename, std::vector<std::string> textureFolders)
+std::string Physics::ExactString(float value)
 {
-	physics->playbackSpeed = 1;
+	char text[32];
+	std::snprintf(text, sizeof(text), "%.9g", value);
+	return text;
+}
+
+bool Physics::Load(Physics* physics, std::string filename, std::vector<std::string> textureFolders)
+{
+	if (Snapshot::IsSnapshotName(filename))
+		return Snapshot::Read(physics, filename, textureFolders);
+	//the document is only built for files the streaming reader doesn't understand, which then fail or load the same as before
+	if (XmlImport::Read(physics, filename, textureFolders))
+		return true;
+
+	pugi::xml_document doc;
+	if (!doc.load_file(filename.c_str()))
+		return false;
+	FromXml(physics, doc, textureFolders);
+	return true;
+}
 
+void Physics::FromXml(Physics *physics, std::string filename, std::vector<std::string> textureFolders)
+{
 	pugi::xml_document doc;
 
 	pugi::xml_parse_result result = doc.load_file(filename.c_str());
-	physics->time = doc.select_node("/SavedState/Physics/Time").node().text().as_float();
-	physics->objectSettings = {};
+	FromXml(physics, doc, textureFolders);
+}
+
+void Physics::FromXml(Physics* physics, const pugi::xml_document& doc, std::vector<std::string> textureFolders)
+{
+	float time = doc.select_node("/SavedState/Physics/Time").node().text().as_float();
+	std::vector<ObjectSettings> objectSettings = {};
 	std::vector<PhysObject> objects = {};
 	for (auto currentObjectNode : doc.select_nodes("/SavedState/Physics/Objects/PhysObject"))
 	{
@@ -81,94 +113,327 @@ void Physics::FromXml(Physics *physics, std::string filename, std::vector<std::s
 		}
 
 		ObjectSettings settings(showHistory, displayType, colorString, textureIndex);
+		settings.texture = texture;
+		std::string historyPolicy = currentObjectNode.node().child("Settings").child("HistoryPolicy").text().as_string();
+		if (historyPolicy != "")
+			settings.SetHistoryPolicy(historyPolicy);
+		settings.historyFrames = std::max(currentObjectNode.node().child("Settings").child("HistoryFrames").text().as_int(settings.historyFrames), 1);
+		settings.historyAngle = currentObjectNode.node().child("Settings").child("HistoryAngle").text().as_float(settings.historyAngle);
 		PhysObject currentObject(name, mass, position, velocity, radius, rotationPeriod, axialTilt, satellites);
 
 		objects.push_back(currentObject);
-		physics->objectSettings.push_back(settings);
+		objectSettings.push_back(settings);
 
 	}
 
-	physics->computedData = {objects};
+	LoadScenario(physics, time, std::move(objects), std::move(objectSettings));
+}
+
+void Physics::LoadScenario(Physics* physics, float time, std::vector<PhysObject> objects, std::vector<ObjectSettings> objectSettings)
+{
+	size_t count = objects.size();
+	physics->playbackSpeed = 1;
+	physics->time = time;
+	physics->objectSettings = std::move(objectSettings);
+	physics->computedData = FrameHistory();
+	physics->computedData.push_back(std::move(objects), physics->time);
+	physics->paths = std::vector<std::vector<float> >(count);
+	physics->pathFrames = std::vector<std::vector<int> >(count);
+	physics->pathStart = 0;
+	physics->pathEnd = 0;
+	physics->pathWindow = 0;
 	physics->dataIndex = 0;
+	physics->epochIndex = 0;
+	physics->epochTime = physics->time;
 	physics->origin = 0;
+	physics->conservation = {};
+	physics->refinedFrames = -1;
+	physics->events.functions = {};
+	physics->events.log = {};
+	physics->proximity.Clear();
+	physics->temporaryData = Timeline();
+	physics->timelines = { Timeline() };
+	physics->timelines[0].name = "Main";
+	physics->currentTimeline = 0;
 }
 
-void Physics::ToXml(Physics physics, std::string filename) {
-	pugi::xml_document xml;
-	pugi::xml_node root = xml.append_child("SavedState");
+void Physics::ToXml(Physics* physics, pugi::xml_document* xml) {
+	pugi::xml_node root = xml->append_child("SavedState");
 	pugi::xml_node physicsNode = root.append_child("Physics");
-	physicsNode.append_child("Time").append_child(pugi::node_pcdata).set_value(std::to_string(physics.time).c_str());
+	physicsNode.append_child("Time").append_child(pugi::node_pcdata).set_value(ExactString(physics->time).c_str());
 
 	pugi::xml_node objectsNode = physicsNode.append_child("Objects");
-	std::vector<PhysObject> objects = physics.getCurrentObjects();
+	const std::vector<PhysObject>& objects = physics->computedData[physics->dataIndex];
 	for (int i = 0; i < objects.size(); i++)
-	{
-		pugi::xml_node objectNode = objectsNode.append_child("PhysObject");
-		objectNode.append_child("Name").append_child(pugi::node_pcdata).set_value(objects[i].name.c_str());
-		objectNode.append_child("Mass").append_child(pugi::node_pcdata).set_value(std::to_string(objects[i].mass.value).c_str());
-		objectNode.append_child("RotationPeriod").append_child(pugi::node_pcdata).set_value(std::to_string(objects[i].rotationPeriod.value).c_str());
-		objectNode.append_child("AxialTilt").append_child(pugi::node_pcdata).set_value(std::to_string(objects[i].axialTilt.value).c_str());
+		ObjectToXml(objectsNode, objects[i], physics->objectSettings[i]);
+}
 
-		pugi::xml_node position = objectNode.append_child("Position");
-		pugi::xml_node velocity = objectNode.append_child("Velocity");
-		pugi::xml_node settings = objectNode.append_child("Settings");
+void Physics::ObjectToXml(pugi::xml_node objectsNode, const PhysObject& savedObject, const ObjectSettings& objectSettings)
+{
+	PhysObject object = InSaveUnits(savedObject);
+	pugi::xml_node objectNode = objectsNode.append_child("PhysObject");
+	objectNode.append_child("Name").append_child(pugi::node_pcdata).set_value(object.name.c_str());
+	objectNode.append_child("Mass").append_child(pugi::node_pcdata).set_value(ExactString(object.mass.value).c_str());
+	objectNode.append_child("RotationPeriod").append_child(pugi::node_pcdata).set_value(ExactString(object.rotationPeriod.value).c_str());
+	objectNode.append_child("AxialTilt").append_child(pugi::node_pcdata).set_value(ExactString(object.axialTilt.value).c_str());
+	objectNode.append_child("Radius").append_child(pugi::node_pcdata).set_value(ExactString(object.radius.value).c_str());
 
-		float convertedPosition[3], convertedVelocity[3];
-		objects[i].position.GetBaseValue(convertedPosition);
-		objects[i].velocity.GetBaseValue(convertedVelocity);
+	pugi::xml_node position = objectNode.append_child("Position");
+	pugi::xml_node velocity = objectNode.append_child("Velocity");
+	pugi::xml_node settings = objectNode.append_child("Settings");
 
-		position.append_child("x").append_child(pugi::node_pcdata).set_value(std::to_string(convertedPosition[0]).c_str());
-		position.append_child("y").append_child(pugi::node_pcdata).set_value(std::to_string(convertedPosition[1]).c_str());
-		position.append_child("z").append_child(pugi::node_pcdata).set_value(std::to_string(convertedPosition[2]).c_str());
+	position.append_child("x").append_child(pugi::node_pcdata).set_value(ExactString(object.position.value[0]).c_str());
+	position.append_child("y").append_child(pugi::node_pcdata).set_value(ExactString(object.position.value[1]).c_str());
+	position.append_child("z").append_child(pugi::node_pcdata).set_value(ExactString(object.position.value[2]).c_str());
 
-		velocity.append_child("Vx").append_child(pugi::node_pcdata).set_value(std::to_string(convertedVelocity[0]).c_str());
-		velocity.append_child("Vy").append_child(pugi::node_pcdata).set_value(std::to_string(convertedVelocity[1]).c_str());
-		velocity.append_child("Vz").append_child(pugi::node_pcdata).set_value(std::to_string(convertedVelocity[2]).c_str());
+	velocity.append_child("Vx").append_child(pugi::node_pcdata).set_value(ExactString(object.velocity.value[0]).c_str());
+	velocity.append_child("Vy").append_child(pugi::node_pcdata).set_value(ExactString(object.velocity.value[1]).c_str());
+	velocity.append_child("Vz").append_child(pugi::node_pcdata).set_value(ExactString(object.velocity.value[2]).c_str());
 
-		settings.append_child("ShowHistory").append_child(pugi::node_pcdata).set_value(std::to_string(physics.objectSettings[i].showHistory).c_str());
-		settings.append_child("DisplayType").append_child(pugi::node_pcdata).set_value(physics.objectSettings[i].TypeToString().c_str());
+	settings.append_child("ShowHistory").append_child(pugi::node_pcdata).set_value(std::to_string(objectSettings.historyPolicy != HISTORY_NONE).c_str());
+	settings.append_child("HistoryPolicy").append_child(pugi::node_pcdata).set_value(objectSettings.HistoryPolicyToString().c_str());
+	settings.append_child("HistoryFrames").append_child(pugi::node_pcdata).set_value(std::to_string(objectSettings.historyFrames).c_str());
+	settings.append_child("HistoryAngle").append_child(pugi::node_pcdata).set_value(ExactString(objectSettings.historyAngle).c_str());
+	settings.append_child("DisplayType").append_child(pugi::node_pcdata).set_value(objectSettings.TypeToString().c_str());
 
-		std::string colorString = std::to_string(physics.objectSettings[i].color[0]) + "," +
-			std::to_string(physics.objectSettings[i].color[1]) + "," +
-			std::to_string(physics.objectSettings[i].color[2]);
-		settings.append_child("Color").append_child(pugi::node_pcdata).set_value(colorString.c_str());
+	std::string colorString = ExactString(objectSettings.color[0]) + "," +
+		ExactString(objectSettings.color[1]) + "," +
+		ExactString(objectSettings.color[2]);
+	settings.append_child("Color").append_child(pugi::node_pcdata).set_value(colorString.c_str());
+	if (objectSettings.texture != "")
+		settings.append_child("Texture").append_child(pugi::node_pcdata).set_value(objectSettings.texture.c_str());
 
-		if (objects[i].satellites.size() > 0)
+	if (object.satellites.size() > 0)
+	{
+		std::string satellites = "";
+		for (int j = 0; j < object.satellites.size(); j++)
 		{
-			std::string satellites = "";
-			for (int j = 0; j < objects[i].satellites.size(); j++)
-			{
-				if (j != 0)
-					satellites += ",";
-				satellites += objects[i].satellites[j];
-			}
-			objectNode.append_child("Satellites").append_child(pugi::node_pcdata).set_value(satellites.c_str());
+			if (j != 0)
+				satellites += ",";
+			satellites += object.satellites[j];
 		}
+		objectNode.append_child("Satellites").append_child(pugi::node_pcdata).set_value(satellites.c_str());
 	}
+}
 
-	xml.save_file(filename.c_str());
+SaveState Physics::GetSaveState(Physics* physics)
+{
+	SaveState state;
+	state.time = physics->time;
+	state.objects = physics->computedData[physics->dataIndex];
+	state.objectSettings = physics->objectSettings;
+	return state;
+}
+
+PhysObject Physics::InSaveUnits(PhysObject object)
+{
+	object.position.GetBaseValue(object.position.value);
+	object.position.unitIndex = 2;
+	object.velocity.GetBaseValue(object.velocity.value);
+	object.velocity.unitIndex = 4;
+	object.mass.SetBaseUnits();
+	object.radius.SetBaseUnits();
+	object.axialTilt.SetBaseUnits();
+	//converting to the same units could still round
+	if (object.rotationPeriod.unitIndex != 2)
+		object.rotationPeriod.ConvertToUnits(2);
+	return object;
+}
+
+bool Physics::OpenHistory(Physics* physics, std::string filename, std::vector<std::string> textureFolders, std::string* error)
+{
+	std::shared_ptr<HistoryFile> file = std::make_shared<HistoryFile>();
+	if (!file->Open(filename)) {
+		*error = "Not a history file, or a damaged one";
+		return false;
+	}
+	if (file->FrameCount() == 0) {
+		*error = "The history has no frames yet";
+		return false;
+	}
+	//frames are indexed with ints everywhere (the slider, the paths, the events), so longer runs can't be played back
+	if (file->FrameCount() > INT_MAX) {
+		*error = "The history has " + std::to_string(file->FrameCount()) + " frames, more than the " + std::to_string(INT_MAX) + " that can be played back";
+		return false;
+	}
+
+	pugi::xml_document doc;
+	if (!doc.load_buffer(file->scenario.data(), file->scenario.size()) || doc.select_nodes("/SavedState/Physics/Objects/PhysObject").size() != file->ObjectCount()) {
+		*error = "The scenario in the history doesn't match its frames";
+		return false;
+	}
+
+	FromXml(physics, doc, textureFolders);
+	std::vector<PhysObject> objects = physics->computedData[0];
+
+	physics->computedData.UseFile(file, 0, (int)file->FrameCount(), objects);
+	physics->time = physics->computedData.GetTime(0);
+	physics->epochTime = physics->time;
+	return true;
 }
 
 void Physics::step(float dt) {
 	if (dt == 0)
 		return;
 
-	std::vector<PhysObject> currentObjects = computedData[dataIndex];
+	std::vector<PhysObject> previousObjects = computedData[dataIndex];
+	std::vector<PhysObject> currentObjects = previousObjects;
+	double potentialEnergy;
+	Advance(dt, &currentObjects, &potentialEnergy);
+
+	computedData.push_back(currentObjects, computedData.GetTime(dataIndex) + dt);
+	dataIndex++;
+	events.ScanStep(previousObjects, computedData.GetTime(dataIndex - 1), currentObjects, computedData.GetTime(dataIndex));
+	FinishFrames();
+
+	//the potential energy comes free with the last force calculation of the step, and the rest is O(n)
+	if (conservation.size() == computedData.size() - 1)
+		conservation.push_back(MeasureConservation(currentObjects, potentialEnergy));
+
+	time += dt;
+}
+
+//moves objects forward by dt with the selected algorithm. Doesn't touch computedData, so it is safe to call from several threads at once
+void Physics::Advance(float dt, std::vector<PhysObject> * objects, double* potentialEnergy) {
 	switch (selectedAlgorithm) {
 		case VELOCITY_VERLET:
 		case RUNGE_KUTTA:
 		case RK_ADAPTIVE_STEPSIZE:
-			velocityVerlet(dt, &currentObjects);
+			velocityVerlet(dt, objects, potentialEnergy);
 	}
 
-	for (int i = 0; i < currentObjects.size(); i++) {
-		currentObjects[i].rotationDegrees += dt * 360.0f / currentObjects[i].rotationPeriod.GetBaseValue();
+	for (int i = 0; i < objects->size(); i++) {
+		(*objects)[i].rotationDegrees += dt * 360.0f / (*objects)[i].rotationPeriod.GetBaseValue();
 	}
+}
 
-	computedData.push_back(currentObjects);
-	dataIndex++;
+void Physics::FinishFrames() {
+	int last = refinedFrames >= 0 ? refinedFrames - 1 : computedData.size() - 1;
+	//the index has boxes for every frame, which would take as much memory as the frames in a file take disk
+	if (computedData.FileFrames() == 0) {
+		proximity.SetTolerance(historyTolerance);
+		proximity.Add(computedData, last);
+	}
+	//the newest frame is left alone, since the next step starts from it
+	if (historyTolerance > 0.0f)
+		computedData.Compress(last - 1, historyTolerance);
+}
 
-	time += dt;
+Timeline Physics::TakeTimeline() {
+	Timeline timeline;
+	timeline.frames = computedData;
+	timeline.paths.swap(paths);
+	timeline.pathFrames.swap(pathFrames);
+	timeline.pathStart = pathStart;
+	timeline.pathEnd = pathEnd;
+	timeline.pathWindow = pathWindow;
+	timeline.conservation.swap(conservation);
+	timeline.events.swap(events.log);
+	std::swap(timeline.proximity, proximity);
+	timeline.dataIndex = dataIndex;
+	timeline.epochIndex = epochIndex;
+	timeline.epochTime = epochTime;
+	timeline.refinedFrames = refinedFrames;
+	return timeline;
+}
+
+void Physics::RestoreTimeline(Timeline timeline) {
+	computedData = timeline.frames;
+	paths.swap(timeline.paths);
+	pathFrames.swap(timeline.pathFrames);
+	pathStart = timeline.pathStart;
+	pathEnd = timeline.pathEnd;
+	pathWindow = timeline.pathWindow;
+	conservation.swap(timeline.conservation);
+	events.log.swap(timeline.events);
+	std::swap(proximity, timeline.proximity);
+	dataIndex = std::max(0, std::min(timeline.dataIndex, computedData.size() - 1));
+	epochIndex = timeline.epochIndex;
+	epochTime = timeline.epochTime;
+	refinedFrames = timeline.refinedFrames;
+}
+
+//everything but the frames is copied, since the new branch needs its own to add to
+void Physics::BranchTimeline(std::string name) {
+	Timeline current = TakeTimeline();
+	Timeline branch = current;
+	current.name = timelines[currentTimeline].name;
+	timelines[currentTimeline] = std::move(current);
+
+	branch.name = name;
+	timelines.push_back(Timeline());
+	timelines.back().name = name;
+	currentTimeline = timelines.size() - 1;
+	RestoreTimeline(std::move(branch));
+}
+
+void Physics::SwitchTimeline(int index) {
+	if (index == currentTimeline || index < 0 || index >= timelines.size())
+		return;
+
+	Timeline current = TakeTimeline();
+	current.name = timelines[currentTimeline].name;
+	timelines[currentTimeline] = std::move(current);
+
+	Timeline next = std::move(timelines[index]);
+	timelines[index] = Timeline();
+	timelines[index].name = next.name;
+	currentTimeline = index;
+	RestoreTimeline(std::move(next));
+}
+
+float Physics::GetFrameTime(int index) {
+	return computedData.GetTime(index);
+}
+
+std::vector<PhysObject> Physics::StateAt(double t) {
+	int frame = computedData.FindFrame(t);
+	std::vector<PhysObject> objects = computedData[frame];
+	if (frame == computedData.size() - 1 || t <= computedData.GetTime(frame))
+		return objects;
+
+	std::vector<PhysObject> next = computedData[frame + 1];
+	std::vector<std::map<std::string, int> > units = Physics::ConvertObjectsToBaseUnits(&objects);
+	Physics::ConvertObjectsToBaseUnits(&next);
+
+	double h = computedData.GetTime(frame + 1) - computedData.GetTime(frame);
+	float s = (t - computedData.GetTime(frame)) / h;
+	for (int i = 0; i < objects.size(); i++)
+		Interpolate(objects[i], next[i], h, s, &objects[i]);
+
+	Physics::ConvertObjectsToUnits(&objects, units);
+	return objects;
+}
+
+//only copies the one object, so it doesn't depend on the number of objects either
+PhysObject Physics::StateAt(double t, int index) {
+	int frame = computedData.FindFrame(t);
+	std::vector<PhysObject> object = { computedData.GetObject(frame, index) };
+	if (frame == computedData.size() - 1 || t <= computedData.GetTime(frame))
+		return object[0];
+
+	std::vector<PhysObject> next = { computedData.GetObject(frame + 1, index) };
+	std::vector<std::map<std::string, int> > units = Physics::ConvertObjectsToBaseUnits(&object);
+	Physics::ConvertObjectsToBaseUnits(&next);
+
+	double h = computedData.GetTime(frame + 1) - computedData.GetTime(frame);
+	Interpolate(object[0], next[0], h, (t - computedData.GetTime(frame)) / h, &object[0]);
+
+	Physics::ConvertObjectsToUnits(&object, units);
+	return object[0];
+}
+
+void Physics::Interpolate(const PhysObject& start, const PhysObject& end, float h, float s, PhysObject* result) {
+	float position[3], velocity[3];
+	HermiteState(start, end, h, s, position, velocity);
+	float rotation = start.rotationDegrees + s * (end.rotationDegrees - start.rotationDegrees);
+
+	//result may be start or end
+	for (int k = 0; k < 3; k++) {
+		result->position.value[k] = position[k];
+		result->velocity.value[k] = velocity[k];
+	}
+	result->rotationDegrees = rotation;
 }
 
 std::vector<PhysObject> Physics::getCurrentObjects() {
@@ -176,29 +441,146 @@ std::vector<PhysObject> Physics::getCurrentObjects() {
 }
 
 #//returns 2d vector containing the net acceleration on each object
-std::vector<std::vector<float>> Physics::getAccelerations(std::vector<PhysObject> * objects) {
+//if potentialEnergy isn't null, the total potential energy gets summed up in the same pass over the pairs
+std::vector<std::vector<float>> Physics::getAccelerations(std::vector<PhysObject> * objects, double* potentialEnergy) {
 	if (objects->empty())
 		*objects = computedData[dataIndex];
 
+	int n = objects->size();
+	std::vector<float> positions(3 * n);
+	std::vector<float> masses(n);
+	for (int i = 0; i < n; i++) {
+		std::copy(std::begin((*objects)[i].position.value), std::end((*objects)[i].position.value), positions.begin() + 3 * i);
+		masses[i] = (*objects)[i].mass.value;
+	}
+
+	//each block of rows sums into its own buffer, so threads never write to the same memory.
+	//In fast mode there is one block per thread, so the order the buffers get added up in (and the rounding) changes with the thread count.
+	//In deterministic mode the blocks are fixed, and only which thread handles which block changes.
+	bool parallel = n >= PARALLEL_FORCE_THRESHOLD;
+	int blockCount = 1;
+	if (deterministic)
+		blockCount = DETERMINISTIC_BLOCKS;
+	else if (parallel)
+		blockCount = threadCount > 0 ? threadCount : ThreadPool::Shared().GetThreadCount();
+	blockCount = std::max(1, std::min(blockCount, n));
+
+	std::vector<int> rowStarts = GetBalancedRows(n, blockCount);
+	//kept between calls, so the buffers aren't allocated again every step. One set per thread, since copies of physics run on several at once.
+	//The lambdas below run on other threads, so they use the reference, not the thread_local itself
+	static thread_local std::vector<std::vector<float>> threadBlockSums;
+	std::vector<std::vector<float>>& blockSums = threadBlockSums;
+	blockSums.resize(std::max((int)blockSums.size(), blockCount));
+	for (int block = 0; block < blockCount; block++)
+		blockSums[block].assign(3 * n, 0.0f);
+	std::vector<double> blockPotentials(blockCount, 0.0);
+	int maxThreads = parallel ? threadCount : 1;
+
+	ThreadPool::Shared().ParallelFor(blockCount, [&](int block) {
+		AccumulatePairs(positions, masses, rowStarts[block], rowStarts[block + 1], &blockSums[block], potentialEnergy ? &blockPotentials[block] : nullptr);
+	}, maxThreads);
+
+	//pairwise tree reduction. Block b always gets added to block b - stride in the same order, no matter which thread does it
+	for (int stride = 1; stride < blockCount; stride *= 2) {
+		int pairCount = (blockCount - stride + 2 * stride - 1) / (2 * stride);
+		ThreadPool::Shared().ParallelFor(pairCount, [&](int pair) {
+			std::vector<float>& sum = blockSums[2 * stride * pair];
+			const std::vector<float>& other = blockSums[2 * stride * pair + stride];
+			for (int k = 0; k < 3 * n; k++)
+				sum[k] += other[k];
+			blockPotentials[2 * stride * pair] += blockPotentials[2 * stride * pair + stride];
+		}, maxThreads);
+	}
+
+	if (potentialEnergy)
+		*potentialEnergy = blockPotentials[0];
+
 	std::vector<std::vector<float>> accelerations = {};
-	for (int i = 0; i < objects->size(); i++) {
-		std::vector<float> acceleration = { 0,0,0 };
-		for (int j = 0; j < objects->size(); j++) {
-			if (i != j) {
-				float x1[3], x2[3];
-				std::copy(std::begin((*objects)[i].position.value), std::end((*objects)[i].position.value), std::begin(x1));
-				std::copy(std::begin((*objects)[j].position.value), std::end((*objects)[j].position.value), std::begin(x2));
-
-				float r = sqrt(pow(x1[0] - x2[0], 2) + pow(x1[1] - x2[1], 2) + pow(x1[2] - x2[2], 2));
-				float rUnit[3] = { (x1[0] - x2[0]) / r, (x1[1] - x2[1]) / r, (x1[2] - x2[2]) / r };
-				for (int k = 0; k < 3; k++)
-					acceleration[k] += -G * (*objects)[j].mass.value * rUnit[k] / pow(r, 2);
+	for (int i = 0; i < n; i++)
+		accelerations.push_back({ blockSums[0][3 * i], blockSums[0][3 * i + 1], blockSums[0][3 * i + 2] });
+
+	return accelerations;
+}
+
+//splits the rows of the (upper triangular) pair matrix into blockCount ranges with roughly the same number of pairs each.
+//row i has objectCount - 1 - i pairs, so the early rows are the expensive ones. Returns blockCount + 1 row boundaries
+std::vector<int> Physics::GetBalancedRows(int objectCount, int blockCount)
+{
+	std::vector<int> rowStarts = { 0 };
+	double totalPairs = 0.5 * objectCount * (objectCount - 1.0);
+	double pairsSoFar = 0;
+	int row = 0;
+	for (int block = 1; block < blockCount; block++) {
+		while (row < objectCount && pairsSoFar < totalPairs * block / blockCount) {
+			pairsSoFar += objectCount - 1 - row;
+			row++;
+		}
+		rowStarts.push_back(row);
+	}
+	rowStarts.push_back(objectCount);
+
+	return rowStarts;
+}
+
+//adds the acceleration from every pair (i, j > i) with firstRow <= i < lastRow into sums, and their potential energy into potential if it isn't null.
+//Each pair is only computed once, and applied to both objects
+void Physics::AccumulatePairs(const std::vector<float>& positions, const std::vector<float>& masses, int firstRow, int lastRow, std::vector<float>* sums, double* potential)
+{
+	int n = masses.size();
+	double potentialSum = 0.0;
+	for (int i = firstRow; i < lastRow; i++) {
+		for (int j = i + 1; j < n; j++) {
+			float d[3] = {
+				positions[3 * i] - positions[3 * j],
+				positions[3 * i + 1] - positions[3 * j + 1],
+				positions[3 * i + 2] - positions[3 * j + 2]
+			};
+
+			float r = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			float scale = G / (r * r * r);
+			for (int k = 0; k < 3; k++) {
+				(*sums)[3 * i + k] += -masses[j] * scale * d[k];
+				(*sums)[3 * j + k] += masses[i] * scale * d[k];
 			}
+			//-G m1 m2 / r, from the scale that's already there instead of another division
+			if (potential)
+				potentialSum -= (double)scale * r * r * masses[i] * masses[j];
 		}
-		accelerations.push_back(acceleration);
 	}
 
-	return accelerations;
+	if (potential)
+		*potential += potentialSum;
+}
+
+ReductionBenchmark Physics::BenchmarkReductions(int iterations)
+{
+	std::vector<PhysObject> objects = getCurrentObjects();
+	Physics::ConvertObjectsToBaseUnits(&objects);
+
+	//the modes are switched on a physics of its own, since a background computation may be stepping this one
+	Physics bench;
+	bench.threadCount = threadCount;
+	ReductionBenchmark result;
+
+	bench.deterministic = false;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++)
+		bench.getAccelerations(&objects);
+	auto end = std::chrono::high_resolution_clock::now();
+	result.fastMilliseconds = std::chrono::duration<float, std::milli>(end - start).count() / iterations;
+
+	bench.deterministic = true;
+	start = std::chrono::high_resolution_clock::now();
+	std::vector<std::vector<float>> parallelAccelerations;
+	for (int i = 0; i < iterations; i++)
+		parallelAccelerations = bench.getAccelerations(&objects);
+	end = std::chrono::high_resolution_clock::now();
+	result.deterministicMilliseconds = std::chrono::duration<float, std::milli>(end - start).count() / iterations;
+
+	bench.threadCount = 1;
+	result.parallel = objects.size() >= PARALLEL_FORCE_THRESHOLD;
+	result.reproducible = bench.getAccelerations(&objects) == parallelAccelerations;
+	return result;
 }
 
 std::vector<std::map<std::string, int> > Physics::ConvertObjectsToBaseUnits(std::vector<PhysObject>* objects)
@@ -235,54 +617,246 @@ void Physics::ConvertObjectsToUnits(std::vector<PhysObject>* objects, std::vecto
 
 void Physics::updatePaths(bool firstFrame) {
 	std::vector<PhysObject> currentObjects = getCurrentObjects();
+	std::vector<float> offsets = GetFocusOffsets(currentObjects);
 	if (firstFrame) {
-		paths = {};
-		for (int i = 0; i < currentObjects.size(); i++) {
-			std::vector<float> offsets = GetFocusOffsets(currentObjects);
-
-			paths.push_back({
-				currentObjects[i].position.GetBaseValue(0) - offsets[0],
-				currentObjects[i].position.GetBaseValue(1) - offsets[1],
-				currentObjects[i].position.GetBaseValue(2) - offsets[2],
-			});
+		paths = std::vector<std::vector<float> >(currentObjects.size());
+		pathFrames = std::vector<std::vector<int> >(currentObjects.size());
+		pathStart = dataIndex;
+		pathEnd = dataIndex;
+		pathWindow = 0;
+	}
+
+	for (int i = 0; i < currentObjects.size(); i++) {
+		float point[3];
+		for (int k = 0; k < 3; k++)
+			point[k] = currentObjects[i].position.GetBaseValue(k) - offsets[k];
+		AddPathPoint(i, dataIndex, point);
+	}
+	pathEnd = dataIndex + 1;
+}
+
+//objects that don't keep every frame are sampled again from first on, and keep their points after last
+void Physics::UpdatePathFrames(int first, int last) {
+	first = std::max(first, pathStart);
+	if (last < first)
+		return;
+
+	std::vector<std::vector<float> > tailPoints(paths.size());
+	std::vector<std::vector<int> > tailFrames(paths.size());
+	for (int i = 0; i < paths.size(); i++) {
+		if (objectSettings[i].historyPolicy == HISTORY_FULL) {
+			paths[i].resize(std::max((int)paths[i].size(), 3 * (last + 1 - pathStart)));
+			continue;
+		}
+
+		int kept = std::lower_bound(pathFrames[i].begin(), pathFrames[i].end(), first) - pathFrames[i].begin();
+		int after = std::upper_bound(pathFrames[i].begin(), pathFrames[i].end(), last) - pathFrames[i].begin();
+		tailPoints[i].assign(paths[i].begin() + 3 * after, paths[i].end());
+		tailFrames[i].assign(pathFrames[i].begin() + after, pathFrames[i].end());
+		paths[i].resize(3 * kept);
+		pathFrames[i].resize(kept);
+	}
+
+	//the frames HISTORY_RECENT would only drop again aren't sampled
+	int end = std::max(pathEnd, last + 1);
+	for (int f = first; f <= last; f++) {
+		const std::vector<PhysObject>& objects = computedData[f];
+		std::vector<float> offsets = GetFocusOffsets(objects);
+		for (int i = 0; i < paths.size(); i++) {
+			if (objectSettings[i].historyPolicy == HISTORY_NONE || (objectSettings[i].historyPolicy == HISTORY_RECENT && f < end - objectSettings[i].historyFrames))
+				continue;
+
+			ValueWithUnits3<UnitType::Distance> position = objects[i].position;
+			float point[3];
+			for (int k = 0; k < 3; k++)
+				point[k] = position.GetBaseValue(k) - offsets[k];
+
+			if (objectSettings[i].historyPolicy == HISTORY_FULL)
+				std::copy(point, point + 3, paths[i].begin() + 3 * (f - pathStart));
+			else
+				AddPathPoint(i, f, point);
 		}
+	}
+
+	for (int i = 0; i < paths.size(); i++) {
+		paths[i].insert(paths[i].end(), tailPoints[i].begin(), tailPoints[i].end());
+		pathFrames[i].insert(pathFrames[i].end(), tailFrames[i].begin(), tailFrames[i].end());
+	}
+	pathEnd = std::max(pathEnd, last + 1);
+}
+
+void Physics::RebuildPath(int index) {
+	paths[index] = {};
+	pathFrames[index] = {};
+	const ObjectSettings& settings = objectSettings[index];
+	if (settings.historyPolicy == HISTORY_NONE)
+		return;
+
+	int first = settings.historyPolicy == HISTORY_RECENT ? std::max(pathStart, pathEnd - settings.historyFrames) : pathStart;
+	if (settings.historyPolicy == HISTORY_FULL)
+		paths[index].reserve(3 * (pathEnd - pathStart));
 
+	//only the object and the origin are read, so frames that are compressed or in a file don't get decoded
+	for (int f = first; f < pathEnd; f++) {
+		PhysObject object = computedData.GetObject(f, index);
+		float point[3];
+		for (int k = 0; k < 3; k++)
+			point[k] = object.position.GetBaseValue(k);
+		if (origin > 0) {
+			PhysObject focus = computedData.GetObject(f, origin - 1);
+			for (int k = 0; k < 3; k++)
+				point[k] -= focus.position.GetBaseValue(k);
+		}
+		AddPathPoint(index, f, point);
 	}
-	else {
-		for (int i = 0; i < currentObjects.size(); i++) {
-			std::vector<float> offsets = GetFocusOffsets(currentObjects);
+}
 
-			paths[i].push_back(currentObjects[i].position.GetBaseValue(0) - offsets[0]);
-			paths[i].push_back(currentObjects[i].position.GetBaseValue(1) - offsets[1]);
-			paths[i].push_back(currentObjects[i].position.GetBaseValue(2) - offsets[2]);
+void Physics::TruncatePaths(int frameCount) {
+	for (int i = 0; i < paths.size(); i++) {
+		if (objectSettings[i].historyPolicy == HISTORY_FULL)
+			paths[i].resize(std::min((int)paths[i].size(), 3 * std::max(frameCount - pathStart, 0)));
+		else {
+			int kept = std::lower_bound(pathFrames[i].begin(), pathFrames[i].end(), frameCount) - pathFrames[i].begin();
+			paths[i].resize(3 * kept);
+			pathFrames[i].resize(kept);
 		}
 	}
+	pathEnd = std::min(pathEnd, frameCount);
+	pathStart = std::min(pathStart, frameCount);
+	pathEnd = std::max(pathEnd, pathStart);
+}
+
+void Physics::ErasePathFront(int frameCount) {
+	TrimPaths(frameCount);
+	pathStart -= frameCount;
+	pathEnd -= frameCount;
+	for (int i = 0; i < pathFrames.size(); i++)
+		for (int p = 0; p < pathFrames[i].size(); p++)
+			pathFrames[i][p] -= frameCount;
+}
+
+int Physics::PathPointsUpTo(int index, int frame) {
+	if (objectSettings[index].historyPolicy == HISTORY_FULL)
+		return std::max(0, std::min(frame + 1 - pathStart, (int)paths[index].size() / 3));
+	return std::upper_bound(pathFrames[index].begin(), pathFrames[index].end(), frame) - pathFrames[index].begin();
+}
+
+//playing forward adds points, and drops the oldest a quarter of the window at a time. Anywhere else, they are built again around dataIndex
+void Physics::UpdatePathWindow() {
+	if (paths.empty() || pathWindow <= 0)
+		return;
+
+	//an edit can cut the history off before the end of the paths
+	TruncatePaths(computedData.size());
+	int first = std::max(dataIndex - pathWindow, 0);
+	if (dataIndex < pathStart || first > pathEnd) {
+		TruncatePaths(0);
+		pathStart = first;
+		pathEnd = first;
+	}
+
+	if (dataIndex >= pathEnd)
+		UpdatePathFrames(pathEnd, dataIndex);
+
+	if (first - pathStart >= std::max(pathWindow / 4, 1))
+		TrimPaths(first);
+}
+
+//the point for frame, which has to come after every point the path already has
+void Physics::AddPathPoint(int index, int frame, const float point[3]) {
+	std::vector<float>& path = paths[index];
+	std::vector<int>& frames = pathFrames[index];
+	const ObjectSettings& settings = objectSettings[index];
+
+	if (settings.historyPolicy == HISTORY_NONE)
+		return;
+	if (settings.historyPolicy == HISTORY_FULL) {
+		path.insert(path.end(), point, point + 3);
+		return;
+	}
+
+	//the last point always follows the newest frame. It stays where it is once the path from the point before it
+	//has turned more than historyAngle, so straight stretches get one segment, and tight turns get as many as they need
+	int count = frames.size();
+	if (settings.historyPolicy == HISTORY_ADAPTIVE && count >= 2) {
+		const float* a = &path[3 * (count - 2)];
+		float* b = &path[3 * (count - 1)];
+		float chord[3], step[3];
+		for (int k = 0; k < 3; k++) {
+			chord[k] = b[k] - a[k];
+			step[k] = point[k] - b[k];
+		}
+		float dot = chord[0] * step[0] + chord[1] * step[1] + chord[2] * step[2];
+		float lengths = sqrtf((chord[0] * chord[0] + chord[1] * chord[1] + chord[2] * chord[2]) * (step[0] * step[0] + step[1] * step[1] + step[2] * step[2]));
+		if (lengths == 0.0f || dot >= lengths * cosf(settings.historyAngle * 3.14159265f / 180.0f)) {
+			std::copy(point, point + 3, b);
+			frames[count - 1] = frame;
+			return;
+		}
+	}
+
+	path.insert(path.end(), point, point + 3);
+	frames.push_back(frame);
+
+	//dropped a quarter at a time, like the frames of a stream, so the front isn't erased every frame
+	if (settings.historyPolicy == HISTORY_RECENT) {
+		int old = std::lower_bound(frames.begin(), frames.end(), frame - settings.historyFrames + 1) - frames.begin();
+		if (old >= std::max(settings.historyFrames / 4, 1)) {
+			path.erase(path.begin(), path.begin() + 3 * old);
+			frames.erase(frames.begin(), frames.begin() + old);
+		}
+	}
+}
+
+//drops the points before frame first
+void Physics::TrimPaths(int first) {
+	for (int i = 0; i < paths.size(); i++) {
+		int old;
+		if (objectSettings[i].historyPolicy == HISTORY_FULL)
+			old = std::max(0, std::min(first - pathStart, (int)paths[i].size() / 3));
+		else {
+			old = std::lower_bound(pathFrames[i].begin(), pathFrames[i].end(), first) - pathFrames[i].begin();
+			pathFrames[i].erase(pathFrames[i].begin(), pathFrames[i].begin() + old);
+		}
+		paths[i].erase(paths[i].begin(), paths[i].begin() + 3 * old);
+	}
+	pathStart = std::max(pathStart, first);
+	pathEnd = std::max(pathEnd, pathStart);
 }
 
 //source: http://physics.ucsc.edu/~peter/242/leapfrog.pdf
-void Physics::velocityVerlet(float dt, std::vector<PhysObject> * currentObjects) {
+//if potentialEnergy isn't null, it's set to the potential energy at the end of the step
+void Physics::velocityVerlet(float dt, std::vector<PhysObject> * currentObjects, double* potentialEnergy) {
 	std::vector<std::map<std::string, int> > originalUnits = Physics::ConvertObjectsToBaseUnits(currentObjects);
 	std::vector<std::vector<float>> accelerations = getAccelerations(currentObjects);
 
 	for (int i = 0; i < currentObjects->size(); i++) {
-		for (int j = 0; j < 3; j++) {
-			//get velocities of objects at + 1/2 timestep.
-			(*currentObjects)[i].velocity.value[j] += .5 * dt * accelerations[i][j];
-			//get position at +1 timestep, using velocity at half timestep
-			(*currentObjects)[i].position.value[j] += dt * (*currentObjects)[i].velocity.value[j];
-		}
+		//get velocities of objects at + 1/2 timestep.
+		HalfKick(dt, accelerations[i].data(), (*currentObjects)[i].velocity.value, 3);
+		//get position at +1 timestep, using velocity at half timestep
+		Drift(dt, (*currentObjects)[i].velocity.value, (*currentObjects)[i].position.value, 3);
 	}
 
-	accelerations = getAccelerations(currentObjects);
+	accelerations = getAccelerations(currentObjects, potentialEnergy);
 	for (int i = 0; i < currentObjects->size(); i++) {
-		for (int j = 0; j < 3; j++) {
-			(*currentObjects)[i].velocity.value[j] += .5 * dt * accelerations[i][j];
-		}
+		HalfKick(dt, accelerations[i].data(), (*currentObjects)[i].velocity.value, 3);
 	}
 
 	Physics::ConvertObjectsToUnits(currentObjects, originalUnits);
 }
 
+//the two halves of a velocity verlet step, on count independent components.
+//Shared with BatchIntegrator, which runs them over whole arrays of lanes at once
+void Physics::HalfKick(float dt, const float* accelerations, float* velocities, int count) {
+	for (int k = 0; k < count; k++)
+		velocities[k] += .5 * dt * accelerations[k];
+}
+
+void Physics::Drift(float dt, const float* velocities, float* positions, int count) {
+	for (int k = 0; k < count; k++)
+		positions[k] += dt * velocities[k];
+}
+
 std::vector<std::string> Physics::GetObjectNames() {
 	std::vector<PhysObject> currentObjects = getCurrentObjects();
 	std::vector<std::string> names = { "None" };
@@ -292,13 +866,14 @@ std::vector<std::string> Physics::GetObjectNames() {
 	return names;
 }
 
-std::vector<float> Physics::GetFocusOffsets(std::vector <PhysObject> objects) {
+std::vector<float> Physics::GetFocusOffsets(const std::vector<PhysObject>& objects) {
 	float xOffset = 0, yOffset = 0, zOffset = 0;
 	if (origin > 0) {
 		//-1 since the first is "no focus"
-		xOffset = objects[origin-1].position.GetBaseValue(0);
-		yOffset = objects[origin-1].position.GetBaseValue(1);
-		zOffset = objects[origin-1].position.GetBaseValue(2);
+		ValueWithUnits3<UnitType::Distance> position = objects[origin-1].position;
+		xOffset = position.GetBaseValue(0);
+		yOffset = position.GetBaseValue(1);
+		zOffset = position.GetBaseValue(2);
 	}
 
 	return{ xOffset, yOffset, zOffset };
@@ -309,4 +884,147 @@ PhysObject Physics::GetObjectByName(std::string name)
 	std::vector<PhysObject> objects = getCurrentObjects();
 	auto it = std::find_if(objects.begin(), objects.end(), [&name](const PhysObject& obj) {return obj.name == name; });
 	return *it;
-}
\ No newline at end of file
+}
+
+//the object that index orbits: whichever object lists it as a satellite, otherwise the most massive object.
+//Returns -1 for the most massive object itself. objects must be in base units
+int Physics::GetPrimaryIndex(const std::vector<PhysObject>& objects, int index)
+{
+	int heaviest = -1;
+	for (int i = 0; i < objects.size(); i++) {
+		const std::vector<std::string>& satellites = objects[i].satellites;
+		if (std::find(satellites.begin(), satellites.end(), objects[index].name) != satellites.end())
+			return i;
+
+		if (heaviest == -1 || objects[i].mass.value > objects[heaviest].mass.value)
+			heaviest = i;
+	}
+
+	return heaviest == index ? -1 : heaviest;
+}
+
+//elements of objects[index] around its primary. objects must be in base units
+OrbitalElements Physics::GetOrbitalElements(const std::vector<PhysObject>& objects, int index)
+{
+	int primary = GetPrimaryIndex(objects, index);
+	if (primary == -1)
+		return OrbitalElements();
+
+	float position[3], velocity[3];
+	for (int k = 0; k < 3; k++) {
+		position[k] = objects[index].position.value[k] - objects[primary].position.value[k];
+		velocity[k] = objects[index].velocity.value[k] - objects[primary].velocity.value[k];
+	}
+
+	return OrbitalElements::FromState(G * (objects[primary].mass.value + objects[index].mass.value), position, velocity);
+}
+
+//kinetic plus potential energy, in Kg * Gm^2 / Years^2. Summed in doubles, since the potential and kinetic parts mostly cancel
+double Physics::GetEnergy(const std::vector<PhysObject>& objects)
+{
+	double energy = GetKineticEnergy(objects);
+	for (int i = 0; i < objects.size(); i++) {
+		for (int j = i + 1; j < objects.size(); j++) {
+			double d[3];
+			for (int k = 0; k < 3; k++)
+				d[k] = (double)objects[i].position.value[k] - objects[j].position.value[k];
+			energy -= (double)G * objects[i].mass.value * objects[j].mass.value / sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+		}
+	}
+
+	return energy;
+}
+
+double Physics::GetKineticEnergy(const std::vector<PhysObject>& objects)
+{
+	double energy = 0.0;
+	for (int i = 0; i < objects.size(); i++) {
+		const float* v = objects[i].velocity.value;
+		energy += 0.5 * objects[i].mass.value * ((double)v[0] * v[0] + (double)v[1] * v[1] + (double)v[2] * v[2]);
+	}
+
+	return energy;
+}
+
+//sum of m r x v about the origin
+void Physics::GetAngularMomentum(const std::vector<PhysObject>& objects, double momentum[3])
+{
+	std::fill(momentum, momentum + 3, 0.0);
+	for (int i = 0; i < objects.size(); i++) {
+		const float* r = objects[i].position.value;
+		const float* v = objects[i].velocity.value;
+		double m = objects[i].mass.value;
+		momentum[0] += m * ((double)r[1] * v[2] - (double)r[2] * v[1]);
+		momentum[1] += m * ((double)r[2] * v[0] - (double)r[0] * v[2]);
+		momentum[2] += m * ((double)r[0] * v[1] - (double)r[1] * v[0]);
+	}
+}
+
+//starts a new conservation series with the current frame as the reference. Needs one full O(n^2) energy calculation
+void Physics::ResetConservation()
+{
+	std::vector<PhysObject> objects = getCurrentObjects();
+	Physics::ConvertObjectsToBaseUnits(&objects);
+
+	conservationStart = ConservedTotals();
+	conservationStart.energy = GetEnergy(objects);
+	GetAngularMomentum(objects, conservationStart.angularMomentum);
+	for (int i = 0; i < objects.size(); i++) {
+		for (int k = 0; k < 3; k++) {
+			conservationStart.momentum[k] += (double)objects[i].mass.value * objects[i].velocity.value[k];
+			conservationStart.momentumScale += fabs((double)objects[i].mass.value * objects[i].velocity.value[k]);
+		}
+	}
+
+	conservation = { MeasureConservation(getCurrentObjects(), conservationStart.energy - GetKineticEnergy(objects)) };
+}
+
+//measures objects against conservationStart. Everything but the potential energy is O(n)
+ConservationSample Physics::MeasureConservation(std::vector<PhysObject> objects, double potentialEnergy)
+{
+	Physics::ConvertObjectsToBaseUnits(&objects);
+
+	ConservationSample sample;
+	sample.kineticEnergy = GetKineticEnergy(objects);
+	sample.potentialEnergy = potentialEnergy;
+	sample.energyError = fabs((sample.kineticEnergy + potentialEnergy - conservationStart.energy) / conservationStart.energy);
+
+	double momentum[3] = { 0.0, 0.0, 0.0 }, angularMomentum[3];
+	for (int i = 0; i < objects.size(); i++)
+		for (int k = 0; k < 3; k++)
+			momentum[k] += (double)objects[i].mass.value * objects[i].velocity.value[k];
+	GetAngularMomentum(objects, angularMomentum);
+
+	double momentumDrift = 0.0, angularMomentumDrift = 0.0, angularMomentumStart = 0.0;
+	for (int k = 0; k < 3; k++) {
+		momentumDrift += (momentum[k] - conservationStart.momentum[k]) * (momentum[k] - conservationStart.momentum[k]);
+		angularMomentumDrift += (angularMomentum[k] - conservationStart.angularMomentum[k]) * (angularMomentum[k] - conservationStart.angularMomentum[k]);
+		angularMomentumStart += conservationStart.angularMomentum[k] * conservationStart.angularMomentum[k];
+	}
+	sample.momentumError = conservationStart.momentumScale > 0.0 ? sqrt(momentumDrift) / conservationStart.momentumScale : 0.0;
+	sample.angularMomentumError = angularMomentumStart > 0.0 ? sqrt(angularMomentumDrift / angularMomentumStart) : 0.0;
+
+	return sample;
+}
+
+//measures every frame from scratch, for frames that were computed without the serial step. referenceIndex is the frame the errors are relative to
+void Physics::RebuildConservation(int referenceIndex)
+{
+	int originalIndex = dataIndex;
+	dataIndex = referenceIndex;
+	ResetConservation();
+	dataIndex = originalIndex;
+
+	ConservationSample reference = conservation[0];
+	conservation = {};
+	for (int i = 0; i < computedData.size(); i++) {
+		if (i == referenceIndex) {
+			conservation.push_back(reference);
+			continue;
+		}
+
+		std::vector<PhysObject> objects = computedData[i];
+		Physics::ConvertObjectsToBaseUnits(&objects);
+		conservation.push_back(MeasureConservation(computedData[i], GetEnergy(objects) - GetKineticEnergy(objects)));
+	}
+}
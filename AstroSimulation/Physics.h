@@ -6,6 +6,11 @@
 #include "ObjectSettings.h"
 #include "pugixml/pugixml.hpp"
 #include "ValueWithUnits.h"
+#include "ThreadPool.h"
+#include "OrbitalElements.h"
+#include "FrameHistory.h"
+#include "Events.h"
+#include "ProximityIndex.h"
 
 #include <fstream>
 #include <iostream>
@@ -17,6 +22,70 @@
 #define RUNGE_KUTTA 1
 #define RK_ADAPTIVE_STEPSIZE 2
 
+//number of accumulation blocks used by the force calculation in deterministic mode. Fixed, so the summation order never depends on the thread count
+#define DETERMINISTIC_BLOCKS 32
+//below this many objects, waking up threads costs more than the force calculation itself
+#define PARALLEL_FORCE_THRESHOLD 64
+
+//conserved quantities of one frame, compared to the frame the computation started from
+struct ConservationSample
+{
+	//Kg * Gm^2 / Years^2
+	double kineticEnergy = 0.0;
+	double potentialEnergy = 0.0;
+	//relative changes since the start. Total momentum is usually close to zero, so its change is relative to the sum of |m v| instead
+	float energyError = 0.0f;
+	float momentumError = 0.0f;
+	float angularMomentumError = 0.0f;
+};
+
+//totals at the start of a conservation series
+struct ConservedTotals
+{
+	double energy = 0.0;
+	double momentum[3] = { 0.0, 0.0, 0.0 };
+	double momentumScale = 0.0;
+	double angularMomentum[3] = { 0.0, 0.0, 0.0 };
+};
+
+//what a save file has: one frame, and the settings of its objects. Copied out of physics, so it can be written on another thread
+struct SaveState
+{
+	float time = 0.0f;
+	std::vector<PhysObject> objects;
+	std::vector<ObjectSettings> objectSettings;
+};
+
+//one line of computed history, with everything that goes along with its frames. Physics keeps the current one in its own members
+struct Timeline
+{
+	std::string name;
+	FrameHistory frames;
+	std::vector<std::vector<float> > paths;
+	std::vector<std::vector<int> > pathFrames;
+	int pathStart = 0;
+	int pathEnd = 0;
+	int pathWindow = 0;
+	std::vector<ConservationSample> conservation;
+	std::vector<EventRecord> events;
+	ProximityIndex proximity;
+	int dataIndex = 0;
+	int epochIndex = 0;
+	float epochTime = 0.0f;
+	int refinedFrames = -1;
+};
+
+//average time per force evaluation in both reduction modes, measured on the current frame
+struct ReductionBenchmark
+{
+	float fastMilliseconds = 0.0f;
+	float deterministicMilliseconds = 0.0f;
+	//true if deterministic mode gave bit-identical accelerations on 1 thread and on all threads
+	bool reproducible = false;
+	//below PARALLEL_FORCE_THRESHOLD objects the force pass always runs on one thread, so reproducible is true without meaning anything
+	bool parallel = false;
+};
+
 class Physics
 {
 public:
@@ -24,48 +93,154 @@ public:
 	~Physics();
 
 	void step(float dt);
-	void velocityVerlet(float dt, std::vector<PhysObject> * currentObjects);
-	std::vector<std::vector<float>> getAccelerations(std::vector<PhysObject> * objects = {});
+	void Advance(float dt, std::vector<PhysObject> * objects, double* potentialEnergy = nullptr);
+	void velocityVerlet(float dt, std::vector<PhysObject> * currentObjects, double* potentialEnergy = nullptr);
+	static void HalfKick(float dt, const float* accelerations, float* velocities, int count);
+	static void Drift(float dt, const float* velocities, float* positions, int count);
+	std::vector<std::vector<float>> getAccelerations(std::vector<PhysObject> * objects = {}, double* potentialEnergy = nullptr);
 	std::vector<PhysObject> getCurrentObjects();
+	ReductionBenchmark BenchmarkReductions(int iterations);
+	//a save file of either kind, xml or a binary snapshot (by its extension). False if it couldn't be read
+	static bool Load(Physics* physics, std::string filename, std::vector<std::string> textureFolders);
 	static void FromXml(Physics* physics, std::string filename, std::vector<std::string> textureFolders);
-	static void ToXml(Physics physics, std::string filename);
+	static void FromXml(Physics* physics, const pugi::xml_document& doc, std::vector<std::string> textureFolders);
+	static void ToXml(Physics* physics, pugi::xml_document* xml);
+	//one PhysObject element, added to the Objects element of a save
+	static void ObjectToXml(pugi::xml_node objectsNode, const PhysObject& object, const ObjectSettings& settings);
+	//the current frame, which is all a save needs from the history
+	static SaveState GetSaveState(Physics* physics);
+	//floats in save files get every digit they need to be read back exactly
+	static std::string ExactString(float value);
+	//starts over with just objects at time, which is what loading a save file does
+	static void LoadScenario(Physics* physics, float time, std::vector<PhysObject> objects, std::vector<ObjectSettings> objectSettings);
+	//object with every value in the units save files have (the units FromXml gives them): base units, and days for the rotation period
+	static PhysObject InSaveUnits(PhysObject object);
+	//plays back a history file written by streaming. Its frames stay in the file, and are only read as playback gets to them.
+	//Sets error and leaves physics alone if the file can't be played back, which includes files with more frames than an int can index
+	static bool OpenHistory(Physics* physics, std::string filename, std::vector<std::string> textureFolders, std::string* error);
 
 	static std::vector<std::map<std::string, int> > ConvertObjectsToBaseUnits(std::vector<PhysObject>* objects);
 	static void ConvertObjectsToUnits(std::vector<PhysObject>* objects, std::vector<std::map<std::string, int> > units);
 
+	static std::vector<std::string> SplitString(std::string str, std::string delimiter);
 	std::vector<std::string> GetObjectNames();
-	std::vector<float> GetFocusOffsets(std::vector <PhysObject> objects);
+	std::vector<float> GetFocusOffsets(const std::vector<PhysObject>& objects);
 	PhysObject GetObjectByName(std::string name);
+	static int GetPrimaryIndex(const std::vector<PhysObject>& objects, int index);
+	OrbitalElements GetOrbitalElements(const std::vector<PhysObject>& objects, int index);
+	//conserved quantities, for measuring integration error. objects must be in base units
+	double GetEnergy(const std::vector<PhysObject>& objects);
+	static double GetKineticEnergy(const std::vector<PhysObject>& objects);
+	static void GetAngularMomentum(const std::vector<PhysObject>& objects, double momentum[3]);
 	//keep objects and objectSettings as separate vectors, because I want 
 	//PhysObject to contain only the fundamental object data, rather than
 	//get cluttered up with ui info.
 	std::vector<ObjectSettings> objectSettings;
-	std::vector<std::vector<PhysObject>> computedData;
+	FrameHistory computedData;
 
 	void updatePaths(bool firstFrame);
+	//recomputes the path points of frames first to last, adding them if the paths are shorter than that
+	void UpdatePathFrames(int first, int last);
+	//samples the path of one object again, after its history policy changed
+	void RebuildPath(int index);
+	//forgets the points of frames from frameCount on
+	void TruncatePaths(int frameCount);
+	//for frames dropped from the front of computedData. The frames left are numbered from 0 again
+	void ErasePathFront(int frameCount);
+	//points of path index that are at or before frame, which are the ones drawn while frame is showing
+	int PathPointsUpTo(int index, int frame);
+	//for histories too long to have a path point for every frame: keeps the paths on the pathWindow frames up to dataIndex
+	void UpdatePathWindow();
+	//one list of points (gigameters, from the origin) per object. How many frames get a point depends on the object's historyPolicy
 	std::vector<std::vector<float> > paths;
-
-	//used to store previous data when in the middle of computing new set. Needed so that "Cancel" button can reset everything
-	std::vector<std::vector<PhysObject>> temporaryData;
-	int temporaryIndex;
+	//frame of every point of paths[i], for objects that don't keep a point for every frame. With HISTORY_FULL, point k is frame pathStart + k
+	std::vector<std::vector<int> > pathFrames;
+	//frames pathStart to pathEnd - 1 have been added to the paths
+	int pathStart = 0;
+	int pathEnd = 0;
+	//0 = the paths have every frame
+	int pathWindow = 0;
+	//frames from the start of computedData that are final. The rest are a preview that is still being refined. -1 = everything is final
+	int refinedFrames = -1;
+	//event functions and the events found in computedData so far
+	Events events;
+	//close approach queries over computedData. Only final frames are indexed, so it stops where a progressive preview starts
+	ProximityIndex proximity;
+	//full chunks of final frames are compressed to within this many gigameters. 0 (the default) keeps every frame as it is,
+	//since compressed frames are only close to the computed ones
+	float historyTolerance = 0.0f;
+	//call whenever more frames of computedData are final. Indexes them and compresses the chunks that are full
+	void FinishFrames();
+
+	//used to store previous data when in the middle of computing new set. Needed so that "Cancel" button can reset everything.
+	//It shares its frames with the history it came from, but holds the old paths and conservation series, so it's released once the computation is kept
+	Timeline temporaryData;
+
+	//moves the current history (frames, paths, conservation series, events and indices) out into a Timeline, or back in. Both are O(1)
+	Timeline TakeTimeline();
+	void RestoreTimeline(Timeline timeline);
+	//copies the current timeline, sharing all of its frames, and switches to the copy. Switching doesn't copy anything.
+	//The paths, conservation series, events and proximity index are copied though, since the branch adds to its own from the edit on.
+	//That's O(frames so far) per branch, but a few floats per frame and object against the frames themselves.
+	//The current timeline lives in the members above, so timelines[currentTimeline] only has its name
+	void BranchTimeline(std::string name);
+	void SwitchTimeline(int index);
+	std::vector<Timeline> timelines;
+	int currentTimeline = 0;
 
 	ValueWithUnits<UnitType::Time> timestep = ValueWithUnits<UnitType::Time>(0.1f, 2);
 	ValueWithUnits<UnitType::Time> totalTime = ValueWithUnits<UnitType::Time>(.15f, 0);
+	//how far before the starting frame to compute, in bidirectional mode
+	ValueWithUnits<UnitType::Time> backwardTime = ValueWithUnits<UnitType::Time>(0.0f, 0);
 
 	int playbackSpeed;
 	int dataIndex;
 	float time;
 
+	//computedData[epochIndex] is the frame the last computation started from, at time epochTime.
+	//Frames before it (from a backward computation) have earlier times
+	int epochIndex = 0;
+	float epochTime = 0.0f;
+	//every frame stores its own time, so steps don't have to be the same size
+	float GetFrameTime(int index);
+
+	//dense output: the objects at any time between two frames, from the cubic hermite curve through both frames' positions and velocities.
+	//That curve is the continuous extension of velocity verlet, and matches the frames exactly. Finding the frames is a binary search,
+	//so either one costs O(log frames). Times outside the computed frames get the first or last frame
+	std::vector<PhysObject> StateAt(double t);
+	PhysObject StateAt(double t, int index);
+	//s is the fraction of the way from start to end, which are h apart in time. All three must be in base units
+	static void Interpolate(const PhysObject& start, const PhysObject& end, float h, float s, PhysObject* result);
+
 	//index of the object to be used as the origin of the coordinate system. index 0 = CoM of the system
 	int origin;
 
+	//one sample per frame of computedData, while it's being computed one step at a time
+	std::vector<ConservationSample> conservation;
+	ConservedTotals conservationStart;
+	//relative energy error that pauses the computation. 0 = never
+	float conservationWarning = 0.0001f;
+	void ResetConservation();
+	void RebuildConservation(int referenceIndex);
+	ConservationSample MeasureConservation(std::vector<PhysObject> objects, double potentialEnergy);
+
+	//when true, accelerations are bit-identical regardless of threadCount, at the cost of some extra reduction work
+	bool deterministic = false;
+	//number of threads used for the force calculation. 0 = every thread in the pool
+	int threadCount = 0;
+
 	int selectedAlgorithm;
 	const char* algorithms[3] = { "Velocity Verlet", "Runge Kutta 4", "RK45 with Adaptive Stepsize" };
 
-private:
-	static std::vector<std::string> SplitString(std::string str, std::string delimiter);
+	//gravitational constant in base units (Gm^3 / (Kg * Years^2))
 	const float G = 9.94519 * pow(10, 14) * 6.67408 * pow(10, -11) / pow(pow(10, 9), 3);
 
+private:
+	void AddPathPoint(int index, int frame, const float point[3]);
+	void TrimPaths(int first);
+	static std::vector<int> GetBalancedRows(int objectCount, int blockCount);
+	void AccumulatePairs(const std::vector<float>& positions, const std::vector<float>& masses, int firstRow, int lastRow, std::vector<float>* sums, double* potential);
+
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "Progressive.h"
+
+#include <chrono>
+
+void Progressive::Run(std::vector<PhysObject> initialObjects, float dt, int frameCount, double startTime, int firstFrame, int algorithm, bool deterministic, int threadCount)
+{
+	Physics stepper;
+	stepper.selectedAlgorithm = algorithm;
+	stepper.deterministic = deterministic;
+	stepper.threadCount = threadCount;
+
+	refinedFrames = firstFrame + 1;
+	finished = false;
+	{
+		std::lock_guard<std::mutex> lock(chunkMutex);
+		pendingChunks = {};
+	}
+
+	//time one step to see how many fit in the preview. Skip the preview if the whole thing fits
+	std::vector<PhysObject> objects = initialObjects;
+	auto start = std::chrono::high_resolution_clock::now();
+	stepper.Advance(dt, &objects);
+	double stepSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	int previewSteps = std::max(1, (int)(previewSeconds / std::max(stepSeconds, 1e-9)));
+	if (previewSteps < frameCount && !cancel) {
+		std::vector<PhysObject> baseObjects = initialObjects;
+		std::vector<std::map<std::string, int> > units = Physics::ConvertObjectsToBaseUnits(&baseObjects);
+
+		int factor = (frameCount + previewSteps - 1) / previewSteps;
+		std::vector<std::vector<PhysObject>> preview = Preview(&stepper, baseObjects, dt, frameCount, factor);
+		for (int f = 0; f < preview.size(); f++)
+			Physics::ConvertObjectsToUnits(&preview[f], units);
+		if (!cancel)
+			Publish(firstFrame, preview, startTime, dt);
+	}
+
+	objects = initialObjects;
+	for (int first = 1; first <= frameCount && !cancel; first += chunkFrames) {
+		int last = std::min(first + chunkFrames - 1, frameCount);
+
+		std::vector<std::vector<PhysObject>> frames = {};
+		for (int f = first; f <= last && !cancel; f++) {
+			stepper.Advance(dt, &objects);
+			frames.push_back(objects);
+		}
+		if (cancel)
+			break;
+
+		Publish(firstFrame + first, frames, startTime + (double)dt * first, dt);
+		refinedFrames = firstFrame + last + 1;
+	}
+
+	finished = true;
+}
+
+void Progressive::TakeChunks(std::vector<FrameChunk>* chunks)
+{
+	std::lock_guard<std::mutex> lock(chunkMutex);
+	chunks->swap(pendingChunks);
+	pendingChunks = {};
+}
+
+void Progressive::Publish(int first, std::vector<std::vector<PhysObject>> frames, double firstTime, float dt)
+{
+	FrameChunk chunk;
+	chunk.first = first;
+	chunk.frames.swap(frames);
+	for (int f = 0; f < chunk.frames.size(); f++)
+		chunk.times.push_back(firstTime + (double)dt * f);
+
+	std::lock_guard<std::mutex> lock(chunkMutex);
+	pendingChunks.push_back(chunk);
+}
+
+//the frames in between steps come from the same hermite curve as Physics::StateAt. It matches both ends' positions and velocities,
+//so the preview's paths stay smooth
+std::vector<std::vector<PhysObject>> Progressive::Preview(Physics* physics, const std::vector<PhysObject>& initialObjects, float dt, int frameCount, int factor)
+{
+	std::vector<std::vector<PhysObject>> frames = { initialObjects };
+	std::vector<PhysObject> previous = initialObjects;
+	float h = dt * factor;
+
+	for (int step = 0; step * factor < frameCount && !cancel; step++) {
+		std::vector<PhysObject> next = previous;
+		physics->Advance(h, &next);
+
+		int frameEnd = std::min((step + 1) * factor, frameCount);
+		for (int f = step * factor + 1; f <= frameEnd; f++) {
+			float s = (float)(f - step * factor) / factor;
+			if (f == (step + 1) * factor) {
+				frames.push_back(next);
+				continue;
+			}
+
+			std::vector<PhysObject> objects = previous;
+			for (int i = 0; i < objects.size(); i++)
+				Physics::Interpolate(previous[i], next[i], h, s, &objects[i]);
+			frames.push_back(objects);
+		}
+
+		previous = next;
+	}
+
+	return frames;
+}
@@ -0,0 +1,55 @@
+#ifndef PROGRESSIVE_H
+#define PROGRESSIVE_H
+
+#pragma once
+#include "Physics.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+//consecutive frames computedData[first] onwards
+struct FrameChunk
+{
+	int first = 0;
+	std::vector<std::vector<PhysObject>> frames;
+	std::vector<double> times;
+};
+
+//Computes in two passes so there is something to look at right away. The preview takes steps of several timesteps,
+//as many as fit in previewSeconds, and fills in the frames in between with cubic hermite interpolation.
+//Then the full computation (the same steps serial mode takes) replaces the preview a chunk at a time, from the start.
+class Progressive
+{
+public:
+	Progressive() {};
+	~Progressive() {};
+
+	//computes frameCount + 1 frames spaced by dt, starting with initialObjects at startTime. Units of the frames match initialObjects.
+	//Chunks are numbered from firstFrame, the frame number of initialObjects. algorithm, deterministic and threadCount are the
+	//settings of physics when the run started. The run steps a physics of its own with them, so the ui can change them meanwhile
+	void Run(std::vector<PhysObject> initialObjects, float dt, int frameCount, double startTime, int firstFrame, int algorithm, bool deterministic, int threadCount);
+
+	//moves every chunk finished since the last call into chunks, in the order they were finished
+	void TakeChunks(std::vector<FrameChunk>* chunks);
+
+	//rough time limit for the preview
+	float previewSeconds = 0.5f;
+	//frames per refined chunk
+	int chunkFrames = 200;
+
+	//frames from the start (counting the ones before firstFrame) that are final, readable from other threads while Run is going
+	std::atomic<int> refinedFrames = { 0 };
+	std::atomic<bool> finished = { false };
+	std::atomic<bool> cancel = { false };
+
+private:
+	//frameCount + 1 frames from steps of factor * dt. initialObjects must be in base units
+	std::vector<std::vector<PhysObject>> Preview(Physics* physics, const std::vector<PhysObject>& initialObjects, float dt, int frameCount, int factor);
+	void Publish(int first, std::vector<std::vector<PhysObject>> frames, double firstTime, float dt);
+
+	std::mutex chunkMutex;
+	std::vector<FrameChunk> pendingChunks;
+};
+
+#endif
@@ -0,0 +1,375 @@
+#include "ProximityIndex.h"
+#include "Events.h"
+#include "Hermite.h"
+
+#include <algorithm>
+
+void ProximityIndex::Clear()
+{
+	objectCount = 0;
+	indexedFrames = 0;
+	firstFrame = 0;
+	padding = 0.0f;
+	levels = {};
+}
+
+//the fits are within tolerance in position, and within tolerance per step in velocity, so the bezier control points
+//(a third of a step of velocity away from the frame) move by up to 4/3 of it
+void ProximityIndex::SetTolerance(float tolerance)
+{
+	padding = std::max(padding, tolerance * 4.0f / 3.0f);
+}
+
+void ProximityIndex::Add(const FrameHistory& frames, int last)
+{
+	if (frames.empty())
+		return;
+	int frameObjects = frames[0].size();
+	if (frameObjects != objectCount) {
+		Clear();
+		objectCount = frameObjects;
+	}
+
+	last = std::min(last, frames.size() - 1);
+	if (objectCount == 0 || last < indexedFrames)
+		return;
+
+	//the last leaf is built again if it wasn't full
+	int firstLeaf = indexedFrames == 0 ? 0 : (indexedFrames - 1 - firstFrame) / PROXIMITY_LEAF_STEPS;
+	indexedFrames = last + 1;
+	int leafCount = (last - firstFrame + PROXIMITY_LEAF_STEPS - 1) / PROXIMITY_LEAF_STEPS;
+	if (leafCount == 0)
+		return;
+
+	if (levels.empty())
+		levels.push_back({});
+	levels[0].resize(leafCount * objectCount * 6);
+	for (int leaf = firstLeaf; leaf < leafCount; leaf++)
+		BuildLeaf(frames, leaf);
+	UpdateParents(firstLeaf);
+}
+
+void ProximityIndex::Truncate(int frameCount)
+{
+	if (frameCount > indexedFrames)
+		return;
+
+	//only whole leaves that end before the last kept frame stay
+	int keptLeaves = std::max(frameCount - 2 - firstFrame, 0) / PROXIMITY_LEAF_STEPS;
+	if (keptLeaves == 0)
+		firstFrame = 0;
+	indexedFrames = keptLeaves == 0 ? std::min(frameCount, 1) : firstFrame + keptLeaves * PROXIMITY_LEAF_STEPS + 1;
+	if (levels.empty())
+		return;
+
+	levels[0].resize(keptLeaves * objectCount * 6);
+	UpdateParents(std::max(keptLeaves - 1, 0));
+}
+
+void ProximityIndex::EraseFront(int frameCount)
+{
+	if (frameCount <= 0)
+		return;
+	if (frameCount >= indexedFrames - 1 || levels.empty()) {
+		Clear();
+		return;
+	}
+
+	//a leaf that still has frames after the erased ones keeps its box. It covers more than is left, which only makes it looser
+	firstFrame -= frameCount;
+	indexedFrames -= frameCount;
+	int dropped = std::max(-firstFrame, 0) / PROXIMITY_LEAF_STEPS;
+	if (dropped > 0) {
+		levels[0].erase(levels[0].begin(), levels[0].begin() + dropped * objectCount * 6);
+		firstFrame += dropped * PROXIMITY_LEAF_STEPS;
+	}
+
+	//the pairs of leaves under each node change, so every level above is built again. That's only the boxes, not the frames
+	UpdateParents(0);
+}
+
+ProximityResult ProximityIndex::MinimumDistance(const FrameHistory& frames, int a, int b)
+{
+	ProximityResult result;
+	result.a = a;
+	result.b = b;
+	if (a < 0 || b < 0 || a >= objectCount || b >= objectCount || a == b || levels.empty())
+		return result;
+
+	SearchMinimum(frames, levels.size() - 1, 0, &result);
+	return result;
+}
+
+ProximityResult ProximityIndex::FirstWithin(const FrameHistory& frames, int a, int b, float radius)
+{
+	ProximityResult result;
+	result.a = a;
+	result.b = b;
+	if (a < 0 || b < 0 || a >= objectCount || b >= objectCount || a == b || levels.empty())
+		return result;
+
+	SearchFirst(frames, levels.size() - 1, 0, radius, &result);
+	return result;
+}
+
+std::vector<ProximityResult> ProximityIndex::AllWithin(const FrameHistory& frames, float radius)
+{
+	if (levels.empty())
+		return {};
+
+	//sweep along x over the root boxes: a pair can only be close if their x ranges come within radius
+	int root = levels.size() - 1;
+	std::vector<int> order(objectCount);
+	for (int o = 0; o < objectCount; o++)
+		order[o] = o;
+	std::sort(order.begin(), order.end(), [&](int x, int y) { return Box(root, 0, x)[0] < Box(root, 0, y)[0]; });
+
+	std::vector<std::pair<int, int>> candidates = {};
+	for (int i = 0; i < objectCount; i++) {
+		const float* box = Box(root, 0, order[i]);
+		for (int j = i + 1; j < objectCount && Box(root, 0, order[j])[0] <= box[3] + radius + 2.0f * padding; j++) {
+			if (BoxDistance(box, Box(root, 0, order[j])) <= radius)
+				candidates.push_back(std::make_pair(std::min(order[i], order[j]), std::max(order[i], order[j])));
+		}
+	}
+	if (candidates.empty())
+		return {};
+
+	//only pairs that get down to a leaf have an entry
+	std::map<std::pair<int, int>, ProximityResult> found;
+	SearchPairs(frames, levels.size() - 1, 0, radius, candidates, &found);
+
+	std::vector<ProximityResult> results = {};
+	for (auto it = found.begin(); it != found.end(); it++) {
+		if (it->second.within)
+			results.push_back(it->second);
+	}
+	std::sort(results.begin(), results.end(), [](const ProximityResult& x, const ProximityResult& y) { return x.firstTime < y.firstTime; });
+	return results;
+}
+
+float ProximityIndex::BoxDistance(const float* a, const float* b) const
+{
+	float distance = 0.0f;
+	for (int k = 0; k < 3; k++) {
+		float gap = std::max(0.0f, std::max(a[k] - b[k + 3], b[k] - a[k + 3]) - 2.0f * padding);
+		distance += gap * gap;
+	}
+	return sqrtf(distance);
+}
+
+//the interpolant over a step is the bezier curve with control points p0, p0 + h * v0 / 3, p1 - h * v1 / 3 and p1,
+//so a box around those points for every step holds everything ScanLeaf can find
+void ProximityIndex::BuildLeaf(const FrameHistory& frames, int leaf)
+{
+	int first = LeafFirst(leaf);
+	int last = LeafLast(leaf);
+	float* boxes = &levels[0][leaf * objectCount * 6];
+
+	for (int o = 0; o < objectCount; o++) {
+		for (int k = 0; k < 3; k++) {
+			boxes[o * 6 + k] = INFINITY;
+			boxes[o * 6 + k + 3] = -INFINITY;
+		}
+	}
+
+	PhysObject state;
+	for (int f = first; f <= last; f++) {
+		double before = f > first ? frames.GetTime(f) - frames.GetTime(f - 1) : 0.0;
+		double after = f < last ? frames.GetTime(f + 1) - frames.GetTime(f) : 0.0;
+
+		for (int o = 0; o < objectCount; o++) {
+			GetState(frames, f, o, &state);
+			float* box = boxes + o * 6;
+			for (int k = 0; k < 3; k++) {
+				float p = state.position.value[k], v = state.velocity.value[k];
+				float points[3] = { p, p - (float)(before / 3.0) * v, p + (float)(after / 3.0) * v };
+				for (int i = 0; i < 3; i++) {
+					box[k] = std::min(box[k], points[i]);
+					box[k + 3] = std::max(box[k + 3], points[i]);
+				}
+			}
+		}
+	}
+}
+
+void ProximityIndex::UpdateParents(int firstLeaf)
+{
+	int count = LeafCount();
+	if (count == 0) {
+		levels = {};
+		return;
+	}
+
+	int level = 1;
+	int first = firstLeaf;
+	for (; count > 1; level++) {
+		int parentCount = (count + 1) / 2;
+		if (levels.size() <= level)
+			levels.push_back({});
+		levels[level].resize(parentCount * objectCount * 6);
+
+		for (int j = first / 2; j < parentCount; j++) {
+			bool single = 2 * j + 1 >= count;
+			for (int o = 0; o < objectCount; o++) {
+				const float* left = Box(level - 1, 2 * j, o);
+				const float* right = single ? left : Box(level - 1, 2 * j + 1, o);
+				float* box = &levels[level][(j * objectCount + o) * 6];
+				for (int k = 0; k < 3; k++) {
+					box[k] = std::min(left[k], right[k]);
+					box[k + 3] = std::max(left[k + 3], right[k + 3]);
+				}
+			}
+		}
+
+		first /= 2;
+		count = parentCount;
+	}
+	levels.resize(level);
+}
+
+void ProximityIndex::ScanLeaf(const FrameHistory& frames, int leaf, float radius, ProximityResult* result)
+{
+	int first = LeafFirst(leaf);
+	int last = LeafLast(leaf);
+	if (last <= first)
+		return;
+
+	std::vector<PhysObject> statesA(last - first + 1), statesB(last - first + 1);
+	for (int f = first; f <= last; f++) {
+		GetState(frames, f, result->a, &statesA[f - first]);
+		GetState(frames, f, result->b, &statesB[f - first]);
+	}
+
+	for (int f = first; f < last; f++) {
+		double t0 = frames.GetTime(f);
+		double h = frames.GetTime(f + 1) - t0;
+		if (h <= 0.0)
+			continue;
+
+		//distance at fraction s of the step, and the radial velocity, which goes from negative to positive at a closest approach
+		auto distance = [&](double s, double* radialVelocity) {
+			double positionA[3], velocityA[3], positionB[3], velocityB[3];
+			HermiteState(statesA[f - first], statesA[f + 1 - first], h, s, positionA, velocityA);
+			HermiteState(statesB[f - first], statesB[f + 1 - first], h, s, positionB, velocityB);
+			double r[3], v[3];
+			for (int k = 0; k < 3; k++) {
+				r[k] = positionA[k] - positionB[k];
+				v[k] = velocityA[k] - velocityB[k];
+			}
+			if (radialVelocity)
+				*radialVelocity = r[0] * v[0] + r[1] * v[1] + r[2] * v[2];
+			return sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+		};
+
+		double radial0, radial1;
+		double d0 = distance(0.0, &radial0);
+		double d1 = distance(1.0, &radial1);
+		double closestS = d0 <= d1 ? 0.0 : 1.0;
+		double closest = std::min(d0, d1);
+		if (radial0 < 0.0 && radial1 > 0.0) {
+			double s = Events::FindRoot([&](double x) { double radial; distance(x, &radial); return radial; }, 0.0, 1.0, radial0, radial1, 1e-12 / h);
+			double d = distance(s, nullptr);
+			if (d < closest) {
+				closest = d;
+				closestS = s;
+			}
+		}
+
+		if (closest < result->distance) {
+			result->distance = closest;
+			result->time = t0 + h * closestS;
+		}
+
+		if (radius > 0.0f && !result->within) {
+			if (d0 <= radius) {
+				result->within = true;
+				result->firstTime = t0;
+			}
+			else if (closest <= radius) {
+				double s = Events::FindRoot([&](double x) { return radius - distance(x, nullptr); }, 0.0, closestS, radius - d0, radius - closest, 1e-12 / h);
+				result->within = true;
+				result->firstTime = t0 + h * s;
+			}
+		}
+	}
+}
+
+//visits the closer child first, so the best distance so far rules out as much as possible
+void ProximityIndex::SearchMinimum(const FrameHistory& frames, int level, int node, ProximityResult* result)
+{
+	float bound = BoxDistance(Box(level, node, result->a), Box(level, node, result->b));
+	if (bound >= result->distance)
+		return;
+
+	if (level == 0) {
+		ScanLeaf(frames, node, -1.0f, result);
+		return;
+	}
+
+	int children = levels[level - 1].size() / (6 * objectCount);
+	int first = 2 * node, second = 2 * node + 1;
+	if (second >= children) {
+		SearchMinimum(frames, level - 1, first, result);
+		return;
+	}
+
+	if (BoxDistance(Box(level - 1, second, result->a), Box(level - 1, second, result->b)) < BoxDistance(Box(level - 1, first, result->a), Box(level - 1, first, result->b)))
+		std::swap(first, second);
+	SearchMinimum(frames, level - 1, first, result);
+	SearchMinimum(frames, level - 1, second, result);
+}
+
+//visits the earlier child first, and stops at the first leaf where they come close enough
+bool ProximityIndex::SearchFirst(const FrameHistory& frames, int level, int node, float radius, ProximityResult* result)
+{
+	if (BoxDistance(Box(level, node, result->a), Box(level, node, result->b)) > radius)
+		return false;
+
+	if (level == 0) {
+		ScanLeaf(frames, node, radius, result);
+		return result->within;
+	}
+
+	int children = levels[level - 1].size() / (6 * objectCount);
+	if (SearchFirst(frames, level - 1, 2 * node, radius, result))
+		return true;
+	return 2 * node + 1 < children && SearchFirst(frames, level - 1, 2 * node + 1, radius, result);
+}
+
+//candidates are pairs (a, b) whose boxes were close enough in the node above. Children are visited in time order,
+//so the first leaf that finds a pair within radius has the first time it happened
+void ProximityIndex::SearchPairs(const FrameHistory& frames, int level, int node, float radius, const std::vector<std::pair<int, int>>& candidates, std::map<std::pair<int, int>, ProximityResult>* results)
+{
+	std::vector<std::pair<int, int>> close = {};
+	for (int i = 0; i < candidates.size(); i++) {
+		if (BoxDistance(Box(level, node, candidates[i].first), Box(level, node, candidates[i].second)) <= radius)
+			close.push_back(candidates[i]);
+	}
+	if (close.empty())
+		return;
+
+	if (level == 0) {
+		for (int i = 0; i < close.size(); i++) {
+			ProximityResult& result = (*results)[close[i]];
+			result.a = close[i].first;
+			result.b = close[i].second;
+			ScanLeaf(frames, node, radius, &result);
+		}
+		return;
+	}
+
+	int children = levels[level - 1].size() / (6 * objectCount);
+	SearchPairs(frames, level - 1, 2 * node, radius, close, results);
+	if (2 * node + 1 < children)
+		SearchPairs(frames, level - 1, 2 * node + 1, radius, close, results);
+}
+
+void ProximityIndex::GetState(const FrameHistory& frames, int frame, int object, PhysObject* state)
+{
+	PhysObject original = frames.GetObject(frame, object);
+	state->position = original.position;
+	state->velocity = original.velocity;
+	state->position.GetBaseValue(state->position.value);
+	state->velocity.GetBaseValue(state->velocity.value);
+}
@@ -0,0 +1,93 @@
+#ifndef PROXIMITYINDEX_H
+#define PROXIMITYINDEX_H
+
+#pragma once
+#include "PhysObject.h"
+#include "FrameHistory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+//steps covered by each leaf of a ProximityIndex
+#define PROXIMITY_LEAF_STEPS 32
+
+//closest approach of two objects, and when they first came within the radius of a query
+struct ProximityResult
+{
+	int a = -1;
+	int b = -1;
+	//time and distance (gigameters) of the closest approach
+	double time = 0.0;
+	double distance = INFINITY;
+	bool within = false;
+	double firstTime = 0.0;
+};
+
+//Bounding volume hierarchy over time. Each leaf has a box around every object's path over PROXIMITY_LEAF_STEPS steps,
+//and each node above it has the boxes around both of its children, so one node covers twice the time of the level below.
+//Queries skip every node where the boxes of the objects are already too far apart, and only look at the frames of the leaves left.
+//Inside a leaf, the distance between frames comes from the same cubic hermite interpolant the event detection uses. The leaf boxes
+//contain that interpolant (it's a bezier curve, inside the box of its control points), so no approach is skipped.
+//Leaves are added in time order as frames come in, so building it costs O(objects) per frame, and queries on
+//millions of frames only visit a few dozen leaves. Only the boxes are kept. The frames come from the history passed to each query
+class ProximityIndex
+{
+public:
+	ProximityIndex() {};
+	~ProximityIndex() {};
+
+	void Clear();
+	//indexes frames up to last. Frames already indexed have to be the same as before, so call Truncate first when they change
+	void Add(const FrameHistory& frames, int last);
+	//forgets everything from frame frameCount - 1 on. The last kept frame is indexed again too, since it's usually the one just edited
+	void Truncate(int frameCount);
+	//follows frameCount frames being erased from the front of the history. Only the leaves that end before the new first frame are dropped
+	void EraseFront(int frameCount);
+	int IndexedFrames() { return indexedFrames; }
+	//indexed frames can still be compressed afterwards, which moves them by up to tolerance (gigameters). The boxes are taken to be
+	//that much bigger until the next Clear, since frames compressed with a larger tolerance before stay that way
+	void SetTolerance(float tolerance);
+
+	//closest approach of a and b over all the indexed frames
+	ProximityResult MinimumDistance(const FrameHistory& frames, int a, int b);
+	//the first time a and b come within radius (gigameters). within is false if they never do.
+	//The closest approach is only searched for up to there, so time and distance don't mean much
+	ProximityResult FirstWithin(const FrameHistory& frames, int a, int b, float radius);
+	//every pair that comes within radius, with its closest approach, in order of when they first did.
+	//Pairs are only tried where the root boxes are close, found by sorting them along x, so far apart objects cost nothing
+	std::vector<ProximityResult> AllWithin(const FrameHistory& frames, float radius);
+
+private:
+	const float* Box(int level, int node, int object) const { return &levels[level][(node * objectCount + object) * 6]; }
+	//lower bound on the distance between two objects in boxes a and b, allowing for the padding
+	float BoxDistance(const float* a, const float* b) const;
+	void BuildLeaf(const FrameHistory& frames, int leaf);
+	//recomputes every node above the leaves from firstLeaf on, adding levels until there's a single root
+	void UpdateParents(int firstLeaf);
+	int LeafCount() const { return levels.empty() ? 0 : levels[0].size() / (6 * objectCount); }
+	//frames covered by a leaf, first to last. The first leaf can start before frame 0, after frames were erased from the front
+	int LeafFirst(int leaf) const { return std::max(firstFrame + leaf * PROXIMITY_LEAF_STEPS, 0); }
+	int LeafLast(int leaf) const { return std::min(firstFrame + (leaf + 1) * PROXIMITY_LEAF_STEPS, indexedFrames - 1); }
+
+	//updates result with the closest approach in one leaf, and the first time within radius if it hasn't been found yet
+	void ScanLeaf(const FrameHistory& frames, int leaf, float radius, ProximityResult* result);
+	void SearchMinimum(const FrameHistory& frames, int level, int node, ProximityResult* result);
+	bool SearchFirst(const FrameHistory& frames, int level, int node, float radius, ProximityResult* result);
+	void SearchPairs(const FrameHistory& frames, int level, int node, float radius, const std::vector<std::pair<int, int>>& candidates, std::map<std::pair<int, int>, ProximityResult>* results);
+
+	static void GetState(const FrameHistory& frames, int frame, int object, PhysObject* state);
+
+	int objectCount = 0;
+	int indexedFrames = 0;
+	//frame the first leaf starts at. Leaves always cover PROXIMITY_LEAF_STEPS steps from here
+	int firstFrame = 0;
+	//how far out of its box (gigameters) each object's interpolant can be, after the frames are compressed
+	float padding = 0.0f;
+	//levels[0] has the leaves. Node j of each level has 6 floats (min xyz, max xyz) for each object, in gigameters
+	std::vector<std::vector<float>> levels;
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "SaveCatalog.h"
+#include "Snapshot.h"
+#include "XmlImport.h"
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#endif
+
+void SaveCatalog::Start(std::string folder)
+{
+	Stop();
+	this->folder = folder;
+	{
+		std::lock_guard<std::mutex> lock(entriesMutex);
+		entries = {};
+	}
+	std::vector<Entry> listed = List();
+	{
+		std::lock_guard<std::mutex> lock(entriesMutex);
+		entries = listed;
+	}
+	version++;
+	dirty = false;
+	stopping = false;
+	watcher = std::thread([this]() { Run(); });
+}
+
+void SaveCatalog::Stop()
+{
+	if (!watcher.joinable())
+		return;
+
+	stopping = true;
+	watcher.join();
+}
+
+std::vector<SaveCatalog::Entry> SaveCatalog::GetEntries()
+{
+	std::lock_guard<std::mutex> lock(entriesMutex);
+	return entries;
+}
+
+void SaveCatalog::Run()
+{
+#ifdef _WIN32
+	HANDLE change = FindFirstChangeNotificationA(folder.c_str(), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+	bool watching = change != INVALID_HANDLE_VALUE;
+#elif defined(__linux__)
+	//a save is done when it's closed, or renamed into place. Writes in between don't matter
+	int change = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	bool watching = change >= 0 && inotify_add_watch(change, folder.c_str(), IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO) >= 0;
+#else
+	bool watching = false;
+#endif
+	auto listTime = std::chrono::steady_clock::now();
+
+	while (!stopping) {
+		if (dirty.exchange(false)) {
+			std::vector<Entry> listed = List();
+			std::lock_guard<std::mutex> lock(entriesMutex);
+			entries = listed;
+			version++;
+			listTime = std::chrono::steady_clock::now();
+		}
+
+		//one file at a time, so the entries can be read while a big one is parsed, and a change can interrupt
+		while (!stopping && !dirty) {
+			Entry entry;
+			{
+				std::lock_guard<std::mutex> lock(entriesMutex);
+				auto pending = std::find_if(entries.begin(), entries.end(), [](const Entry& e) { return !e.checked; });
+				if (pending == entries.end())
+					break;
+				entry = *pending;
+			}
+			Check(&entry);
+
+			std::lock_guard<std::mutex> lock(entriesMutex);
+			for (Entry& listed : entries) {
+				if (listed.SameFile(entry))
+					listed = entry;
+			}
+			version++;
+		}
+		if (stopping || dirty)
+			continue;
+
+#ifdef _WIN32
+		if (watching) {
+			if (WaitForSingleObject(change, SAVE_CATALOG_WAIT_MS) == WAIT_OBJECT_0) {
+				dirty = true;
+				FindNextChangeNotification(change);
+			}
+			continue;
+		}
+#elif defined(__linux__)
+		if (watching) {
+			pollfd waiting = { change, POLLIN, 0 };
+			if (poll(&waiting, 1, SAVE_CATALOG_WAIT_MS) > 0) {
+				char events[4096];
+				while (read(change, events, sizeof(events)) > 0);
+				dirty = true;
+			}
+			continue;
+		}
+#endif
+		std::this_thread::sleep_for(std::chrono::milliseconds(SAVE_CATALOG_WAIT_MS));
+		if (std::chrono::steady_clock::now() - listTime >= std::chrono::milliseconds(SAVE_CATALOG_RESCAN_MS))
+			dirty = true;
+	}
+
+#ifdef _WIN32
+	if (watching)
+		FindCloseChangeNotification(change);
+#elif defined(__linux__)
+	if (change >= 0)
+		close(change);
+#endif
+}
+
+std::vector<SaveCatalog::Entry> SaveCatalog::List()
+{
+	std::vector<Entry> listed = {};
+	auto add = [&](Entry entry) {
+		if (entry.name.size() < 4 || entry.name.substr(entry.name.size() - 4) != ".tmp")
+			listed.push_back(entry);
+	};
+
+#ifdef _WIN32
+	WIN32_FIND_DATAA found;
+	HANDLE search = FindFirstFileA((folder + "/*.*").c_str(), &found);
+	if (search != INVALID_HANDLE_VALUE) {
+		do {
+			if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				continue;
+			Entry entry;
+			entry.name = found.cFileName;
+			entry.size = ((uint64_t)found.nFileSizeHigh << 32) | found.nFileSizeLow;
+			entry.modified = ((long long)found.ftLastWriteTime.dwHighDateTime << 32) | found.ftLastWriteTime.dwLowDateTime;
+			add(entry);
+		} while (FindNextFileA(search, &found));
+		FindClose(search);
+	}
+#else
+	DIR* directory = opendir(folder.c_str());
+	if (directory) {
+		while (dirent* found = readdir(directory)) {
+			struct stat info;
+			if (stat((folder + "/" + found->d_name).c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+				continue;
+			Entry entry;
+			entry.name = found->d_name;
+			entry.size = info.st_size;
+#ifdef __APPLE__
+			entry.modified = (long long)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+			entry.modified = (long long)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+			entry.inode = info.st_ino;
+			add(entry);
+		}
+		closedir(directory);
+	}
+#endif
+	std::sort(listed.begin(), listed.end(), [](const Entry& a, const Entry& b) { return a.name < b.name; });
+
+	std::lock_guard<std::mutex> lock(entriesMutex);
+	for (Entry& entry : listed) {
+		for (const Entry& old : entries) {
+			if (old.SameFile(entry)) {
+				entry = old;
+				break;
+			}
+		}
+	}
+	return listed;
+}
+
+//the whole file is read the way loading would read it, to find everything loading would complain about
+void SaveCatalog::Check(Entry* entry)
+{
+	std::string path = folder + "/" + entry->name;
+	entry->checked = true;
+	if (Snapshot::IsSnapshotName(entry->name))
+		Snapshot::Check(path, &entry->error, &entry->objectCount, &entry->time);
+	else
+		XmlImport::Check(path, &entry->error, &entry->objectCount, &entry->time);
+}
@@ -0,0 +1,74 @@
+#ifndef SAVECATALOG_H
+#define SAVECATALOG_H
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//how long the watcher waits for a change notification before checking whether it should stop
+#define SAVE_CATALOG_WAIT_MS 250
+//how often the folder is listed again when change notifications aren't available
+#define SAVE_CATALOG_RESCAN_MS 2000
+
+//What's in the saves folder, and whether each file can be loaded, kept up to date on a background thread so the Load popup never
+//parses anything itself. Every file is parsed once, and again only when its size, modification time or inode changes. The folder is
+//watched with change notifications (FindFirstChangeNotification on windows, inotify elsewhere), and listed again when they fire;
+//listing it is cheap, since unchanged files aren't opened. Without notifications it's listed every SAVE_CATALOG_RESCAN_MS instead.
+//Files ending in .tmp are saves still being written (see Saver), and are left out
+class SaveCatalog
+{
+public:
+	SaveCatalog() {};
+	~SaveCatalog() { Stop(); };
+
+	struct Entry
+	{
+		std::string name;
+		uint64_t size = 0;
+		//last write time, in the finest units the OS gives (100 ns on windows, ns elsewhere). Only compared, to see if the file changed
+		long long modified = 0;
+		//a save renamed into place is a new file even if its size and time match. Always 0 on windows, which only has
+		//file ids for files it opens
+		uint64_t inode = 0;
+		//false until the file has been parsed
+		bool checked = false;
+		//empty if the file can be loaded
+		std::string error = "";
+		int objectCount = 0;
+		//the time the scenario starts at, in years
+		float time = 0.0f;
+
+		//the same file, unchanged, so what was found out about it still holds
+		bool SameFile(const Entry& other) const { return name == other.name && size == other.size && modified == other.modified && inode == other.inode; }
+	};
+
+	//lists folder, and starts checking its files in the background. The names are there as soon as this returns
+	void Start(std::string folder);
+	void Stop();
+	//lists the folder again soon, even if no notification came
+	void Refresh() { dirty = true; }
+	//copy of every entry, sorted by name
+	std::vector<Entry> GetEntries();
+
+	//changes every time the entries do, so the ui only copies them when something happened
+	std::atomic<int> version = { 0 };
+
+private:
+	void Run();
+	//returns the new list, with the entries of files that haven't changed carried over from the old one
+	std::vector<Entry> List();
+	void Check(Entry* entry);
+
+	std::string folder;
+	std::vector<Entry> entries;
+	std::mutex entriesMutex;
+	std::thread watcher;
+	std::atomic<bool> dirty = { false };
+	std::atomic<bool> stopping = { false };
+};
+
+#endif
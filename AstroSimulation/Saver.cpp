@@ -0,0 +1,90 @@
+#include "Saver.h"
+#include "Snapshot.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+bool Saver::Save(const SaveState& state, std::string filename, bool binary)
+{
+	progress = 0.0f;
+	std::string temporary = filename + ".tmp";
+	bool written;
+	if (binary)
+		written = Snapshot::Write(state, temporary, &progress);
+	else {
+		std::FILE* file = nullptr;
+#ifdef _WIN32
+		fopen_s(&file, temporary.c_str(), "wb");
+#else
+		file = std::fopen(temporary.c_str(), "wb");
+#endif
+		written = file && WriteXml(state, file);
+		if (file)
+			written = std::fclose(file) == 0 && written;
+	}
+
+	if (written && !cancel)
+		written = Commit(temporary, filename);
+	else {
+		std::remove(temporary.c_str());
+		written = false;
+	}
+	failed = !written && !cancel;
+	finished = true;
+	return written;
+}
+
+bool Saver::WriteXml(const SaveState& state, std::FILE* file)
+{
+	pugi::xml_writer_file writer(file);
+	std::fputs("<?xml version=\"1.0\"?>\n<SavedState>\n\t<Physics>\n", file);
+
+	pugi::xml_document time;
+	time.append_child("Time").append_child(pugi::node_pcdata).set_value(Physics::ExactString(state.time).c_str());
+	time.first_child().print(writer, "\t", pugi::format_default, pugi::encoding_auto, 2);
+
+	size_t n = state.objects.size();
+	std::fputs(n == 0 ? "\t\t<Objects />\n" : "\t\t<Objects>\n", file);
+	for (size_t i = 0; i < n && !cancel; i++) {
+		pugi::xml_document object;
+		Physics::ObjectToXml(object, state.objects[i], state.objectSettings[i]);
+		object.first_child().print(writer, "\t", pugi::format_default, pugi::encoding_auto, 3);
+		progress = (float)(i + 1) / n;
+	}
+	if (n > 0)
+		std::fputs("\t\t</Objects>\n", file);
+	std::fputs("\t</Physics>\n</SavedState>\n", file);
+	return !cancel && !std::ferror(file);
+}
+
+bool Saver::Commit(std::string temporary, std::string filename)
+{
+	//reopened just to flush it, since the file was written by whatever wrote it
+	std::FILE* file = nullptr;
+#ifdef _WIN32
+	fopen_s(&file, temporary.c_str(), "r+b");
+#else
+	file = std::fopen(temporary.c_str(), "r+b");
+#endif
+	bool flushed = file != nullptr;
+#ifdef _WIN32
+	flushed = flushed && _commit(_fileno(file)) == 0;
+#else
+	flushed = flushed && fsync(fileno(file)) == 0;
+#endif
+	if (file)
+		flushed = std::fclose(file) == 0 && flushed;
+
+#ifdef _WIN32
+	bool renamed = flushed && MoveFileExA(temporary.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	bool renamed = flushed && std::rename(temporary.c_str(), filename.c_str()) == 0;
+#endif
+	if (!renamed)
+		std::remove(temporary.c_str());
+	return renamed;
+}
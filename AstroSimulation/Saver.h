@@ -0,0 +1,36 @@
+#ifndef SAVER_H
+#define SAVER_H
+
+#pragma once
+#include "Physics.h"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+//Writes save files on a background thread, so the ui keeps going while a big scenario is saved. The ui thread only copies out
+//the current frame and the object settings (Physics::GetSaveState), never the rest of the history, and the file is written from the copy.
+//Xml is written an object at a time instead of as one document, so the text of all of them is never in memory at once.
+//Files are written under a temporary name, and renamed over the old one once they are on disk, so a crash or a cancel leaves the old save alone
+class Saver
+{
+public:
+	Saver() {};
+	~Saver() {};
+
+	//writes state to filename, as a snapshot if binary and xml otherwise. Returns false if it failed or was cancelled.
+	//Snapshots are quick to write, and only notice cancel once they're done
+	bool Save(const SaveState& state, std::string filename, bool binary);
+	//the same text as saving the document from Physics::ToXml
+	bool WriteXml(const SaveState& state, std::FILE* file);
+	//puts temporary in place of filename, after making sure what was written to it is on disk. Removes temporary if anything fails
+	static bool Commit(std::string temporary, std::string filename);
+
+	//progress, readable from other threads while Save is going
+	std::atomic<float> progress = { 0.0f };
+	std::atomic<bool> finished = { false };
+	std::atomic<bool> failed = { false };
+	std::atomic<bool> cancel = { false };
+};
+
+#endif
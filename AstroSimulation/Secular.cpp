@@ -0,0 +1,430 @@
+#include "Secular.h"
+
+std::vector<std::vector<PhysObject>> Secular::Run(Physics* physics, std::vector<PhysObject> initialObjects, float frameInterval, int frameCount)
+{
+	framesDone = 0;
+	finished = false;
+
+	std::vector<std::map<std::string, int> > originalUnits = Physics::ConvertObjectsToBaseUnits(&initialObjects);
+	int n = initialObjects.size();
+	G = physics->G;
+
+	//everything orbits its primary with fixed elements, unless it's a planet
+	std::vector<int> primaries = {};
+	std::vector<OrbitalElements> initialElements = {};
+	int central = -1;
+	for (int i = 0; i < n; i++) {
+		primaries.push_back(Physics::GetPrimaryIndex(initialObjects, i));
+		initialElements.push_back(physics->GetOrbitalElements(initialObjects, i));
+		if (primaries[i] == -1)
+			central = i;
+	}
+
+	planets = {};
+	for (int i = 0; i < n; i++) {
+		if (central == -1 || primaries[i] != central || !initialElements[i].IsBound())
+			continue;
+
+		Planet planet;
+		planet.index = i;
+		planet.mass = initialObjects[i].mass.value;
+		planet.mu = G * (initialObjects[central].mass.value + planet.mass);
+		planet.semimajorAxis = initialElements[i].semimajorAxis;
+		planet.meanMotion = sqrt(planet.mu / pow(planet.semimajorAxis, 3));
+		planet.meanLongitude = initialElements[i].meanAnomaly + initialElements[i].argumentOfPeriapsis + initialElements[i].longitudeOfAscendingNode;
+
+		double r[3], v[3];
+		for (int k = 0; k < 3; k++) {
+			r[k] = initialObjects[i].position.value[k] - initialObjects[central].position.value[k];
+			v[k] = initialObjects[i].velocity.value[k] - initialObjects[central].velocity.value[k];
+		}
+		double rMagnitude = sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+		planet.h[0] = r[1] * v[2] - r[2] * v[1];
+		planet.h[1] = r[2] * v[0] - r[0] * v[2];
+		planet.h[2] = r[0] * v[1] - r[1] * v[0];
+		double vCrossH[3] = {
+			v[1] * planet.h[2] - v[2] * planet.h[1],
+			v[2] * planet.h[0] - v[0] * planet.h[2],
+			v[0] * planet.h[1] - v[1] * planet.h[0]
+		};
+		for (int k = 0; k < 3; k++)
+			planet.e[k] = vCrossH[k] / planet.mu - r[k] / rMagnitude;
+
+		planets.push_back(planet);
+	}
+
+	if (!higherOrder && central != -1)
+		SetupLaplaceLagrange(initialObjects[central].mass.value);
+
+	std::vector<std::vector<PhysObject>> frames = {};
+	for (int frame = 0; frame <= frameCount && !cancel; frame++) {
+		double t = (double)frame * frameInterval;
+		if (frame > 0) {
+			if (higherOrder) {
+				int substeps = std::max(1, (int)ceil(fabs(frameInterval) / maxStep));
+				for (int i = 0; i < substeps; i++)
+					StepHigherOrder((double)frameInterval / substeps);
+			}
+			else {
+				EvaluateLaplaceLagrange(t);
+			}
+		}
+
+		//the central object stays put. Following its reflex motion for millions of years would carry it off the screen
+		std::vector<PhysObject> objects = initialObjects;
+		std::vector<bool> placed(n, false);
+		if (central != -1)
+			placed[central] = true;
+
+		for (int p = 0; p < planets.size(); p++) {
+			int i = planets[p].index;
+			float position[3], velocity[3];
+			GetElements(planets[p], t).ToState(planets[p].mu, position, velocity);
+			for (int k = 0; k < 3; k++) {
+				objects[i].position.value[k] = initialObjects[central].position.value[k] + position[k];
+				objects[i].velocity.value[k] = initialObjects[central].velocity.value[k] + velocity[k];
+			}
+			placed[i] = true;
+		}
+
+		//everything else keeps its initial orbit around wherever its primary ended up
+		for (int i = 0; i < n; i++) {
+			if (placed[i] || primaries[i] == -1)
+				continue;
+
+			OrbitalElements elements = initialElements[i];
+			float mu = G * (initialObjects[primaries[i]].mass.value + initialObjects[i].mass.value);
+			float meanMotion = sqrt(mu / pow(fabs(elements.semimajorAxis), 3));
+			elements.meanAnomaly = elements.IsBound() ? fmod(elements.meanAnomaly + meanMotion * t, 2.0 * 3.14159265358979) : elements.meanAnomaly + meanMotion * t;
+
+			float position[3], velocity[3];
+			elements.ToState(mu, position, velocity);
+			for (int k = 0; k < 3; k++) {
+				objects[i].position.value[k] = objects[primaries[i]].position.value[k] + position[k];
+				objects[i].velocity.value[k] = objects[primaries[i]].velocity.value[k] + velocity[k];
+			}
+		}
+
+		for (int i = 0; i < n; i++)
+			objects[i].rotationDegrees = fmod(initialObjects[i].rotationDegrees + t * 360.0 / objects[i].rotationPeriod.GetBaseValue(), 360.0);
+
+		Physics::ConvertObjectsToUnits(&objects, originalUnits);
+		frames.push_back(objects);
+		framesDone++;
+	}
+
+	finished = true;
+	return frames;
+}
+
+//builds the linear secular equations dz/dt = i A z for eccentricities and dzeta/dt = i B zeta for inclinations, and solves them once.
+//A and B become symmetric when every row is scaled by sqrt(m sqrt(mu a)), so their eigenvectors are orthogonal
+void Secular::SetupLaplaceLagrange(double centralMass)
+{
+	int n = planets.size();
+	std::vector<double> a(n * n, 0.0), b(n * n, 0.0);
+	for (int j = 0; j < n; j++) {
+		for (int k = 0; k < n; k++) {
+			if (k == j)
+				continue;
+
+			double alpha = std::min(planets[j].semimajorAxis, planets[k].semimajorAxis) / std::max(planets[j].semimajorAxis, planets[k].semimajorAxis);
+			double alphaBar = planets[j].semimajorAxis < planets[k].semimajorAxis ? alpha : 1.0;
+			double coefficient = 0.25 * planets[j].meanMotion * planets[k].mass / (centralMass + planets[j].mass) * alpha * alphaBar;
+			double b1 = LaplaceCoefficient(1.5, 1, alpha);
+			double b2 = LaplaceCoefficient(1.5, 2, alpha);
+
+			a[j * n + j] += coefficient * b1;
+			a[j * n + k] = -coefficient * b2;
+			b[j * n + j] -= coefficient * b1;
+			b[j * n + k] = coefficient * b1;
+		}
+	}
+
+	//massless planets would make the scaling singular, so give them a token kilogram
+	scale = {};
+	for (int j = 0; j < n; j++)
+		scale.push_back(sqrt(std::max(planets[j].mass, 1.0) * sqrt(planets[j].mu * planets[j].semimajorAxis)));
+
+	for (int pass = 0; pass < 2; pass++) {
+		std::vector<double>& matrix = pass == 0 ? a : b;
+		std::vector<double> symmetric(n * n);
+		for (int j = 0; j < n; j++)
+			for (int k = 0; k < n; k++)
+				symmetric[j * n + k] = 0.5 * (scale[j] * matrix[j * n + k] / scale[k] + scale[k] * matrix[k * n + j] / scale[j]);
+
+		std::vector<double>* frequencies = pass == 0 ? &eccentricityFrequencies : &inclinationFrequencies;
+		std::vector<double>* modes = pass == 0 ? &eccentricityModes : &inclinationModes;
+		std::vector<double>* amplitudes = pass == 0 ? &eccentricityAmplitudes : &inclinationAmplitudes;
+		SymmetricEigen(symmetric, n, frequencies, modes);
+
+		//initial z (or zeta) of every planet, projected onto the modes
+		amplitudes->assign(2 * n, 0.0);
+		for (int j = 0; j < n; j++) {
+			OrbitalElements elements = GetElements(planets[j], 0.0);
+			double magnitude = pass == 0 ? elements.eccentricity : elements.inclination;
+			double angle = pass == 0 ? elements.argumentOfPeriapsis + elements.longitudeOfAscendingNode : elements.longitudeOfAscendingNode;
+			for (int i = 0; i < n; i++) {
+				(*amplitudes)[2 * i] += (*modes)[j * n + i] * scale[j] * magnitude * cos(angle);
+				(*amplitudes)[2 * i + 1] += (*modes)[j * n + i] * scale[j] * magnitude * sin(angle);
+			}
+		}
+	}
+}
+
+//sets every planet's h and e vectors to the Laplace-Lagrange solution at time t
+void Secular::EvaluateLaplaceLagrange(double t)
+{
+	int n = planets.size();
+	for (int j = 0; j < n; j++) {
+		double z[2] = { 0.0, 0.0 }, zeta[2] = { 0.0, 0.0 };
+		for (int i = 0; i < n; i++) {
+			double c = cos(eccentricityFrequencies[i] * t), s = sin(eccentricityFrequencies[i] * t);
+			z[0] += eccentricityModes[j * n + i] * (c * eccentricityAmplitudes[2 * i] - s * eccentricityAmplitudes[2 * i + 1]);
+			z[1] += eccentricityModes[j * n + i] * (s * eccentricityAmplitudes[2 * i] + c * eccentricityAmplitudes[2 * i + 1]);
+
+			c = cos(inclinationFrequencies[i] * t);
+			s = sin(inclinationFrequencies[i] * t);
+			zeta[0] += inclinationModes[j * n + i] * (c * inclinationAmplitudes[2 * i] - s * inclinationAmplitudes[2 * i + 1]);
+			zeta[1] += inclinationModes[j * n + i] * (s * inclinationAmplitudes[2 * i] + c * inclinationAmplitudes[2 * i + 1]);
+		}
+
+		double eccentricity = sqrt(z[0] * z[0] + z[1] * z[1]) / scale[j];
+		double periapsisLongitude = atan2(z[1], z[0]);
+		double inclination = sqrt(zeta[0] * zeta[0] + zeta[1] * zeta[1]) / scale[j];
+		double node = atan2(zeta[1], zeta[0]);
+
+		Planet& planet = planets[j];
+		double hMagnitude = sqrt(planet.mu * planet.semimajorAxis * (1.0 - eccentricity * eccentricity));
+		double hUnit[3] = { sin(inclination) * sin(node), -sin(inclination) * cos(node), cos(inclination) };
+		double nodeUnit[3] = { cos(node), sin(node), 0.0 };
+		double ahead[3] = {
+			hUnit[1] * nodeUnit[2] - hUnit[2] * nodeUnit[1],
+			hUnit[2] * nodeUnit[0] - hUnit[0] * nodeUnit[2],
+			hUnit[0] * nodeUnit[1] - hUnit[1] * nodeUnit[0]
+		};
+		double argumentOfPeriapsis = periapsisLongitude - node;
+		for (int k = 0; k < 3; k++) {
+			planet.h[k] = hMagnitude * hUnit[k];
+			planet.e[k] = eccentricity * (cos(argumentOfPeriapsis) * nodeUnit[k] + sin(argumentOfPeriapsis) * ahead[k]);
+		}
+	}
+}
+
+//rate of change of every planet's h and e vectors (6 numbers per planet), averaged over the orbits of the planet and of each perturber.
+//Each orbit is sampled evenly in eccentric anomaly, weighted by (1 - e cos E) since that's how dt relates to dE.
+//The indirect term averages to zero over the perturber's orbit, so only the direct pull counts
+void Secular::GetDerivatives(const std::vector<double>& state, std::vector<double>* derivatives)
+{
+	int n = planets.size();
+	int count = std::max(samples, 4);
+
+	//positions, velocities and weights of every sample point
+	std::vector<double> positions(n * count * 3), velocities(n * count * 3), weights(n * count);
+	for (int j = 0; j < n; j++) {
+		const double* h = &state[6 * j];
+		const double* e = &state[6 * j + 3];
+		double p[3], q[3];
+		GetBasis(h, e, p, q);
+
+		double eccentricity = std::min(sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]), 0.999);
+		double a = planets[j].semimajorAxis;
+		double root = sqrt(1.0 - eccentricity * eccentricity);
+		for (int s = 0; s < count; s++) {
+			double anomaly = 2.0 * 3.14159265358979 * s / count;
+			double c = cos(anomaly), sn = sin(anomaly);
+			double weight = 1.0 - eccentricity * c;
+			double speed = planets[j].meanMotion * a / weight;
+			for (int k = 0; k < 3; k++) {
+				positions[(j * count + s) * 3 + k] = a * (c - eccentricity) * p[k] + a * root * sn * q[k];
+				velocities[(j * count + s) * 3 + k] = speed * (-sn * p[k] + root * c * q[k]);
+			}
+			weights[j * count + s] = weight;
+		}
+	}
+
+	//each planet only writes its own derivatives, so they can all be done at once
+	derivatives->assign(6 * n, 0.0);
+	ThreadPool::Shared().ParallelFor(n, [&](int j) {
+		const double* h = &state[6 * j];
+		for (int s = 0; s < count; s++) {
+			const double* r = &positions[(j * count + s) * 3];
+			const double* v = &velocities[(j * count + s) * 3];
+
+			//pull of every other planet, averaged over its orbit
+			double force[3] = { 0.0, 0.0, 0.0 };
+			for (int other = 0; other < n; other++) {
+				if (other == j)
+					continue;
+				for (int t = 0; t < count; t++) {
+					const double* otherPosition = &positions[(other * count + t) * 3];
+					double d[3] = { otherPosition[0] - r[0], otherPosition[1] - r[1], otherPosition[2] - r[2] };
+					double distance2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+					double scale = G * planets[other].mass * weights[other * count + t] / (distance2 * sqrt(distance2) * count);
+					for (int k = 0; k < 3; k++)
+						force[k] += scale * d[k];
+				}
+			}
+
+			//dh/dt = r x F, de/dt = (F x h + v x (r x F)) / mu
+			double torque[3] = { r[1] * force[2] - r[2] * force[1], r[2] * force[0] - r[0] * force[2], r[0] * force[1] - r[1] * force[0] };
+			double forceCrossH[3] = { force[1] * h[2] - force[2] * h[1], force[2] * h[0] - force[0] * h[2], force[0] * h[1] - force[1] * h[0] };
+			double vCrossTorque[3] = { v[1] * torque[2] - v[2] * torque[1], v[2] * torque[0] - v[0] * torque[2], v[0] * torque[1] - v[1] * torque[0] };
+			double weight = weights[j * count + s] / count;
+			for (int k = 0; k < 3; k++) {
+				(*derivatives)[6 * j + k] += weight * torque[k];
+				(*derivatives)[6 * j + 3 + k] += weight * (forceCrossH[k] + vCrossTorque[k]) / planets[j].mu;
+			}
+		}
+	});
+}
+
+//one RK4 step of the averaged equations
+void Secular::StepHigherOrder(double dt)
+{
+	int n = planets.size();
+	std::vector<double> state(6 * n);
+	for (int j = 0; j < n; j++) {
+		std::copy(planets[j].h, planets[j].h + 3, state.begin() + 6 * j);
+		std::copy(planets[j].e, planets[j].e + 3, state.begin() + 6 * j + 3);
+	}
+
+	std::vector<double> k1, k2, k3, k4, temporary(6 * n);
+	GetDerivatives(state, &k1);
+	for (int i = 0; i < 6 * n; i++)
+		temporary[i] = state[i] + 0.5 * dt * k1[i];
+	GetDerivatives(temporary, &k2);
+	for (int i = 0; i < 6 * n; i++)
+		temporary[i] = state[i] + 0.5 * dt * k2[i];
+	GetDerivatives(temporary, &k3);
+	for (int i = 0; i < 6 * n; i++)
+		temporary[i] = state[i] + dt * k3[i];
+	GetDerivatives(temporary, &k4);
+
+	for (int j = 0; j < n; j++) {
+		for (int k = 0; k < 3; k++) {
+			int i = 6 * j + k;
+			planets[j].h[k] += dt / 6.0 * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
+			i += 3;
+			planets[j].e[k] += dt / 6.0 * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
+		}
+	}
+}
+
+//elements of the planet's current orbit, with the planet where its mean longitude puts it at time t
+OrbitalElements Secular::GetElements(const Planet& planet, double t)
+{
+	double p[3], q[3];
+	GetBasis(planet.h, planet.e, p, q);
+	double eccentricity = std::min(sqrt(planet.e[0] * planet.e[0] + planet.e[1] * planet.e[1] + planet.e[2] * planet.e[2]), 0.999);
+
+	//state at periapsis, which FromState turns into the angles
+	double periapsis = planet.semimajorAxis * (1.0 - eccentricity);
+	double speed = sqrt(planet.mu * (1.0 + eccentricity) / periapsis);
+	float position[3], velocity[3];
+	for (int k = 0; k < 3; k++) {
+		position[k] = periapsis * p[k];
+		velocity[k] = speed * q[k];
+	}
+
+	OrbitalElements elements = OrbitalElements::FromState(planet.mu, position, velocity);
+	double meanLongitude = planet.meanLongitude + planet.meanMotion * t;
+	double meanAnomaly = fmod(meanLongitude - elements.argumentOfPeriapsis - elements.longitudeOfAscendingNode, 2.0 * 3.14159265358979);
+	elements.meanAnomaly = meanAnomaly < 0.0 ? meanAnomaly + 2.0 * 3.14159265358979 : meanAnomaly;
+	return elements;
+}
+
+//p points to periapsis and q 90 degrees ahead of it in the direction of motion. Circular orbits use the ascending node
+//(or the x axis if the orbit is flat) in place of periapsis
+void Secular::GetBasis(const double h[3], const double e[3], double p[3], double q[3])
+{
+	double hMagnitude = sqrt(h[0] * h[0] + h[1] * h[1] + h[2] * h[2]);
+	double eMagnitude = sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+	double hUnit[3] = { h[0] / hMagnitude, h[1] / hMagnitude, h[2] / hMagnitude };
+
+	if (eMagnitude > 1e-12) {
+		for (int k = 0; k < 3; k++)
+			p[k] = e[k] / eMagnitude;
+	}
+	else {
+		double node[3] = { -hUnit[1], hUnit[0], 0.0 };
+		double nodeMagnitude = sqrt(node[0] * node[0] + node[1] * node[1]);
+		if (nodeMagnitude < 1e-12) {
+			node[0] = 1.0;
+			node[1] = 0.0;
+			nodeMagnitude = 1.0;
+		}
+		for (int k = 0; k < 3; k++)
+			p[k] = node[k] / nodeMagnitude;
+	}
+
+	q[0] = hUnit[1] * p[2] - hUnit[2] * p[1];
+	q[1] = hUnit[2] * p[0] - hUnit[0] * p[2];
+	q[2] = hUnit[0] * p[1] - hUnit[1] * p[0];
+}
+
+//b_s^(j)(alpha) = 1/pi * integral from 0 to 2pi of cos(j psi) / (1 - 2 alpha cos(psi) + alpha^2)^s dpsi.
+//The integrand is smooth and periodic, so the trapezoid rule converges very quickly
+double Secular::LaplaceCoefficient(double s, int j, double alpha)
+{
+	const int points = 512;
+	double sum = 0.0;
+	for (int i = 0; i < points; i++) {
+		double psi = 2.0 * 3.14159265358979 * i / points;
+		sum += cos(j * psi) / pow(1.0 - 2.0 * alpha * cos(psi) + alpha * alpha, s);
+	}
+
+	return 2.0 * sum / points;
+}
+
+//cyclic jacobi eigenvalue algorithm. vectors holds the eigenvectors as columns, row major
+//https://en.wikipedia.org/wiki/Jacobi_eigenvalue_algorithm
+void Secular::SymmetricEigen(std::vector<double> matrix, int n, std::vector<double>* values, std::vector<double>* vectors)
+{
+	vectors->assign(n * n, 0.0);
+	for (int i = 0; i < n; i++)
+		(*vectors)[i * n + i] = 1.0;
+
+	for (int sweep = 0; sweep < 100; sweep++) {
+		double diagonal = 0.0, offDiagonal = 0.0;
+		for (int p = 0; p < n; p++) {
+			diagonal += matrix[p * n + p] * matrix[p * n + p];
+			for (int q = p + 1; q < n; q++)
+				offDiagonal += matrix[p * n + q] * matrix[p * n + q];
+		}
+		if (offDiagonal <= 1e-30 * diagonal)
+			break;
+
+		for (int p = 0; p < n; p++) {
+			for (int q = p + 1; q < n; q++) {
+				if (matrix[p * n + q] == 0.0)
+					continue;
+
+				double theta = (matrix[q * n + q] - matrix[p * n + p]) / (2.0 * matrix[p * n + q]);
+				double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+				double c = 1.0 / sqrt(t * t + 1.0);
+				double s = t * c;
+
+				for (int k = 0; k < n; k++) {
+					double kp = matrix[k * n + p], kq = matrix[k * n + q];
+					matrix[k * n + p] = c * kp - s * kq;
+					matrix[k * n + q] = s * kp + c * kq;
+				}
+				for (int k = 0; k < n; k++) {
+					double pk = matrix[p * n + k], qk = matrix[q * n + k];
+					matrix[p * n + k] = c * pk - s * qk;
+					matrix[q * n + k] = s * pk + c * qk;
+				}
+				for (int k = 0; k < n; k++) {
+					double kp = (*vectors)[k * n + p], kq = (*vectors)[k * n + q];
+					(*vectors)[k * n + p] = c * kp - s * kq;
+					(*vectors)[k * n + q] = s * kp + c * kq;
+				}
+			}
+		}
+	}
+
+	values->assign(n, 0.0);
+	for (int i = 0; i < n; i++)
+		(*values)[i] = matrix[i * n + i];
+}
@@ -0,0 +1,75 @@
+#ifndef SECULAR_H
+#define SECULAR_H
+
+#pragma once
+#include "Physics.h"
+
+#include <atomic>
+#include <vector>
+
+//Orbit-averaged evolution for timescales far too long to step through directly. The planets (objects orbiting the heaviest object)
+//are turned into orbital elements, and only the slow changes of their eccentricities and inclinations are followed.
+//Semimajor axes are constant and the planets move along their orbits at their mean motion. Positions and velocities are only
+//worked out for the frames that are kept. Everything else (moons, the central object) follows its initial two body orbit.
+//Laplace-Lagrange: Murray & Dermott, Solar System Dynamics, chapter 7
+class Secular
+{
+public:
+	Secular() {};
+	~Secular() {};
+
+	//returns frameCount + 1 frames spaced by frameInterval, starting with initialObjects. Units of the output match initialObjects
+	std::vector<std::vector<PhysObject>> Run(Physics* physics, std::vector<PhysObject> initialObjects, float frameInterval, int frameCount);
+
+	//instead of the linear Laplace-Lagrange solution, integrate the equations averaged numerically over both orbits of every pair.
+	//Keeps all orders in eccentricity and inclination, but costs a full integration instead of an exact solution
+	bool higherOrder = false;
+	//points per orbit used for the averaging in higher order mode. Too few, and the average for planets close together
+	//(like Venus and Earth) picks up large errors from whichever sample points happen to be nearest
+	int samples = 32;
+	//longest integration step in higher order mode, in years. The fastest secular periods are tens of thousands of years
+	float maxStep = 1000.0f;
+
+	//progress, readable from other threads while Run is going
+	std::atomic<int> framesDone = { 0 };
+	std::atomic<bool> finished = { false };
+	std::atomic<bool> cancel = { false };
+
+private:
+	//h = specific angular momentum, e = eccentricity vector. Both are constant on a two body orbit, and together with
+	//the semimajor axis and mean longitude they give the whole orbit without any singularity at zero eccentricity or inclination
+	struct Planet
+	{
+		int index;
+		double mass;
+		double mu;
+		double semimajorAxis;
+		double meanMotion;
+		double meanLongitude;
+		double h[3];
+		double e[3];
+	};
+
+	void SetupLaplaceLagrange(double centralMass);
+	void EvaluateLaplaceLagrange(double t);
+	void GetDerivatives(const std::vector<double>& state, std::vector<double>* derivatives);
+	void StepHigherOrder(double dt);
+	OrbitalElements GetElements(const Planet& planet, double t);
+
+	static void GetBasis(const double h[3], const double e[3], double p[3], double q[3]);
+	static double LaplaceCoefficient(double s, int j, double alpha);
+	static void SymmetricEigen(std::vector<double> matrix, int n, std::vector<double>* values, std::vector<double>* vectors);
+
+	std::vector<Planet> planets;
+	double G;
+
+	//Laplace-Lagrange solution, in the symmetrized form S = V diag(g) V^T.
+	//Eccentricity uses z = k + i h = e exp(i longitude of periapsis), inclination uses zeta = q + i p = I exp(i node)
+	std::vector<double> scale;
+	std::vector<double> eccentricityFrequencies, eccentricityModes;
+	std::vector<double> inclinationFrequencies, inclinationModes;
+	//initial amplitudes of every mode, as (real, imaginary) pairs
+	std::vector<double> eccentricityAmplitudes, inclinationAmplitudes;
+};
+
+#endif
@@ -9,9 +9,6 @@ Simulation::Simulation(std::string physicsSource)
 	Physics::FromXml(&physics, physicsSource, userInterface.textureFolders);
 	userInterface.InitObjectDataWindows(physics.getCurrentObjects());
 
-	for (int i = 0; i < physics.getCurrentObjects().size(); i++)
-		physics.paths.push_back({});
-
 	//glfw requires static functions for callbacks. Store this object in the UserPointer,
 	//set static wrapper function as callbacks, getting the actual callbacks from the UserPointer so I can access all the data in the callbacks
 	glfwSetWindowUserPointer(graphics.window, this);
@@ -40,17 +37,19 @@ void Simulation::update()
 
 	userInterface.ShowMainUi(&physics, &graphics);
 
+	//streamed frames are only computed a little ahead, so wait at either end for them instead of looping
+	bool streaming = userInterface.IsStreaming();
 	if (!userInterface.isPaused && physics.dataIndex + physics.playbackSpeed > (int)physics.computedData.size() - 1) {
-		physics.dataIndex = 0;
+		physics.dataIndex = streaming ? (int)physics.computedData.size() - 1 : 0;
 	}
 	else if (!userInterface.isPaused && physics.dataIndex + physics.playbackSpeed < 0) {
-		physics.dataIndex = (int)physics.computedData.size() - 1;
+		physics.dataIndex = streaming ? 0 : (int)physics.computedData.size() - 1;
 	}
 	else if (!userInterface.isPaused) {
 		physics.dataIndex += physics.playbackSpeed;
 	}
 
-	physics.time = physics.timestep.GetBaseValue() * physics.dataIndex;
+	physics.time = physics.GetFrameTime(physics.dataIndex);
 
 	// Clear the colorbuffer
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -0,0 +1,257 @@
+#include "Snapshot.h"
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+
+static const char snapshotMagic[8] = "ASTSNAP";
+
+uint64_t Snapshot::ColumnBytes(int column, uint64_t objectCount)
+{
+	switch (column) {
+	case Names:
+	case Satellites:
+	case Textures:
+		return objectCount * 2 * sizeof(uint32_t);
+	case Positions:
+	case Velocities:
+	case Colors:
+		return objectCount * 3 * sizeof(float);
+	default:
+		return objectCount * 4;
+	}
+}
+
+bool Snapshot::IsSnapshotName(std::string filename)
+{
+	return filename.size() > 5 && filename.substr(filename.size() - 5) == ".snap";
+}
+
+bool Snapshot::Write(Physics* physics, std::string filename)
+{
+	return Write(Physics::GetSaveState(physics), filename);
+}
+
+//building the columns is most of the work, so it's the first half of the progress, and writing them the second
+bool Snapshot::Write(const SaveState& state, std::string filename, std::atomic<float>* progress)
+{
+	const std::vector<PhysObject>& objects = state.objects;
+	size_t n = objects.size();
+
+	std::string strings = "";
+	std::vector<uint32_t> names(2 * n), satellites(2 * n), textures(2 * n);
+	auto addString = [&](const std::string& text, uint32_t* reference) {
+		reference[0] = strings.size();
+		reference[1] = text.size();
+		strings += text;
+	};
+
+	std::vector<float> masses(n), radii(n), rotationPeriods(n), axialTilts(n), historyAngles(n);
+	std::vector<float> positions(3 * n), velocities(3 * n), colors(3 * n);
+	std::vector<int32_t> historyPolicies(n), historyFrames(n), displayTypes(n);
+	for (size_t i = 0; i < n; i++) {
+		PhysObject object = Physics::InSaveUnits(objects[i]);
+		const ObjectSettings& settings = state.objectSettings[i];
+
+		std::string satelliteList = "";
+		for (int j = 0; j < object.satellites.size(); j++)
+			satelliteList += (j == 0 ? "" : ",") + object.satellites[j];
+		addString(object.name, &names[2 * i]);
+		addString(satelliteList, &satellites[2 * i]);
+		addString(settings.texture, &textures[2 * i]);
+
+		masses[i] = object.mass.value;
+		radii[i] = object.radius.value;
+		rotationPeriods[i] = object.rotationPeriod.value;
+		axialTilts[i] = object.axialTilt.value;
+		for (int k = 0; k < 3; k++) {
+			positions[3 * i + k] = object.position.value[k];
+			velocities[3 * i + k] = object.velocity.value[k];
+			colors[3 * i + k] = settings.color[k];
+		}
+		historyPolicies[i] = settings.historyPolicy;
+		historyFrames[i] = settings.historyFrames;
+		historyAngles[i] = settings.historyAngle;
+		displayTypes[i] = (int32_t)settings.displayType;
+		if (progress && i % 1024 == 0)
+			*progress = 0.5f * i / n;
+	}
+	if (strings.size() > UINT32_MAX)
+		return false;
+
+	const void* columnData[ColumnCount] = { names.data(), satellites.data(), textures.data(), masses.data(), radii.data(), rotationPeriods.data(),
+		axialTilts.data(), positions.data(), velocities.data(), colors.data(), historyPolicies.data(), historyFrames.data(), historyAngles.data(), displayTypes.data() };
+
+	Header header = {};
+	std::memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.objectCount = n;
+	header.time = state.time;
+	header.columnCount = ColumnCount;
+	header.stringOffset = sizeof(Header);
+	header.stringBytes = strings.size();
+	uint64_t offset = header.stringOffset + header.stringBytes;
+	for (int c = 0; c < ColumnCount; c++) {
+		offset = (offset + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+		header.columns[c] = offset;
+		offset += ColumnBytes(c, n);
+	}
+
+	std::FILE* file = nullptr;
+#ifdef _WIN32
+	fopen_s(&file, filename.c_str(), "wb");
+#else
+	file = std::fopen(filename.c_str(), "wb");
+#endif
+	if (!file)
+		return false;
+
+	bool written = std::fwrite(&header, sizeof(Header), 1, file) == 1 && std::fwrite(strings.data(), 1, strings.size(), file) == strings.size();
+	uint64_t position = header.stringOffset + header.stringBytes;
+	const char padding[SNAPSHOT_ALIGNMENT] = {};
+	for (int c = 0; c < ColumnCount && written; c++) {
+		size_t gap = header.columns[c] - position;
+		size_t bytes = ColumnBytes(c, n);
+		written = std::fwrite(padding, 1, gap, file) == gap && std::fwrite(columnData[c], 1, bytes, file) == bytes;
+		position = header.columns[c] + bytes;
+		if (progress)
+			*progress = 0.5f + 0.5f * (c + 1) / ColumnCount;
+	}
+	return std::fclose(file) == 0 && written;
+}
+
+bool Snapshot::Validate(const char* data, uint64_t size, Header* header, std::string* description)
+{
+	if (size < sizeof(Header)) {
+		*description = "Not a snapshot";
+		return false;
+	}
+	std::memcpy(header, data, sizeof(Header));
+	if (std::memcmp(header->magic, snapshotMagic, sizeof(header->magic)) != 0) {
+		*description = "Not a snapshot";
+		return false;
+	}
+	if (header->version > SNAPSHOT_VERSION) {
+		*description = "Snapshot from a newer version";
+		return false;
+	}
+	if (header->columnCount < ColumnCount) {
+		*description = "Snapshot from an older version, or a damaged one";
+		return false;
+	}
+
+	*description = "Damaged snapshot";
+	if (header->stringOffset > size || header->stringBytes > size - header->stringOffset)
+		return false;
+	uint64_t n = header->objectCount;
+	for (int c = 0; c < ColumnCount; c++) {
+		if (header->columns[c] % SNAPSHOT_ALIGNMENT != 0 || header->columns[c] > size || ColumnBytes(c, n) > size - header->columns[c])
+			return false;
+	}
+
+	const uint32_t* names = (const uint32_t*)(data + header->columns[Names]);
+	const uint32_t* satellites = (const uint32_t*)(data + header->columns[Satellites]);
+	const uint32_t* textures = (const uint32_t*)(data + header->columns[Textures]);
+	const int32_t* historyPolicies = (const int32_t*)(data + header->columns[HistoryPolicies]);
+	const int32_t* displayTypes = (const int32_t*)(data + header->columns[DisplayTypes]);
+	auto validString = [&](const uint32_t* reference) {
+		return reference[0] <= header->stringBytes && reference[1] <= header->stringBytes - reference[0];
+	};
+	for (uint64_t i = 0; i < n; i++) {
+		if (!validString(&names[2 * i]) || !validString(&satellites[2 * i]) || !validString(&textures[2 * i])
+			|| historyPolicies[i] < HISTORY_NONE || historyPolicies[i] > HISTORY_ADAPTIVE || displayTypes[i] < 0 || displayTypes[i] > (int)ObjectSettings::DisplayTypes::Sphere)
+			return false;
+	}
+
+	description->clear();
+	return true;
+}
+
+bool Snapshot::Check(std::string filename, std::string* description, int* objectCount, float* time)
+{
+	MappedFile file;
+	if (!file.Open(filename)) {
+		*description = "Couldn't open the file";
+		return false;
+	}
+
+	Header header;
+	if (!Validate(file.Data(), file.Size(), &header, description))
+		return false;
+	if (objectCount)
+		*objectCount = header.objectCount;
+	if (time)
+		*time = header.time;
+	return true;
+}
+
+bool Snapshot::Read(Physics* physics, std::string filename, std::vector<std::string> textureFolders)
+{
+	MappedFile file;
+	Header header;
+	std::string description;
+	if (!file.Open(filename) || !Validate(file.Data(), file.Size(), &header, &description))
+		return false;
+	uint64_t n = header.objectCount;
+
+	//the columns are aligned, and so is the mapping, so they are read in place
+	const char* data = file.Data();
+	const char* strings = data + header.stringOffset;
+	const uint32_t* names = (const uint32_t*)(data + header.columns[Names]);
+	const uint32_t* satellites = (const uint32_t*)(data + header.columns[Satellites]);
+	const uint32_t* textures = (const uint32_t*)(data + header.columns[Textures]);
+	const float* masses = (const float*)(data + header.columns[Masses]);
+	const float* radii = (const float*)(data + header.columns[Radii]);
+	const float* rotationPeriods = (const float*)(data + header.columns[RotationPeriods]);
+	const float* axialTilts = (const float*)(data + header.columns[AxialTilts]);
+	const float* positions = (const float*)(data + header.columns[Positions]);
+	const float* velocities = (const float*)(data + header.columns[Velocities]);
+	const float* colors = (const float*)(data + header.columns[Colors]);
+	const int32_t* historyPolicies = (const int32_t*)(data + header.columns[HistoryPolicies]);
+	const int32_t* historyFrames = (const int32_t*)(data + header.columns[HistoryFrames]);
+	const float* historyAngles = (const float*)(data + header.columns[HistoryAngles]);
+	const int32_t* displayTypes = (const int32_t*)(data + header.columns[DisplayTypes]);
+
+	//every reference and enum has been checked by Validate already
+	auto getString = [&](const uint32_t* reference, std::string* text) {
+		text->assign(strings + reference[0], reference[1]);
+	};
+
+	std::vector<PhysObject> objects = {};
+	std::vector<ObjectSettings> objectSettings = {};
+	objects.reserve(n);
+	objectSettings.reserve(n);
+	std::string name, satelliteList, texture;
+	for (uint64_t i = 0; i < n; i++) {
+		getString(&names[2 * i], &name);
+		getString(&satellites[2 * i], &satelliteList);
+		getString(&textures[2 * i], &texture);
+
+		int textureIndex = -1;
+		if (texture != "") {
+			for (int t = 0; t < textureFolders.size(); t++) {
+				if (textureFolders[t] == texture) {
+					textureIndex = t;
+					break;
+				}
+			}
+		}
+
+		float position[3] = { positions[3 * i], positions[3 * i + 1], positions[3 * i + 2] };
+		float velocity[3] = { velocities[3 * i], velocities[3 * i + 1], velocities[3 * i + 2] };
+		objects.push_back(PhysObject(name, masses[i], position, velocity, radii[i], rotationPeriods[i], axialTilts[i], Physics::SplitString(satelliteList, ",")));
+
+		ObjectSettings settings(false, "", "", textureIndex);
+		settings.texture = texture;
+		settings.historyPolicy = historyPolicies[i];
+		settings.historyFrames = historyFrames[i];
+		settings.historyAngle = historyAngles[i];
+		settings.displayType = (ObjectSettings::DisplayTypes)displayTypes[i];
+		for (int k = 0; k < 3; k++)
+			settings.color[k] = colors[3 * i + k];
+		objectSettings.push_back(settings);
+	}
+
+	Physics::LoadScenario(physics, header.time, std::move(objects), std::move(objectSettings));
+	return true;
+}
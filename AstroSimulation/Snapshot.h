@@ -0,0 +1,67 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#pragma once
+#include "Physics.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//files newer than this can't be read
+#define SNAPSHOT_VERSION 1
+//columns start on boundaries this far apart
+#define SNAPSHOT_ALIGNMENT 64
+
+//A save file in binary, for scenarios with far too many objects to parse as xml. It has everything an xml save has, with the same
+//values in the same units, so converting between the two loses nothing. Layout: a fixed header, a string table with every name,
+//satellite list and texture, then one column per value, with that value for every object. Strings are (start, length) pairs into
+//the table. Loading maps the file and copies the columns straight into the objects, without parsing anything
+class Snapshot
+{
+public:
+	static bool Write(Physics* physics, std::string filename);
+	//sets progress (0 to 1) as it goes, if it isn't null
+	static bool Write(const SaveState& state, std::string filename, std::atomic<float>* progress = nullptr);
+	static bool Read(Physics* physics, std::string filename, std::vector<std::string> textureFolders);
+	//snapshots end in .snap, and everything else is xml
+	static bool IsSnapshotName(std::string filename);
+	//makes the same checks loading does, without loading anything. Fills in description with what's wrong if it isn't a snapshot
+	//this version can read, and objectCount and time from the header if it is and they aren't null
+	static bool Check(std::string filename, std::string* description, int* objectCount = nullptr, float* time = nullptr);
+
+private:
+	enum Column
+	{
+		//(start, length) pairs. Satellites are separated by commas, like in xml
+		Names, Satellites, Textures,
+		//floats
+		Masses, Radii, RotationPeriods, AxialTilts,
+		//x, y, z floats
+		Positions, Velocities, Colors,
+		//ints, except the angle
+		HistoryPolicies, HistoryFrames, HistoryAngles, DisplayTypes,
+		ColumnCount
+	};
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t objectCount;
+		float time;
+		uint32_t columnCount;
+		uint64_t stringOffset;
+		uint64_t stringBytes;
+		//where each column starts, from the start of the file
+		uint64_t columns[ColumnCount];
+	};
+
+	static uint64_t ColumnBytes(int column, uint64_t objectCount);
+	//everything Read relies on: the header, where the columns are, and every string reference and enum in them.
+	//Copies the header out if it is all fine, and says what's wrong in description if it isn't
+	static bool Validate(const char* data, uint64_t size, Header* header, std::string* description);
+};
+
+#endif
@@ -0,0 +1,165 @@
+#include "StabilityMap.h"
+
+void StabilityMap::Run(Physics* physics, std::vector<PhysObject> objects, int primary, float dt, int steps)
+{
+	cellsDone = 0;
+	finished = false;
+
+	//the settings can be edited while the map is running, so only read them here
+	int columns = width;
+	int rows = height;
+	float minA = minSemimajorAxis.GetBaseValue();
+	float maxA = maxSemimajorAxis.GetBaseValue();
+	float minE = minEccentricity;
+	float maxE = maxEccentricity;
+	startInclination = inclination.GetBaseValue() * 3.14159265f / 180.0f;
+	startMeanAnomaly = meanAnomaly.GetBaseValue() * 3.14159265f / 180.0f;
+	escapeDistance = escapeFactor * maxA;
+	cells.assign(columns * rows, StabilityCell());
+
+	objectCount = objects.size();
+	G = physics->G;
+	masses = {};
+	radii = {};
+	for (int i = 0; i < objectCount; i++) {
+		masses.push_back(objects[i].mass.value);
+		radii.push_back(objects[i].radius.GetBaseValue());
+	}
+
+	//the primary's velocity is only needed at the start, to put the test planet in orbit around it
+	std::copy(objects[primary].velocity.value, objects[primary].velocity.value + 3, primaryVelocity);
+
+	trajectory.assign((size_t)(steps + 1) * objectCount * 3, 0.0f);
+	for (int step = 0; step <= steps && !cancel; step++) {
+		if (step > 0)
+			physics->Advance(dt, &objects);
+		for (int i = 0; i < objectCount; i++)
+			std::copy(objects[i].position.value, objects[i].position.value + 3, trajectory.begin() + ((size_t)step * objectCount + i) * 3);
+	}
+
+	float mu = G * masses[primary];
+
+	//a row at a time, so each task is big enough to be worth handing to a thread
+	ThreadPool::Shared().ParallelFor(rows, [&](int row) {
+		float eccentricity = minE + (maxE - minE) * (row + 0.5f) / rows;
+		for (int column = 0; column < columns && !cancel; column++) {
+			float semimajorAxis = minA + (maxA - minA) * (column + 0.5f) / columns;
+			cells[row * columns + column] = RunCell(semimajorAxis, eccentricity, mu, primary, dt, steps);
+			cellsDone++;
+		}
+	});
+
+	finished = true;
+}
+
+//velocity verlet for the test planet, with the same steps applied to the tangent vector (dx, dv) through the jacobian of the acceleration.
+//Everything is in doubles, so the indicator measures the dynamics rather than roundoff
+StabilityCell StabilityMap::RunCell(float semimajorAxis, float eccentricity, float mu, int primary, float dt, int steps)
+{
+	StabilityCell cell;
+
+	OrbitalElements elements;
+	elements.semimajorAxis = semimajorAxis;
+	elements.eccentricity = eccentricity;
+	elements.inclination = startInclination;
+	elements.meanAnomaly = startMeanAnomaly;
+	float relativePosition[3], relativeVelocity[3];
+	elements.ToState(mu, relativePosition, relativeVelocity);
+
+	double x[3], v[3];
+	for (int k = 0; k < 3; k++) {
+		x[k] = trajectory[primary * 3 + k] + relativePosition[k];
+		v[k] = primaryVelocity[k] + relativeVelocity[k];
+	}
+
+	//any starting direction works, since it turns towards the fastest growing one
+	double dx[3], dv[3];
+	for (int k = 0; k < 3; k++) {
+		dx[k] = 1.0 / sqrt(6.0);
+		dv[k] = 1.0 / sqrt(6.0);
+	}
+
+	double a[3], jacobian[9];
+	bool hit = false;
+	GetAcceleration(0, x, a, jacobian, &hit);
+
+	//running sums of t * dln|d| for MEGNO, of the MEGNO values for its mean, and of dln|d| for the lyapunov exponent
+	double weightedGrowth = 0.0, megnoSum = 0.0, totalGrowth = 0.0;
+	double meanMegno = 0.0;
+	for (int step = 0; step < steps && !cancel; step++) {
+		double da[3];
+		for (int k = 0; k < 3; k++) {
+			da[k] = jacobian[3 * k] * dx[0] + jacobian[3 * k + 1] * dx[1] + jacobian[3 * k + 2] * dx[2];
+			v[k] += .5 * dt * a[k];
+			dv[k] += .5 * dt * da[k];
+		}
+		for (int k = 0; k < 3; k++) {
+			x[k] += dt * v[k];
+			dx[k] += dt * dv[k];
+		}
+
+		GetAcceleration(step + 1, x, a, jacobian, &hit);
+		for (int k = 0; k < 3; k++) {
+			da[k] = jacobian[3 * k] * dx[0] + jacobian[3 * k + 1] * dx[1] + jacobian[3 * k + 2] * dx[2];
+			v[k] += .5 * dt * a[k];
+			dv[k] += .5 * dt * da[k];
+		}
+
+		//the tangent vector starts every step with length 1, so its log length is this step's growth. Renormalizing keeps it from overflowing
+		double length = sqrt(dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2] + dv[0] * dv[0] + dv[1] * dv[1] + dv[2] * dv[2]);
+		double growth = log(length);
+		for (int k = 0; k < 3; k++) {
+			dx[k] /= length;
+			dv[k] /= length;
+		}
+
+		double t = (step + 1) * (double)dt;
+		weightedGrowth += t * growth;
+		totalGrowth += growth;
+		megnoSum += 2.0 * weightedGrowth / t;
+		meanMegno = megnoSum / (step + 1);
+
+		double px = x[0] - trajectory[((size_t)(step + 1) * objectCount + primary) * 3];
+		double py = x[1] - trajectory[((size_t)(step + 1) * objectCount + primary) * 3 + 1];
+		double pz = x[2] - trajectory[((size_t)(step + 1) * objectCount + primary) * 3 + 2];
+		if (hit || px * px + py * py + pz * pz > escapeDistance * escapeDistance) {
+			cell.escaped = true;
+			cell.megno = meanMegno;
+			cell.lyapunov = totalGrowth / t;
+			return cell;
+		}
+	}
+
+	cell.megno = meanMegno;
+	cell.lyapunov = steps > 0 ? totalGrowth / (steps * (double)dt) : 0.0;
+	return cell;
+}
+
+//acceleration of the test planet at position, from the massive objects at the given step, and its jacobian d(acceleration) / d(position), row major.
+//hit is set if the position is inside one of the objects
+void StabilityMap::GetAcceleration(int frame, const double position[3], double acceleration[3], double jacobian[9], bool* hit)
+{
+	std::fill(acceleration, acceleration + 3, 0.0);
+	std::fill(jacobian, jacobian + 9, 0.0);
+
+	const float* frameStart = &trajectory[(size_t)frame * objectCount * 3];
+	for (int i = 0; i < objectCount; i++) {
+		double d[3] = {
+			frameStart[3 * i] - position[0],
+			frameStart[3 * i + 1] - position[1],
+			frameStart[3 * i + 2] - position[2]
+		};
+		double r2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+		double r = sqrt(r2);
+		if (r < radii[i])
+			*hit = true;
+
+		double scale = G * masses[i] / (r2 * r);
+		for (int k = 0; k < 3; k++) {
+			acceleration[k] += scale * d[k];
+			//d/dx of G m d / r^3 = G m (3 d d^T / r^5 - I / r^3)
+			for (int l = 0; l < 3; l++)
+				jacobian[3 * k + l] += scale * (3.0 * d[k] * d[l] / r2 - (k == l ? 1.0 : 0.0));
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#ifndef STABILITYMAP_H
+#define STABILITYMAP_H
+
+#pragma once
+#include "Physics.h"
+
+#include <atomic>
+#include <vector>
+
+//chaos indicators for one starting orbit of the test planet
+struct StabilityCell
+{
+	//mean exponential growth factor of nearby orbits. Settles at 2 for regular orbits, and keeps growing for chaotic ones
+	float megno = 0.0f;
+	//finite time estimate of the largest lyapunov exponent, in 1 / years
+	float lyapunov = 0.0f;
+	//hit an object or got further than escapeFactor * maxSemimajorAxis from the primary before the end
+	bool escaped = false;
+};
+
+//stability map of a massless test planet over a grid of starting semimajor axes (columns) and eccentricities (rows).
+//Every cell integrates the planet together with its variational (tangent) equations, and turns the growth of the tangent vector into MEGNO.
+//https://en.wikipedia.org/wiki/Lyapunov_exponent
+//Cincotta & Simo 2000, "Simple tools to study global dynamics in non-axisymmetric galactic potentials"
+class StabilityMap
+{
+public:
+	StabilityMap() {};
+	~StabilityMap() {};
+
+	//objects must be in base units. The test planet orbits objects[primary]. Fills cells, row by row
+	void Run(Physics* physics, std::vector<PhysObject> objects, int primary, float dt, int steps);
+
+	int width = 64;
+	int height = 64;
+	ValueWithUnits<UnitType::Distance> minSemimajorAxis = ValueWithUnits<UnitType::Distance>(0.5f, 4);
+	ValueWithUnits<UnitType::Distance> maxSemimajorAxis = ValueWithUnits<UnitType::Distance>(5.0f, 4);
+	float minEccentricity = 0.0f;
+	float maxEccentricity = 0.5f;
+	//orientation of every starting orbit
+	ValueWithUnits<UnitType::Angle> inclination = ValueWithUnits<UnitType::Angle>(0.0f, 1);
+	ValueWithUnits<UnitType::Angle> meanAnomaly = ValueWithUnits<UnitType::Angle>(0.0f, 1);
+	float escapeFactor = 10.0f;
+
+	//row major, width * height of the last run
+	std::vector<StabilityCell> cells;
+
+	//progress, readable from other threads while Run is going
+	std::atomic<int> cellsDone = { 0 };
+	std::atomic<bool> finished = { false };
+	std::atomic<bool> cancel = { false };
+
+private:
+	StabilityCell RunCell(float semimajorAxis, float eccentricity, float mu, int primary, float dt, int steps);
+	void GetAcceleration(int frame, const double position[3], double acceleration[3], double jacobian[9], bool* hit);
+
+	//the massive objects don't feel the test planet, so their path is computed once and shared by every cell.
+	//component k of object i at step s is at [(s * objectCount + i) * 3 + k]
+	std::vector<float> trajectory;
+	float primaryVelocity[3];
+	std::vector<float> masses;
+	std::vector<float> radii;
+	int objectCount;
+	double G;
+	double escapeDistance;
+	float startInclination;
+	float startMeanAnomaly;
+};
+
+#endif
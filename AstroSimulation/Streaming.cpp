@@ -0,0 +1,112 @@
+#include "Streaming.h"
+
+#include <chrono>
+#include <thread>
+
+void Streaming::Run(std::vector<PhysObject> initialObjects, float dt, double startTime, Checkpoint::State settings)
+{
+	Physics physics;
+	settings.ApplyTo(&physics);
+
+	finished = false;
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		pendingFrames = {};
+		pendingTimes = {};
+		pendingSamples = {};
+	}
+
+	std::vector<PhysObject> objects = initialObjects;
+	double time = startTime;
+	//rewrites everything from this frame on if the run was restarted from an earlier one
+	if (recording.IsWriting())
+		recording.Write(framesDone, objects, time);
+	std::chrono::steady_clock::time_point lastCheckpoint = std::chrono::steady_clock::now();
+	while (!cancel) {
+		//far enough ahead. Nothing to do until playback catches up (or the window gets bigger)
+		if (framesDone >= playbackFrame + aheadFrames) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			continue;
+		}
+
+		double potentialEnergy;
+		physics.Advance(dt, &objects, &potentialEnergy);
+		ConservationSample sample = physics.MeasureConservation(objects, potentialEnergy);
+		time += dt;
+		if (recording.IsWriting())
+			recording.Write(framesDone + 1, objects, time);
+
+		//only a copy is handed over, the checkpoint's own thread does the writing
+		if (checkpoint.IsRunning() && std::chrono::steady_clock::now() - lastCheckpoint >= std::chrono::minutes(checkpointMinutes)
+			&& (!recording.IsWriting() || recording.writtenFrames == framesDone + 2)) {
+			checkpoint.Submit(settings.At(objects, framesDone + 1, time));
+			lastCheckpoint = std::chrono::steady_clock::now();
+		}
+
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		pendingFrames.push_back(objects);
+		pendingTimes.push_back(time);
+		pendingSamples.push_back(sample);
+		framesDone++;
+	}
+
+	//the recording is closed after Run, which writes the rest of its frames
+	if (checkpoint.IsRunning())
+		checkpoint.Submit(settings.At(objects, framesDone, time));
+	finished = true;
+}
+
+void Streaming::TakeFrames(std::vector<std::vector<PhysObject>>* frames, std::vector<double>* times, std::vector<ConservationSample>* samples)
+{
+	std::lock_guard<std::mutex> lock(pendingMutex);
+	frames->swap(pendingFrames);
+	times->swap(pendingTimes);
+	samples->swap(pendingSamples);
+	pendingFrames = {};
+	pendingTimes = {};
+	pendingSamples = {};
+}
+
+//one row per frame, with the time and the position and velocity of every object, all in base units
+bool Streaming::Spill(std::string filename, const std::vector<std::vector<PhysObject>>& frames, const std::vector<double>& times)
+{
+	if (frames.empty())
+		return true;
+
+	if (!spillFile.is_open()) {
+		spillFile.open(filename);
+		if (!spillFile.is_open())
+			return false;
+
+		spillFile << "Time";
+		for (int i = 0; i < frames[0].size(); i++) {
+			std::string name = frames[0][i].name;
+			spillFile << "," << name << " X," << name << " Y," << name << " Z,"
+				<< name << " VX," << name << " VY," << name << " VZ";
+		}
+		spillFile << std::endl;
+	}
+
+	for (int f = 0; f < frames.size(); f++) {
+		std::vector<PhysObject> objects = frames[f];
+		Physics::ConvertObjectsToBaseUnits(&objects);
+
+		spillFile << times[f];
+		for (int i = 0; i < objects.size(); i++) {
+			for (int k = 0; k < 3; k++)
+				spillFile << "," << objects[i].position.value[k];
+			for (int k = 0; k < 3; k++)
+				spillFile << "," << objects[i].velocity.value[k];
+		}
+		spillFile << "\n";
+	}
+	spillFile.flush();
+
+	return true;
+}
+
+void Streaming::CloseSpill()
+{
+	if (spillFile.is_open())
+		spillFile.close();
+}
@@ -0,0 +1,68 @@
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#pragma once
+#include "Physics.h"
+#include "HistoryFile.h"
+#include "Checkpoint.h"
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+//Open ended computation that stays a fixed number of frames ahead of playback, instead of computing a fixed total time up front.
+//Run integrates on its own thread and waits whenever it gets aheadFrames past the frame being shown. The ui thread picks up
+//the new frames every update, and frames more than retainFrames behind playback are dropped (or spilled to a csv file first),
+//so memory stays bounded no matter how long it plays. When recording, Run also writes every frame to a history file,
+//and the frames behind playback are read back from there instead of being dropped. With checkpoint started, Run also hands
+//its state to it every checkpointMinutes, so the run can be picked up again from there after a crash.
+class Streaming
+{
+public:
+	Streaming() {};
+	~Streaming() {};
+
+	//integrates from initialObjects, at startTime, until cancelled. Units of the frames match initialObjects.
+	//settings is Checkpoint::Capture of physics from when the run started. The run steps a physics of its own set up from them,
+	//so changing the settings in the ui doesn't change how it rounds, and every checkpoint gets them
+	void Run(std::vector<PhysObject> initialObjects, float dt, double startTime, Checkpoint::State settings);
+
+	//moves every frame finished since the last call into frames, with their times and conservation samples (measured against the conservationStart of settings)
+	void TakeFrames(std::vector<std::vector<PhysObject>>* frames, std::vector<double>* times, std::vector<ConservationSample>* samples);
+
+	//appends frames to the spill file, opening it (and writing the header) on the first call. Spill files are an export for
+	//other tools, and are never read back here; a recording (HistoryFile) is what can be played back
+	bool Spill(std::string filename, const std::vector<std::vector<PhysObject>>& frames, const std::vector<double>& times);
+	void CloseSpill();
+
+	//how far ahead of playback to compute, and how much to keep behind it
+	int aheadFrames = 500;
+	int retainFrames = 5000;
+	//write frames to ../streams before dropping them
+	bool spill = false;
+	//write every frame to ../histories. recording has to be created before Run, and is only written by Run while it's going
+	bool record = false;
+	HistoryFile recording;
+	//how often Run hands its state to checkpoint, and once more when it stops. checkpoint has to be started before Run.
+	//While recording, it waits for the next chunk to be written, so the file always has every frame up to the checkpoint
+	int checkpointMinutes = 10;
+	Checkpoint checkpoint;
+
+	//frames since streaming started, counting any before initialObjects. Set framesDone to the frame number of initialObjects before Run.
+	//The ui sets playbackFrame to the one it is showing
+	std::atomic<long long> framesDone = { 0 };
+	std::atomic<long long> playbackFrame = { 0 };
+	std::atomic<bool> finished = { false };
+	std::atomic<bool> cancel = { false };
+
+private:
+	std::mutex pendingMutex;
+	std::vector<std::vector<PhysObject>> pendingFrames;
+	std::vector<double> pendingTimes;
+	std::vector<ConservationSample> pendingSamples;
+
+	std::ofstream spillFile;
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+//set on pool threads (and on the calling thread while it helps out), so nested ParallelFor calls just run inline instead of deadlocking
+static thread_local bool insidePool = false;
+
+ThreadPool::ThreadPool(int threadCount)
+{
+	if (threadCount <= 0)
+		threadCount = std::thread::hardware_concurrency();
+
+	//the thread calling ParallelFor does work too, so it counts as one of the threads
+	for (int i = 0; i < threadCount - 1; i++)
+		workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+
+	for (int i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+ThreadPool& ThreadPool::Shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+int ThreadPool::GetThreadCount()
+{
+	return workers.size() + 1;
+}
+
+void ThreadPool::ParallelFor(int count, std::function<void(int)> task, int maxThreads)
+{
+	if (count <= 0)
+		return;
+
+	if (insidePool || workers.empty() || maxThreads == 1 || count == 1) {
+		for (int i = 0; i < count; i++)
+			task(i);
+		return;
+	}
+
+	Job job;
+	job.task = task;
+	job.count = count;
+	job.unfinished = count;
+	job.workerLimit = maxThreads <= 0 ? (int)workers.size() : maxThreads - 1;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	jobs.push_back(&job);
+	workAvailable.notify_all();
+
+	//the caller only works on its own job, so it never waits on a longer one started somewhere else
+	insidePool = true;
+	while (job.nextIndex < job.count) {
+		int index = job.nextIndex++;
+		if (job.nextIndex == job.count)
+			jobs.erase(std::find(jobs.begin(), jobs.end(), &job));
+		lock.unlock();
+		task(index);
+		lock.lock();
+		job.unfinished--;
+	}
+	insidePool = false;
+
+	//workers only touch the job with mutex held, and it is done with once unfinished is 0
+	workFinished.wait(lock, [&job] { return job.unfinished == 0; });
+}
+
+ThreadPool::Job* ThreadPool::PickJob()
+{
+	Job* picked = nullptr;
+	for (Job* job : jobs) {
+		if (job->nextIndex < job->count && job->workers < job->workerLimit && (!picked || job->workers < picked->workers))
+			picked = job;
+	}
+	return picked;
+}
+
+//workers take one index at a time and pick a job again after each, so a new call gets its share of the pool even while a long one is running
+void ThreadPool::WorkerLoop()
+{
+	insidePool = true;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		Job* job = nullptr;
+		workAvailable.wait(lock, [this, &job] { return stopping || (job = PickJob()) != nullptr; });
+		if (stopping)
+			return;
+
+		int index = job->nextIndex++;
+		if (job->nextIndex == job->count)
+			jobs.erase(std::find(jobs.begin(), jobs.end(), job));
+		job->workers++;
+		lock.unlock();
+		job->task(index);
+		lock.lock();
+		job->workers--;
+		if (--job->unfinished == 0)
+			workFinished.notify_all();
+	}
+}
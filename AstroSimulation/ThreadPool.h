@@ -0,0 +1,53 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fixed set of worker threads shared by everything that wants to run work in parallel.
+//Physics gets copied around by value, so it can't own threads itself. Use ThreadPool::Shared() instead.
+class ThreadPool
+{
+public:
+	ThreadPool(int threadCount = 0);
+	~ThreadPool();
+
+	//runs task(0) ... task(count - 1), using at most maxThreads threads (including the caller). Blocks until all are done.
+	//maxThreads <= 0 means use every thread in the pool. Calls from different threads run at the same time, and share the workers
+	void ParallelFor(int count, std::function<void(int)> task, int maxThreads = 0);
+	int GetThreadCount();
+
+	static ThreadPool& Shared();
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable workAvailable;
+	std::condition_variable workFinished;
+
+	//one ParallelFor call. It lives on the caller's stack, and is in jobs while it still has indices to hand out
+	struct Job
+	{
+		std::function<void(int)> task;
+		int count = 0;
+		int nextIndex = 0;
+		int unfinished = 0;
+		//workers helping right now, besides the caller, and how many may
+		int workers = 0;
+		int workerLimit = 0;
+	};
+	//the job with indices left and room for another worker that has the fewest workers, so concurrent calls share the pool. Null if none
+	Job* PickJob();
+
+	//every ParallelFor that is running, from any thread. Guarded by mutex
+	std::vector<Job*> jobs;
+	bool stopping = false;
+};
+
+#endif
@@ -8,11 +8,15 @@ void UserInterface::InitUserInterface(GLFWwindow * window)
 
 	// Initialize ImGui
 	ImGui_ImplGlfwGL3_Init(window, false);
-	saveFiles = GetAllFilesInFolder("../saves");
-	selected.resize(saveFiles.size());
-	std::fill(selected.begin(), selected.end(), false);
+	saveCatalog.Start("../saves");
+	UpdateSaveFiles();
 	if (!selected.empty())
 		selected[0] = true;
+	std::vector<std::string> histories = GetAllFilesInFolder("../histories");
+	for (int i = 0; i < histories.size(); i++) {
+		if (histories[i].size() > 5 && histories[i].substr(histories[i].size() - 5) == ".hist")
+			historyFiles.push_back(histories[i]);
+	}
 
 	WindowFlags = 0;
 	WindowFlags |= ImGuiWindowFlags_AlwaysAutoResize;
@@ -145,24 +149,48 @@ void UserInterface::LoadPopup(Physics* physics) {
 		ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(3, 12));
 		std::vector<std::string> invalidFiles = {};
 
-		for (int i = 0; i < saveFiles.size(); i++)
+		//the files are checked by saveCatalog in the background, and only once each, so nothing gets parsed here
+		for (int i = 0; i < saveEntries.size(); i++)
 		{
-			pugi::xml_document doc;
-			pugi::xml_parse_result result = doc.load_file(("../saves/" + saveFiles[i]).c_str());
-
-			if (result)
+			const SaveCatalog::Entry& entry = saveEntries[i];
+			if (entry.error == "")
 			{
-				std::string selectableText = std::to_string(i + 1 - invalidFiles.size()) + ". " + saveFiles[i];
+				char details[64];
+				if (!entry.checked)
+					sprintf_s(details, "checking");
+				else if (entry.size < (1 << 20))
+					sprintf_s(details, "%d objects, %.1f KB", entry.objectCount, entry.size / 1024.0);
+				else
+					sprintf_s(details, "%d objects, %.1f MB", entry.objectCount, entry.size / (1024.0 * 1024.0));
+				//the id is just the name, so it doesn't change once the details are in
+				std::string selectableText = std::to_string(i + 1 - invalidFiles.size()) + ". " + entry.name + "  (" + details + ")###" + entry.name;
 				//note: no & on imguiStatus->selected[i], and the flag to NOT automatically close popups. That was confusing to figure out...
 				if (ImGui::Selectable(selectableText.c_str(), selected[i], ImGuiSelectableFlags_DontClosePopups))
 				{
 					std::fill(selected.begin(), selected.end(), false);
 					selected[i] = true;
+					selectedHistory = -1;
 				}
+				if (entry.checked && ImGui::IsItemHovered())
+					ImGui::SetTooltip("Starts at %g years", entry.time);
 			}
 			else
 			{
-				invalidFiles.push_back(saveFiles[i] + " --- Error: " + result.description());
+				invalidFiles.push_back(entry.name + " --- Error: " + entry.error);
+			}
+		}
+
+		//only the header is read when one is opened, so these don't get parsed here
+		if (!historyFiles.empty())
+		{
+			ImGui::Text("Recorded Histories");
+			for (int i = 0; i < historyFiles.size(); i++)
+			{
+				if (ImGui::Selectable(historyFiles[i].c_str(), selectedHistory == i, ImGuiSelectableFlags_DontClosePopups))
+				{
+					std::fill(selected.begin(), selected.end(), false);
+					selectedHistory = i;
+				}
 			}
 		}
 
@@ -175,22 +203,45 @@ void UserInterface::LoadPopup(Physics* physics) {
 			}
 		}
 
+		if (loadError != "")
+			ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", loadError.c_str());
+
 		if (ImGui::Button("Load", ImVec2(120, 0)))
 		{
-			ImGui::CloseCurrentPopup();
+			loadError = "";
 			for (int i = 0; i < selected.size(); i++)
 			{
-				if (selected[i])
-					Physics::FromXml(physics, "../saves/" + saveFiles[i], textureFolders);
+				if (selected[i]) {
+					CancelStreaming();
+					CancelProgressive();
+					recomputeFrame = -1;
+					if (!Physics::Load(physics, "../saves/" + saveFiles[i], textureFolders))
+						loadError = saveFiles[i] + ": couldn't be loaded";
+				}
+			}
+			if (selectedHistory >= 0 && selectedHistory < historyFiles.size())
+			{
+				CancelStreaming();
+				CancelProgressive();
+				recomputeFrame = -1;
+				if (Physics::OpenHistory(physics, "../histories/" + historyFiles[selectedHistory], textureFolders, &loadError))
+					physics->pathWindow = streaming.retainFrames;
+				else
+					loadError = historyFiles[selectedHistory] + ": " + loadError;
 			}
 
-			ShowLoadPopup = false;
+			if (loadError == "")
+			{
+				ImGui::CloseCurrentPopup();
+				ShowLoadPopup = false;
+			}
 		}
 		ImGui::SameLine();
 		if (ImGui::Button("Cancel", ImVec2(120, 0)))
 		{
 			ImGui::CloseCurrentPopup();
 			ShowLoadPopup = false;
+			loadError = "";
 		}
 		ImGui::PopStyleVar();
 		ImGui::EndPopup();
@@ -203,6 +254,22 @@ void UserInterface::TopLeftOverlay(Physics* physics)
 	ImGui::Begin("TopLeftOverlay", NULL, ImVec2(0, 0), 0.3f, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings);
 	ImGui::Text(("Time: " + std::to_string(physics->time) + " years").c_str());
 	ImGui::Text("FPS: %.3f", ImGui::GetIO().Framerate);
+
+	//only while the series still lines up with the frames it was measured from
+	if (!physics->conservation.empty() && physics->conservation.size() == physics->computedData.size())
+	{
+		const ConservationSample& sample = physics->conservation[physics->dataIndex];
+		ImGui::Text("Energy error: %.2e  Momentum: %.2e  Angular momentum: %.2e", sample.energyError, sample.momentumError, sample.angularMomentumError);
+		ImGui::Text("Kinetic: %.4e  Potential: %.4e", sample.kineticEnergy, sample.potentialEnergy);
+
+		//log10 of the energy error up to the current frame, thinned out to at most 256 points
+		int count = physics->dataIndex + 1;
+		int stride = (count + 255) / 256;
+		std::vector<float> history = {};
+		for (int i = 0; i < count; i += stride)
+			history.push_back(log10f(std::max(physics->conservation[i].energyError, 1e-12f)));
+		ImGui::PlotLines("##EnergyHistory", history.data(), history.size(), 0, "log10 energy error", -12.0f, 0.0f, ImVec2(300, 40));
+	}
 	ImGui::End();
 }
 
@@ -214,23 +281,63 @@ void UserInterface::SavePopup(Physics* physics) {
 
 	if (ImGui::BeginPopupModal("Save"))
 	{
-		static char filename[128] = "";
-		ImGui::Text("Name"); ImGui::SameLine();
-		ImGui::InputText("##SaveName", filename, IM_ARRAYSIZE(filename));
+		//the file is written on saveThread, and the popup stays open with the progress until it's done
+		bool saving = saveThread.joinable();
+		if (saving && saver.finished)
+		{
+			saveThread.join();
+			saving = false;
+			if (!saver.failed && !saver.cancel)
+			{
+				//the catalog would see the new file anyway, this just doesn't wait for the notification
+				saveCatalog.Refresh();
+				ImGui::CloseCurrentPopup();
+				ShowSavePopup = false;
+			}
+		}
 
-		if (ImGui::Button("Save##Button", ImVec2(120, 0)))
+		static char filename[128] = "";
+		//binary snapshots load much faster, for scenarios with a lot of objects
+		static bool binary = false;
+		if (!saving)
 		{
-			Physics::ToXml(*physics, "../saves/" + std::string(filename) + ".xml");
-			saveFiles.push_back(std::string(filename) + ".xml");
-			selected.push_back(false);
-			ImGui::CloseCurrentPopup();
-			ShowSavePopup = false;
+			ImGui::Text("Name"); ImGui::SameLine();
+			ImGui::InputText("##SaveName", filename, IM_ARRAYSIZE(filename));
+			ImGui::Checkbox("Binary Snapshot", &binary);
+			if (saver.failed)
+				ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Couldn't write ../saves/%s", savingFile.c_str());
+
+			if (ImGui::Button("Save##Button", ImVec2(120, 0)))
+			{
+				savingFile = std::string(filename) + (binary ? ".snap" : ".xml");
+				std::string path = "../saves/" + savingFile;
+				bool isBinary = binary;
+				SaveState state = Physics::GetSaveState(physics);
+				saver.cancel = false;
+				saver.finished = false;
+				saver.failed = false;
+				saver.progress = 0.0f;
+				saveThread = std::thread([this, state = std::move(state), path, isBinary]() {
+					saver.Save(state, path, isBinary);
+				});
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Cancel", ImVec2(120, 0)))
+			{
+				saver.failed = false;
+				ImGui::CloseCurrentPopup();
+				ShowSavePopup = false;
+			}
 		}
-		ImGui::SameLine();
-		if (ImGui::Button("Cancel", ImVec2(120, 0)))
+		else
 		{
-			ImGui::CloseCurrentPopup();
-			ShowSavePopup = false;
+			ImGui::Text("Saving %s", savingFile.c_str());
+			char progressString[32];
+			sprintf_s(progressString, "%d%%", (int)(saver.progress * 100));
+			ImGui::ProgressBar(saver.progress, ImVec2(246, 0), progressString);
+			//the old file with the same name is only replaced once the new one is complete
+			if (ImGui::Button("Cancel##Saving", ImVec2(120, 0)))
+				CancelSave();
 		}
 
 		ImGui::EndPopup();
@@ -288,6 +395,11 @@ void UserInterface::MenuBar(Physics* physics) {
 			ImGui::MenuItem("Simulation Controls", NULL, &ShowSimulationWindow);
 			ImGui::MenuItem("Camera", NULL, &ShowCameraWindow);
 			ImGui::MenuItem("Top Left Overlay", NULL, &ShowTopLeftOverlay);
+			ImGui::MenuItem("Ensemble", NULL, &ShowEnsembleWindow);
+			ImGui::MenuItem("Stability Map", NULL, &ShowStabilityWindow);
+			ImGui::MenuItem("Compare Integrators", NULL, &ShowComparisonWindow);
+			ImGui::MenuItem("Events", NULL, &ShowEventsWindow);
+			ImGui::MenuItem("Close Approaches", NULL, &ShowProximityWindow);
 
 			ImGui::EndMenu();
 		}
@@ -300,6 +412,12 @@ void UserInterface::MenuBar(Physics* physics) {
 
 void UserInterface::ShowMainUi(Physics* physics, Graphics * graphics)
 {
+	UpdateSaveFiles();
+	UpdateStreaming(physics);
+	UpdateProgressive(physics);
+	UpdateRecompute(physics);
+	physics->UpdatePathWindow();
+
 	MenuBar(physics);
 
 	if(ShowTopLeftOverlay)
@@ -312,6 +430,21 @@ void UserInterface::ShowMainUi(Physics* physics, Graphics * graphics)
 
 	if(ShowSimulationWindow)
 		SimulationWindow(physics, graphics);
+
+	if (ShowEnsembleWindow)
+		EnsembleWindow(physics);
+
+	if (ShowStabilityWindow)
+		StabilityWindow(physics);
+
+	if (ShowComparisonWindow)
+		ComparisonWindow(physics);
+
+	if (ShowEventsWindow)
+		EventsWindow(physics);
+
+	if (ShowProximityWindow)
+		ProximityWindow(physics);
 }
 
 void UserInterface::OriginDropdown(Physics * physics, Graphics * graphics)
@@ -329,12 +462,8 @@ void UserInterface::OriginDropdown(Physics * physics, Graphics * graphics)
 
 	if (ImGui::Combo("##ObjectFocus", &physics->origin, vector_getter, static_cast<void*>(&names), names.size()))
 	{
-		int originalIndex = physics->dataIndex;
-
-		for (physics->dataIndex = 0; physics->dataIndex < physics->computedData.size(); physics->dataIndex++)
-			physics->updatePaths(physics->dataIndex == 0);
-
-		physics->dataIndex = originalIndex;
+		//only the frames the paths already have, since they may just follow playback (see UpdatePathWindow)
+		physics->UpdatePathFrames(physics->pathStart, physics->pathEnd - 1);
 
 		//changing focus, and want to re-center on the new target
 		graphics->xTranslate = 0.0;
@@ -355,6 +484,30 @@ void UserInterface::SimulationWindow(Physics * physics, Graphics * graphics)
 			ImGui::Combo("##Algorithm", &physics->selectedAlgorithm, physics->algorithms, IM_ARRAYSIZE(physics->algorithms));
 			ImGui::PopItemWidth();
 
+			ImGui::AlignFirstTextHeightToWidgets();
+			ImGui::Text("Threads   "); ImGui::SameLine();
+			ImGui::PushItemWidth(200);
+			if (ImGui::InputInt("##Threads", &physics->threadCount))
+				physics->threadCount = clip(physics->threadCount, 0, ThreadPool::Shared().GetThreadCount());
+			ImGui::PopItemWidth();
+			ImGui::SameLine();
+			ImGui::Checkbox("Deterministic", &physics->deterministic);
+
+			if (ImGui::Button("Measure Reduction Overhead"))
+			{
+				reductionBenchmark = physics->BenchmarkReductions(20);
+				hasReductionBenchmark = true;
+			}
+			if (hasReductionBenchmark)
+			{
+				float overhead = 100.0f * (reductionBenchmark.deterministicMilliseconds / reductionBenchmark.fastMilliseconds - 1.0f);
+				ImGui::Text("Fast: %.3f ms  Deterministic: %.3f ms (%+.1f%%)", reductionBenchmark.fastMilliseconds, reductionBenchmark.deterministicMilliseconds, overhead);
+				if (!reductionBenchmark.parallel)
+					ImGui::Text("Below %d objects the forces are computed on 1 thread, so results always match", PARALLEL_FORCE_THRESHOLD);
+				else
+					ImGui::Text(reductionBenchmark.reproducible ? "Deterministic results match on 1 thread" : "Deterministic results DIFFER on 1 thread");
+			}
+
 			ImGui::AlignFirstTextHeightToWidgets();
 			ImGui::Text("Timestep  "); ImGui::SameLine();
 			ImGui::PushItemWidth(200);
@@ -371,6 +524,8 @@ void UserInterface::SimulationWindow(Physics * physics, Graphics * graphics)
 			UnitCombo<UnitType::Time>("##TotalTimeUnits", &physics->totalTime);
 			ImGui::PopItemWidth();
 
+			AutotuneControls(physics);
+
 			ImGui::AlignFirstTextHeightToWidgets();
 			ImGui::Text("Origin    "); ImGui::SameLine();
 			ImGui::PushItemWidth(288);
@@ -382,65 +537,761 @@ void UserInterface::SimulationWindow(Physics * physics, Graphics * graphics)
 			std::list<PhysObject> objectsList(objects.begin(), objects.end());
 			ObjectsTree(objectsList, graphics);
 
-			if (ImGui::Button("Compute", ImVec2(ImGui::GetWindowContentRegionWidth(), 30)))
+			ComputeControls(physics, objects);
+		}
+		if (ImGui::CollapsingHeader("Playback", TreeNodeFlags))
+		{
+			ImGui::AlignFirstTextHeightToWidgets();
+			ImGui::Text("Playback Speed"); ImGui::SameLine();
+			ImGui::InputInt("##Playback Speed", &physics->playbackSpeed);
+
+			if (ImGui::Button(isPaused ? "Play" : "Pause", ImVec2(97, 0)))
 			{
-				isPaused = true;
+				isPaused = !isPaused;
+			}
+			ImGui::SameLine();
+			//frames are numbered relative to the epoch, so anything from a backward computation shows up as negative
+			int frame = physics->dataIndex - physics->epochIndex;
+			if (ImGui::SliderInt("##playbackSlider", &frame, -physics->epochIndex, physics->computedData.size() - 1 - physics->epochIndex))
+				physics->dataIndex = clip(frame + physics->epochIndex, 0, (int)physics->computedData.size() - 1);
+			EventMarkers(physics);
+
+			//frames don't have to be evenly spaced, so the time is looked up rather than turned into a frame number
+			ImGui::AlignFirstTextHeightToWidgets();
+			ImGui::Text("Go To Time    "); ImGui::SameLine();
+			ImGui::PushItemWidth(200);
+			if (ImGui::InputFloat("##GoToTime", &goToTime.value, 0.0f, 0.0f, 3, ImGuiInputTextFlags_EnterReturnsTrue))
+				physics->dataIndex = physics->computedData.FindFrame(goToTime.GetBaseValue());
+			ImGui::SameLine();
+			ImGui::PushItemWidth(80);
+			UnitCombo<UnitType::Time>("##GoToTimeUnits", &goToTime);
+			ImGui::PopItemWidth();
+			ImGui::PopItemWidth();
+
+			TimelineControls(physics);
+		}
+	}
+	ImGui::End();
+}
+
+void UserInterface::TimelineControls(Physics * physics)
+{
+	std::vector<std::string> names = {};
+	for (int i = 0; i < physics->timelines.size(); i++)
+		names.push_back(physics->timelines[i].name);
+
+	static auto vector_getter = [](void* vec, int idx, const char** out_text)
+	{
+		auto& vector = *static_cast<std::vector<std::string>*>(vec);
+		if (idx < 0 || idx >= static_cast<int>(vector.size())) { return false; }
+		*out_text = vector.at(idx).c_str();
+		return true;
+	};
+
+	ImGui::AlignFirstTextHeightToWidgets();
+	ImGui::Text("Timeline      "); ImGui::SameLine();
+	ImGui::PushItemWidth(200);
+	int selectedTimeline = physics->currentTimeline;
+	if (ImGui::Combo("##Timeline", &selectedTimeline, vector_getter, static_cast<void*>(&names), names.size()))
+	{
+		//the background runs write into whichever timeline is current
+		CancelStreaming();
+		CancelProgressive();
+		recomputeFrame = -1;
+		physics->SwitchTimeline(selectedTimeline);
+	}
+	ImGui::PopItemWidth();
 
-				physics->temporaryData = physics->computedData;
+	ImGui::SameLine();
+	if (ImGui::Button("Branch", ImVec2(97, 0)))
+	{
+		CancelStreaming();
+		CancelProgressive();
+		physics->BranchTimeline("Branch " + std::to_string(physics->timelines.size()) + " at frame " + std::to_string(physics->dataIndex - physics->epochIndex));
+	}
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Copies this timeline. Edits after branching only change the copy, and the frames before them stay shared");
+}
 
-				physics->temporaryIndex = physics->dataIndex;
+void UserInterface::ComputeControls(Physics * physics, std::vector<PhysObject> objects)
+{
+	ImGui::AlignFirstTextHeightToWidgets();
+	ImGui::Text("Mode      "); ImGui::SameLine();
+	ImGui::PushItemWidth(288);
+	ImGui::Combo("##ComputeMode", &computeMode, computeModes, IM_ARRAYSIZE(computeModes));
+	ImGui::PopItemWidth();
 
-				physics->computedData = { objects };
-				physics->dataIndex = 0;
-				physics->updatePaths(true);
+	if (computeMode == COMPUTE_PARAREAL)
+	{
+		ImGui::PushItemWidth(80);
+		if (ImGui::InputInt("Slices", &parareal.sliceCount))
+			parareal.sliceCount = std::max(parareal.sliceCount, 0);
+		ImGui::SameLine();
+		if (ImGui::InputInt("Coarse Factor", &parareal.coarseFactor))
+			parareal.coarseFactor = std::max(parareal.coarseFactor, 1);
+		ImGui::PopItemWidth();
+
+		//how the last run ended. Frames from a run that didn't converge are kept, but they aren't as accurate as a serial compute
+		if (pararealDone && parareal.converged)
+			ImGui::Text("Converged after %d iterations, correction %.2e", parareal.iteration.load(), parareal.lastCorrection.load());
+		else if (pararealDone)
+			ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Not converged after %d iterations, correction %.2e is above %.2e", parareal.iteration.load(), parareal.lastCorrection.load(), parareal.tolerance);
+	}
+	else if (computeMode == COMPUTE_BIDIRECTIONAL)
+	{
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Backward  "); ImGui::SameLine();
+		ImGui::PushItemWidth(200);
+		ImGui::InputFloat("##Backward Time", &physics->backwardTime.value, 0.01f); ImGui::SameLine();
+		ImGui::PushItemWidth(80);
+		UnitCombo<UnitType::Time>("##BackwardTimeUnits", &physics->backwardTime);
+		ImGui::PopItemWidth();
+		ImGui::PopItemWidth();
+	}
+	else if (computeMode == COMPUTE_SECULAR)
+	{
+		ImGui::Checkbox("Higher Order", &secular.higherOrder);
+		if (secular.higherOrder)
+		{
+			ImGui::SameLine();
+			ImGui::PushItemWidth(80);
+			if (ImGui::InputInt("Samples", &secular.samples))
+				secular.samples = clip(secular.samples, 4, 256);
+			ImGui::PopItemWidth();
+		}
+		ImGui::TextWrapped("The timestep is the time between frames. Only planet orbits evolve, moons keep their initial orbits.");
+	}
+	else if (computeMode == COMPUTE_STREAMING)
+	{
+		ImGui::PushItemWidth(80);
+		if (ImGui::InputInt("Ahead", &streaming.aheadFrames))
+			streaming.aheadFrames = std::max(streaming.aheadFrames, 1);
+		ImGui::SameLine();
+		if (ImGui::InputInt("Keep", &streaming.retainFrames))
+			streaming.retainFrames = std::max(streaming.retainFrames, 1);
+		ImGui::PopItemWidth();
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Frames kept behind the one being shown. Older frames are dropped");
+
+		ImGui::Checkbox("Spill dropped frames", &streaming.spill);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Writes frames to ../streams as csv before dropping them. The csv is for other tools, and can't be loaded back; use Record for that");
+		ImGui::SameLine();
+		ImGui::Checkbox("Record", &streaming.record);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Writes every frame to ../histories. Frames behind playback are read back from there instead of dropped, and the file can be played back later from Load");
+		ImGui::PushItemWidth(80);
+		if (ImGui::InputInt("Checkpoint Minutes", &streaming.checkpointMinutes))
+			streaming.checkpointMinutes = std::max(streaming.checkpointMinutes, 0);
+		ImGui::PopItemWidth();
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Saves the exact state of the run to ../checkpoints this often, for Resume to carry on from after a crash. 0 = never");
+		if (streaming.spill || streaming.record || streaming.checkpointMinutes > 0)
+		{
+			ImGui::SameLine();
+			ImGui::PushItemWidth(150);
+			ImGui::InputText("##StreamingOutput", streamingOutput, IM_ARRAYSIZE(streamingOutput));
+			ImGui::PopItemWidth();
+		}
+		ImGui::TextWrapped("Computes in frames of one timestep, and keeps going until stopped. Total Time is not used.");
+	}
+	else if (computeMode == COMPUTE_PROGRESSIVE)
+	{
+		ImGui::PushItemWidth(80);
+		if (ImGui::InputFloat("Preview Seconds", &progressive.previewSeconds, 0.0f, 0.0f, 2))
+			progressive.previewSeconds = std::max(progressive.previewSeconds, 0.01f);
+		ImGui::SameLine();
+		if (ImGui::InputInt("Chunk", &progressive.chunkFrames))
+			progressive.chunkFrames = std::max(progressive.chunkFrames, 1);
+		ImGui::PopItemWidth();
+		ImGui::TextWrapped("Shows a quick preview first, then refines it from the start. Paths are dimmer where the preview hasn't been refined yet.");
+	}
 
-				ImGui::SetNextWindowSize(ImVec2(300, 100), ImGuiSetCond_FirstUseEver);
-				ImGui::OpenPopup("Computing timesteps...");
+	ImGui::AlignFirstTextHeightToWidgets();
+	ImGui::Text("Energy Warning"); ImGui::SameLine();
+	ImGui::PushItemWidth(200);
+	if (ImGui::InputFloat("##EnergyWarning", &physics->conservationWarning, 0.0f, 0.0f, 8))
+		physics->conservationWarning = std::max(physics->conservationWarning, 0.0f);
+	ImGui::PopItemWidth();
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Relative energy error that pauses a serial computation. 0 = never");
+
+	ImGui::AlignFirstTextHeightToWidgets();
+	ImGui::Text("History (Gm)  "); ImGui::SameLine();
+	ImGui::PushItemWidth(200);
+	if (InputScientific("##HistoryTolerance", &physics->historyTolerance))
+		physics->historyTolerance = std::max(physics->historyTolerance, 0.0f);
+	ImGui::PopItemWidth();
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Frames are kept as Chebyshev series that stay this close to them. 0 = keep every frame");
+
+	size_t historyBytes, uncompressedBytes;
+	physics->computedData.GetMemoryUse(&historyBytes, &uncompressedBytes);
+	ImGui::Text("History uses %.1f MB (%.0fx smaller)", historyBytes / 1048576.0, historyBytes == 0 ? 1.0 : (double)uncompressedBytes / historyBytes);
+
+	if (computeMode == COMPUTE_STREAMING)
+	{
+		if (ImGui::Button(IsStreaming() ? "Stop Streaming" : "Start Streaming", ImVec2(ImGui::GetWindowContentRegionWidth(), 30)))
+		{
+			if (IsStreaming())
+				CancelStreaming();
+			else
+				BeginStreaming(physics, objects, nullptr);
+		}
+		//the name is the one the checkpoints are written under
+		if (!IsStreaming() && ImGui::Button("Resume From Checkpoint", ImVec2(ImGui::GetWindowContentRegionWidth(), 0)))
+		{
+			CancelProgressive();
+			Checkpoint::State state;
+			checkpointUnreadable = !Checkpoint::Restore(physics, "../checkpoints/" + std::string(streamingOutput) + ".ckpt", textureFolders, &state);
+			if (!checkpointUnreadable)
+				BeginStreaming(physics, state.objects, &state);
+		}
+		if (IsStreaming())
+			ImGui::Text("%lld frames computed, %lld dropped", streaming.framesDone.load(), streamingDropped);
+		if (recordingReader)
+			ImGui::Text("%lld frames recorded", streaming.recording.writtenFrames.load());
+		if (streaming.checkpoint.IsRunning() && streaming.checkpoint.writtenFrame >= 0)
+			ImGui::Text("Checkpoint at frame %lld", streaming.checkpoint.writtenFrame.load());
+		if (streaming.record && streaming.recording.failed)
+			ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Couldn't write ../histories/%s.hist", streamingOutput);
+		if (streaming.checkpoint.failed)
+			ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Couldn't write ../checkpoints/%s.ckpt", streamingOutput);
+		if (checkpointUnreadable)
+			ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Couldn't read ../checkpoints/%s.ckpt", streamingOutput);
+	}
+	else if (ImGui::Button("Compute", ImVec2(ImGui::GetWindowContentRegionWidth(), 30)))
+	{
+		CancelStreaming();
+		CancelProgressive();
+		recomputeFrame = -1;
+		isPaused = true;
+
+		physics->temporaryData = physics->TakeTimeline();
+		physics->refinedFrames = -1;
+
+		physics->epochTime = physics->time;
+		physics->epochIndex = 0;
+		physics->computedData = FrameHistory({ objects }, physics->time, 0.0);
+		physics->dataIndex = 0;
+		physics->updatePaths(true);
+		physics->ResetConservation();
+		conservationPaused = false;
+		ignoreConservationWarning = false;
+
+		float dt = physics->timestep.GetBaseValue();
+		int totalTimesteps = round(physics->totalTime.GetBaseValue() / dt);
+		if (computeMode == COMPUTE_PARAREAL)
+		{
+			parareal.cancel = false;
+			parareal.finished = false;
+			pararealDone = false;
+			int sliceCount = parareal.sliceCount, coarseFactor = parareal.coarseFactor, maxIterations = parareal.maxIterations;
+			float tolerance = parareal.tolerance;
+			computeThread = std::thread([this, physics, objects, dt, totalTimesteps, sliceCount, coarseFactor, tolerance, maxIterations]() {
+				backgroundFrames = parareal.Run(physics, objects, dt, totalTimesteps, sliceCount, coarseFactor, tolerance, maxIterations);
+			});
+		}
+		else if (computeMode == COMPUTE_BIDIRECTIONAL)
+		{
+			int backwardTimesteps = round(physics->backwardTime.GetBaseValue() / dt);
+			bidirectional.cancel = false;
+			bidirectional.finished = false;
+			computeThread = std::thread([this, physics, objects, dt, backwardTimesteps, totalTimesteps]() {
+				backgroundFrames = bidirectional.Run(physics, objects, dt, backwardTimesteps, totalTimesteps);
+			});
+		}
+		else if (computeMode == COMPUTE_SECULAR)
+		{
+			secular.cancel = false;
+			secular.finished = false;
+			computeThread = std::thread([this, physics, objects, dt, totalTimesteps]() {
+				backgroundFrames = secular.Run(physics, objects, dt, totalTimesteps);
+			});
+		}
+		else if (computeMode == COMPUTE_PROGRESSIVE)
+		{
+			//the series is rebuilt once everything is refined
+			physics->conservation = {};
+			physics->refinedFrames = 1;
+			progressiveStart = 0;
+			progressiveFrames = totalTimesteps + 1;
+			progressiveRefinedLimit = INT_MAX;
+			progressive.cancel = false;
+			progressive.finished = false;
+			progressive.refinedFrames = 1;
+			double startTime = physics->epochTime;
+			int algorithm = physics->selectedAlgorithm;
+			bool deterministic = physics->deterministic;
+			int threadCount = physics->threadCount;
+			progressiveThread = std::thread([this, objects, dt, totalTimesteps, startTime, algorithm, deterministic, threadCount]() {
+				progressive.Run(objects, dt, totalTimesteps, startTime, 0, algorithm, deterministic, threadCount);
+			});
+		}
+
+		//only the popup can cancel, and put the old history back
+		if (computeMode != COMPUTE_PROGRESSIVE)
+		{
+			ImGui::SetNextWindowSize(ImVec2(300, 100), ImGuiSetCond_FirstUseEver);
+			ImGui::OpenPopup("Computing timesteps...");
+		}
+		else
+			physics->temporaryData = Timeline();
+	}
+	if (progressiveThread.joinable())
+	{
+		char progressString[32];
+		sprintf_s(progressString, "Refined %d/%d", progressive.refinedFrames.load(), progressiveFrames);
+		ImGui::ProgressBar((float)progressive.refinedFrames / progressiveFrames, ImVec2(ImGui::GetWindowContentRegionWidth() - 110, 0.f), progressString);
+		ImGui::SameLine();
+		if (ImGui::Button("Stop Refining", ImVec2(100, 0)))
+		{
+			//chunks finished before the thread noticed are kept, rather than thrown away with the ones still going
+			CancelProgressive();
+			MergeProgressiveChunks(physics);
+			if (physics->refinedFrames >= (int)physics->computedData.size()) {
+				physics->refinedFrames = -1;
+				physics->RebuildConservation(progressiveStart);
 			}
-			if (ImGui::BeginPopupModal("Computing timesteps..."))
+			physics->FinishFrames();
+		}
+	}
+	if (ImGui::BeginPopupModal("Computing timesteps..."))
+	{
+		char progressString[32];
+
+		int totalTimesteps = round(physics->totalTime.GetBaseValue() / physics->timestep.GetBaseValue());
+		if (computeThread.joinable())
+		{
+			bool finished = false;
+			if (computeMode == COMPUTE_PARAREAL)
+				finished = parareal.finished;
+			else if (computeMode == COMPUTE_BIDIRECTIONAL)
+				finished = bidirectional.finished;
+			else if (computeMode == COMPUTE_SECULAR)
+				finished = secular.finished;
+			if (finished)
 			{
-				char progressString[32];
+				computeThread.join();
+				if (computeMode == COMPUTE_PARAREAL)
+					pararealDone = true;
+				if (computeMode == COMPUTE_BIDIRECTIONAL)
+					physics->epochIndex = bidirectional.epochIndex;
+				float dt = physics->timestep.GetBaseValue();
+				physics->computedData = FrameHistory(backgroundFrames, physics->epochTime - (double)dt * physics->epochIndex, dt);
+				backgroundFrames = {};
+				physics->RebuildConservation(physics->epochIndex);
+				physics->events.ScanFrames(physics->computedData, 1, physics->computedData.size() - 1);
+				physics->FinishFrames();
+
+				for (physics->dataIndex = 0; physics->dataIndex < physics->computedData.size(); physics->dataIndex++)
+					physics->updatePaths(physics->dataIndex == 0);
+				physics->dataIndex = computeMode == COMPUTE_BIDIRECTIONAL ? physics->epochIndex : physics->computedData.size() - 1;
+				physics->temporaryData = Timeline();
+
+				ImGui::CloseCurrentPopup();
+			}
 
-				int totalTimesteps = round(physics->totalTime.GetBaseValue() / physics->timestep.GetBaseValue());
-				if (physics->dataIndex + 1 > totalTimesteps)
+			if (computeMode == COMPUTE_PARAREAL)
+			{
+				sprintf_s(progressString, "Iteration %d/%d", parareal.iteration.load(), parareal.maxIterations);
+				ImGui::ProgressBar((float)parareal.iteration / parareal.maxIterations, ImVec2(0.f, 0.f), progressString);
+				if (parareal.iteration > 1)
+					ImGui::Text("Correction %.2e", parareal.lastCorrection.load());
+			}
+			else if (computeMode == COMPUTE_SECULAR)
+			{
+				sprintf_s(progressString, "%d/%d", secular.framesDone.load(), totalTimesteps + 1);
+				ImGui::ProgressBar((float)secular.framesDone / (totalTimesteps + 1), ImVec2(0.f, 0.f), progressString);
+			}
+			else
+			{
+				int backwardTimesteps = round(physics->backwardTime.GetBaseValue() / physics->timestep.GetBaseValue());
+				int done = bidirectional.backwardDone + bidirectional.forwardDone;
+				sprintf_s(progressString, "%d/%d", done, backwardTimesteps + totalTimesteps);
+				ImGui::ProgressBar((float)done / std::max(backwardTimesteps + totalTimesteps, 1), ImVec2(0.f, 0.f), progressString);
+			}
+		}
+		else
+		{
+			if (physics->dataIndex + 1 > totalTimesteps) {
+				physics->temporaryData = Timeline();
+				ImGui::CloseCurrentPopup();
+			}
+			else if (conservationPaused)
+			{
+				ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Energy error %.2e is above %.2e", physics->conservation.back().energyError, physics->conservationWarning);
+				if (ImGui::Button("Continue Anyway"))
+				{
+					conservationPaused = false;
+					ignoreConservationWarning = true;
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("Keep Frames So Far")) {
+					physics->temporaryData = Timeline();
 					ImGui::CloseCurrentPopup();
-				else {
-					physics->step(physics->timestep.GetBaseValue());
-					physics->updatePaths(false);
 				}
-				sprintf_s(progressString, "%d/%d", physics->dataIndex + 1, totalTimesteps);
+			}
+			else {
+				physics->step(physics->timestep.GetBaseValue());
+				physics->updatePaths(false);
 
-				ImGui::ProgressBar((float)physics->dataIndex / totalTimesteps, ImVec2(0.f, 0.f), progressString);
+				if (!ignoreConservationWarning && physics->conservationWarning > 0.0f && !physics->conservation.empty() && physics->conservation.back().energyError > physics->conservationWarning)
+					conservationPaused = true;
+			}
+			sprintf_s(progressString, "%d/%d", physics->dataIndex + 1, totalTimesteps);
 
+			ImGui::ProgressBar((float)physics->dataIndex / totalTimesteps, ImVec2(0.f, 0.f), progressString);
+		}
 
-				if (ImGui::Button("Cancel")) {
-					physics->computedData = physics->temporaryData;
-					physics->dataIndex = physics->temporaryIndex;
-					physics->temporaryData = {};
+		if (ImGui::Button("Cancel")) {
+			CancelBackgroundCompute();
 
-					ImGui::CloseCurrentPopup();
-				}
+			physics->RestoreTimeline(std::move(physics->temporaryData));
+			physics->temporaryData = Timeline();
 
-				ImGui::EndPopup();
-			}
+			ImGui::CloseCurrentPopup();
+		}
+
+		ImGui::EndPopup();
+	}
+}
+
+void UserInterface::CancelBackgroundCompute()
+{
+	if (!computeThread.joinable())
+		return;
+
+	parareal.cancel = true;
+	bidirectional.cancel = true;
+	secular.cancel = true;
+	computeThread.join();
+	backgroundFrames = {};
+}
+
+//copies the preview and refined chunks into computedData as they come in
+void UserInterface::UpdateProgressive(Physics* physics)
+{
+	if (!progressiveThread.joinable())
+		return;
+
+	//read before taking the chunks, so the thread is only joined once everything it made has been taken
+	bool finished = progressive.finished;
+	MergeProgressiveChunks(physics);
+
+	if (finished) {
+		progressiveThread.join();
+		physics->refinedFrames = progressiveRefinedLimit < physics->computedData.size() ? progressiveRefinedLimit : -1;
+		physics->RebuildConservation(progressiveStart);
+	}
+	physics->FinishFrames();
+}
+
+//copies the chunks finished since the last call into computedData
+void UserInterface::MergeProgressiveChunks(Physics* physics)
+{
+	//read before taking the chunks, so every frame counted as refined has been taken
+	int refinedFrames = progressive.refinedFrames;
+	std::vector<FrameChunk> chunks;
+	progressive.TakeChunks(&chunks);
+
+	for (int c = 0; c < chunks.size(); c++) {
+		int first = chunks[c].first;
+		int last = first + chunks[c].frames.size() - 1;
+		if (last < first)
+			continue;
+
+		//follow the newest frame if it was already showing the last one, like serial mode does
+		bool atEnd = physics->dataIndex == physics->computedData.size() - 1;
+		for (int f = 0; f < chunks[c].frames.size(); f++)
+			physics->computedData.Set(first + f, chunks[c].frames[f], chunks[c].times[f]);
+		physics->UpdatePathFrames(first, last);
+
+		//the preview is only an approximation, so events are only looked for in refined frames
+		if (first == progressiveStart)
+			physics->events.EraseAfter(physics->computedData.GetTime(progressiveStart));
+		else
+			physics->events.ScanFrames(physics->computedData, first, last);
+
+		if (atEnd)
+			physics->dataIndex = physics->computedData.size() - 1;
+	}
+	physics->refinedFrames = std::min(refinedFrames, progressiveRefinedLimit);
+}
+
+void UserInterface::RecomputeFrom(Physics* physics, int frame)
+{
+	std::vector<PhysObject> objects = physics->computedData[frame];
+	//the edited frame itself is indexed again, along with everything after it
+	physics->proximity.Truncate(frame + 1);
+
+	//streaming just carries on from the edited frame. The thread is stopped directly so the spill file stays open
+	if (IsStreaming()) {
+		streaming.cancel = true;
+		streamingThread.join();
+
+		physics->computedData.Truncate(frame + 1);
+		if (physics->conservation.size() > frame + 1)
+			physics->conservation.resize(frame + 1);
+		physics->TruncatePaths(frame + 1);
+		physics->events.EraseAfter(physics->computedData.GetTime(frame));
+		//a checkpoint from before the edit would bring back the old frames
+		if (streaming.checkpoint.IsRunning())
+			streaming.checkpoint.Submit(Checkpoint::Capture(physics).At(objects, frame + streamingDropped, physics->computedData.GetTime(frame)));
+		StartStreaming(physics, objects, frame + streamingDropped, physics->computedData.GetTime(frame));
+		return;
+	}
+
+	if (frame >= (int)physics->computedData.size() - 1) {
+		physics->FinishFrames();
+		return;
+	}
 
+	//preview frames at or before the edit never get refined now
+	int previousRefined = physics->refinedFrames;
+	CancelProgressive();
+	progressiveRefinedLimit = previousRefined >= 0 && previousRefined <= frame ? previousRefined : INT_MAX;
+
+	//everything after the edit is out of date until the new frames come in, so it's drawn as a preview
+	float dt = physics->timestep.GetBaseValue();
+	double startTime = physics->computedData.GetTime(frame);
+	int frameCount = physics->computedData.size() - 1 - frame;
+	physics->refinedFrames = std::min(frame + 1, progressiveRefinedLimit);
+	physics->conservation = {};
+	physics->events.EraseAfter(startTime);
+	progressiveStart = frame;
+	progressiveFrames = physics->computedData.size();
+	progressive.cancel = false;
+	progressive.finished = false;
+	progressive.refinedFrames = frame + 1;
+	int algorithm = physics->selectedAlgorithm;
+	bool deterministic = physics->deterministic;
+	int threadCount = physics->threadCount;
+	progressiveThread = std::thread([this, objects, dt, frameCount, startTime, frame, algorithm, deterministic, threadCount]() {
+		progressive.Run(objects, dt, frameCount, startTime, frame, algorithm, deterministic, threadCount);
+	});
+}
+
+//starts the recompute for the edited frames once the inputs have been left alone for RECOMPUTE_DELAY_MS
+void UserInterface::UpdateRecompute(Physics* physics)
+{
+	if (recomputeFrame < 0 || std::chrono::steady_clock::now() - recomputeTime < std::chrono::milliseconds(RECOMPUTE_DELAY_MS))
+		return;
+
+	int frame = std::min(recomputeFrame, (int)physics->computedData.size() - 1);
+	recomputeFrame = -1;
+	RecomputeFrom(physics, frame);
+}
+
+void UserInterface::CancelProgressive()
+{
+	if (!progressiveThread.joinable())
+		return;
+
+	progressive.cancel = true;
+	progressiveThread.join();
+}
+
+//sets up a new streaming run from objects, or one carried on from a checkpoint, with its files, and starts it
+void UserInterface::BeginStreaming(Physics* physics, std::vector<PhysObject> objects, const Checkpoint::State* resumed)
+{
+	CancelProgressive();
+	recomputeFrame = -1;
+	checkpointUnreadable = false;
+	double time = resumed ? resumed->time : physics->time;
+	long long firstFrame = resumed ? resumed->frame : 0;
+	physics->refinedFrames = -1;
+	physics->epochTime = (float)time;
+	physics->epochIndex = 0;
+	physics->computedData = FrameHistory({ objects }, time, 0.0);
+	physics->dataIndex = 0;
+	physics->ResetConservation();
+	physics->events.log = {};
+	physics->proximity.Clear();
+	//the errors of a resumed run are still measured from where it first started
+	if (resumed) {
+		std::vector<PhysObject> baseObjects = objects;
+		Physics::ConvertObjectsToBaseUnits(&baseObjects);
+		physics->conservationStart = resumed->conservationStart;
+		physics->conservation = { physics->MeasureConservation(objects, physics->GetEnergy(baseObjects) - Physics::GetKineticEnergy(baseObjects)) };
+	}
+	streamingDropped = firstFrame;
+
+	if (streaming.spill)
+		CreateDirectory("../streams", NULL);
+
+	pugi::xml_document scenario;
+	Physics::ToXml(physics, &scenario);
+	std::ostringstream scenarioText;
+	scenario.save(scenarioText);
+
+	recordingReader = nullptr;
+	if (streaming.record)
+	{
+		CreateDirectory("../histories", NULL);
+		std::string filename = std::string(streamingOutput) + ".hist";
+		recordingReader = std::make_shared<HistoryFile>();
+		bool opened = resumed ? streaming.recording.Resume("../histories/" + filename, firstFrame, objects.size())
+			: streaming.recording.Create("../histories/" + filename, scenarioText.str(), objects.size());
+		if (opened && recordingReader->Open("../histories/" + filename))
+		{
+			//a path point for every frame would grow without end too
+			physics->pathWindow = streaming.retainFrames;
+			if (std::find(historyFiles.begin(), historyFiles.end(), filename) == historyFiles.end())
+				historyFiles.push_back(filename);
+
+			//the frames before the checkpoint are in the file already, so the slider covers the whole run again
+			if (resumed) {
+				physics->computedData.UseFile(recordingReader, 0, (int)firstFrame, objects);
+				physics->computedData.push_back(objects, time);
+				physics->conservation = {};
+				physics->dataIndex = (int)firstFrame;
+				physics->epochIndex = (int)firstFrame;
+				streamingDropped = 0;
+			}
 		}
-		if (ImGui::CollapsingHeader("Playback", TreeNodeFlags))
+		else
 		{
-			ImGui::AlignFirstTextHeightToWidgets();
-			ImGui::Text("Playback Speed"); ImGui::SameLine();
-			ImGui::InputInt("##Playback Speed", &physics->playbackSpeed);
+			streaming.recording.Close();
+			streaming.recording.failed = true;
+			recordingReader = nullptr;
+		}
+	}
+	physics->updatePaths(true);
 
-			if (ImGui::Button(isPaused ? "Play" : "Pause", ImVec2(97, 0)))
-			{
-				isPaused = !isPaused;
-			}
-			ImGui::SameLine();
-			if (ImGui::SliderInt("##playbackSlider", &physics->dataIndex, 0, physics->computedData.size() - 1))
-				physics->dataIndex = clip(physics->dataIndex, 0, (int)physics->computedData.size() - 1);
+	if (streaming.checkpointMinutes > 0)
+	{
+		CreateDirectory("../checkpoints", NULL);
+		streaming.checkpoint.Start("../checkpoints/" + std::string(streamingOutput) + ".ckpt", scenarioText.str());
+	}
+
+	StartStreaming(physics, objects, firstFrame, time);
+	isPaused = false;
+}
+
+void UserInterface::StartStreaming(Physics* physics, std::vector<PhysObject> objects, long long firstFrame, double startTime)
+{
+	float dt = physics->timestep.GetBaseValue();
+	streaming.cancel = false;
+	streaming.finished = false;
+	streaming.framesDone = firstFrame;
+	streaming.playbackFrame = physics->dataIndex + streamingDropped;
+	Checkpoint::State settings = Checkpoint::Capture(physics);
+	streamingThread = std::thread([this, objects, dt, startTime, settings]() {
+		streaming.Run(objects, dt, startTime, settings);
+	});
+}
+
+//adds the frames the streaming thread finished since the last update, drops the ones too far behind playback,
+//and tells the thread where playback is
+void UserInterface::UpdateStreaming(Physics* physics)
+{
+	if (!IsStreaming())
+		return;
+
+	std::vector<std::vector<PhysObject>> frames;
+	std::vector<ConservationSample> samples;
+	std::vector<double> times;
+	streaming.TakeFrames(&frames, &times, &samples);
+
+	int playbackIndex = physics->dataIndex;
+	int firstNew = physics->computedData.size();
+	for (int f = 0; f < frames.size(); f++) {
+		physics->computedData.push_back(frames[f], times[f]);
+		if (physics->conservation.size() == physics->computedData.size() - 1)
+			physics->conservation.push_back(samples[f]);
+		physics->dataIndex = physics->computedData.size() - 1;
+		if (physics->pathWindow == 0)
+			physics->updatePaths(false);
+	}
+	physics->dataIndex = playbackIndex;
+	physics->events.ScanFrames(physics->computedData, firstNew, physics->computedData.size() - 1);
+	physics->FinishFrames();
+
+	//dropped a quarter of the retention at a time, so the front of the vectors isn't erased on every update
+	int behind = physics->dataIndex - streaming.retainFrames;
+	if (recordingReader) {
+		//without the file the frames behind playback can't be let go of, so there's no point going on
+		if (streaming.recording.failed) {
+			CancelStreaming();
+			return;
+		}
+
+		//frames behind playback are read back from the file from now on, so the slider still covers the whole run.
+		//The reader only looks at the file again when enough of them are there to be worth letting go of
+		int onDisk = (int)std::min(streaming.recording.writtenFrames.load(), (long long)behind);
+		if (onDisk - physics->computedData.FileFrames() >= std::max(streaming.retainFrames / 4, 1) && recordingReader->Refresh()) {
+			onDisk = (int)std::min(recordingReader->FrameCount(), (long long)onDisk);
+			physics->computedData.UseFile(recordingReader, 0, onDisk, physics->computedData.back());
+			//the conservation series and the proximity index would grow without end, and aren't in the file
+			physics->conservation = {};
+			physics->proximity.Clear();
 		}
 	}
-	ImGui::End();
+	else if (behind >= std::max(streaming.retainFrames / 4, 1)) {
+		if (streaming.spill) {
+			std::vector<std::vector<PhysObject>> dropped = physics->computedData.GetFrames(0, behind - 1);
+			std::vector<double> droppedTimes = {};
+			for (int f = 0; f < behind; f++)
+				droppedTimes.push_back(physics->computedData.GetTime(f));
+			if (!streaming.Spill("../streams/" + std::string(streamingOutput) + ".csv", dropped, droppedTimes))
+				streaming.spill = false;
+		}
+
+		physics->computedData.EraseFront(behind);
+		if (physics->conservation.size() >= behind)
+			physics->conservation.erase(physics->conservation.begin(), physics->conservation.begin() + behind);
+		physics->ErasePathFront(behind);
+
+		//the epoch can end up before the first frame, which keeps the slider's frame numbers counting from where streaming started
+		physics->dataIndex -= behind;
+		physics->epochIndex -= behind;
+		streamingDropped += behind;
+		if (recomputeFrame >= 0)
+			recomputeFrame = std::max(recomputeFrame - behind, 0);
+
+		physics->proximity.EraseFront(behind);
+		physics->FinishFrames();
+	}
+
+	streaming.playbackFrame = physics->dataIndex + streamingDropped;
+}
+
+void UserInterface::CancelStreaming()
+{
+	if (!streamingThread.joinable())
+		return;
+
+	streaming.cancel = true;
+	streamingThread.join();
+	streaming.CloseSpill();
+	streaming.recording.Close();
+	streaming.checkpoint.Stop();
+	recordingReader = nullptr;
+}
+
+//copies the catalog when it has changed. The selection stays on the same file when others come and go
+void UserInterface::UpdateSaveFiles()
+{
+	int version = saveCatalog.version;
+	if (version == saveEntriesVersion)
+		return;
+	saveEntriesVersion = version;
+
+	std::string selectedFile = "";
+	for (int i = 0; i < selected.size(); i++)
+	{
+		if (selected[i])
+			selectedFile = saveFiles[i];
+	}
+
+	saveEntries = saveCatalog.GetEntries();
+	saveFiles = {};
+	for (int i = 0; i < saveEntries.size(); i++)
+		saveFiles.push_back(saveEntries[i].name);
+	selected.assign(saveFiles.size(), false);
+	for (int i = 0; i < saveFiles.size(); i++)
+		selected[i] = saveFiles[i] == selectedFile;
 }
 
 //http://stackoverflow.com/questions/612097/how-can-i-get-the-list-of-files-in-a-directory-using-c-or-c
@@ -540,49 +1391,83 @@ void UserInterface::ObjectDataWindows(Physics * physics)
 				ImGui::PushItemWidth(300);
 
 				ImGui::Text("Mass    "); ImGui::SameLine();
-				bool massChanged = InputScientific(("##Mass" + name).c_str(), &physics->computedData[physics->dataIndex][i].mass.value);
+				bool massChanged = InputScientific(("##Mass" + name).c_str(), &objects[i].mass.value);
 
 				//default spacing between units and entry boxes is inconsistent form some reason, so have to hardcode position on the line. Sad.
 				ImGui::SameLine(375.0f); ImGui::PushItemWidth(120);
-				bool massUnitsChanged = UnitCombo<UnitType::Mass>("##Mass" + name, &physics->computedData[physics->dataIndex][i].mass);
+				bool massUnitsChanged = UnitCombo<UnitType::Mass>("##Mass" + name, &objects[i].mass);
 				ImGui::PopItemWidth();
 
 				ImGui::AlignFirstTextHeightToWidgets();
 				ImGui::Text("Position"); ImGui::SameLine();
-				bool positionChanged = ImGui::InputFloat3(("##Position " + name).c_str(), &physics->computedData[physics->dataIndex][i].position.value[0]);
+				bool positionChanged = ImGui::InputFloat3(("##Position " + name).c_str(), &objects[i].position.value[0]);
 
 				ImGui::SameLine(375.0f); ImGui::PushItemWidth(120);
-				bool positionUnitsChanged = UnitCombo3<UnitType::Distance>("##PositionUnits" + name, &physics->computedData[physics->dataIndex][i].position);
+				bool positionUnitsChanged = UnitCombo3<UnitType::Distance>("##PositionUnits" + name, &objects[i].position);
 				ImGui::PopItemWidth();
 
 				ImGui::AlignFirstTextHeightToWidgets();
 				ImGui::Text("Velocity"); ImGui::SameLine();
-				bool velocityChanged = ImGui::InputFloat3(("##Velocity " + name).c_str(), &physics->computedData[physics->dataIndex][i].velocity.value[0]);
+				bool velocityChanged = ImGui::InputFloat3(("##Velocity " + name).c_str(), &objects[i].velocity.value[0]);
 
 				ImGui::SameLine(375.0f); ImGui::PushItemWidth(120);
-				bool velocityUnitsChanged = UnitCombo3<UnitType::Velocity>("##VelocityUnits" + name, &physics->computedData[physics->dataIndex][i].velocity);
+				bool velocityUnitsChanged = UnitCombo3<UnitType::Velocity>("##VelocityUnits" + name, &objects[i].velocity);
 				ImGui::PopItemWidth();
 
+				//how much of the path is kept and drawn. Only this object's path is built again when it changes
+				ObjectSettings& settings = physics->objectSettings[i];
+				ImGui::AlignFirstTextHeightToWidgets();
+				ImGui::Text("History "); ImGui::SameLine(); ImGui::PushItemWidth(120);
+				bool historyChanged = ImGui::Combo(("##History" + name).c_str(), &settings.historyPolicy, ObjectSettings::historyPolicies, IM_ARRAYSIZE(ObjectSettings::historyPolicies));
+				ImGui::PopItemWidth();
+				if (settings.historyPolicy == HISTORY_RECENT) {
+					ImGui::SameLine(); ImGui::PushItemWidth(120);
+					if (ImGui::InputInt(("Frames##HistoryFrames" + name).c_str(), &settings.historyFrames, 100)) {
+						settings.historyFrames = std::max(settings.historyFrames, 1);
+						historyChanged = true;
+					}
+					ImGui::PopItemWidth();
+				}
+				else if (settings.historyPolicy == HISTORY_ADAPTIVE) {
+					ImGui::SameLine(); ImGui::PushItemWidth(120);
+					if (ImGui::InputFloat(("Degrees##HistoryAngle" + name).c_str(), &settings.historyAngle, 0.5f)) {
+						settings.historyAngle = std::max(settings.historyAngle, 0.01f);
+						historyChanged = true;
+					}
+					ImGui::PopItemWidth();
+				}
+				if (historyChanged)
+					physics->RebuildPath(i);
+
 				if (!isPaused && (massChanged || positionChanged || velocityChanged))
 					isPaused = true;
 
+				//the inputs edit a copy, so frames shared with other timelines only get copied when something actually changes.
+				//The frames up to this one are still right, only the ones after it need computing again. That waits until the inputs
+				//are left alone for a moment, so typing a number doesn't start a recompute per keystroke. Refining is stopped right away though,
+				//or it could write over the edited frame in the meantime
+				if (massChanged || positionChanged || velocityChanged) {
+					CancelProgressive();
+					physics->computedData.Edit(physics->dataIndex)[i] = objects[i];
+					recomputeFrame = recomputeFrame >= 0 ? std::min(recomputeFrame, physics->dataIndex) : physics->dataIndex;
+					recomputeTime = std::chrono::steady_clock::now();
+				}
+
+				//frames still coming from a background run are in the units it started with. The finished ones are taken before converting,
+				//and the run carries on from the last of them in the new units
 				if (massUnitsChanged || positionUnitsChanged || velocityUnitsChanged) {
-					for (int j = 0; j < physics->computedData.size(); j++) {
-						if (massUnitsChanged) {
-							int newMassUnit = physics->computedData[physics->dataIndex][i].mass.unitIndex;
-							physics->computedData[j][i].mass.ConvertToUnits(newMassUnit);
-						}
-
-						if (positionUnitsChanged) {
-							int newPositionUnit = physics->computedData[physics->dataIndex][i].position.unitIndex;
-							physics->computedData[j][i].position.ConvertToUnits(newPositionUnit);
-						}
-
-						if (velocityUnitsChanged) {
-							int newVelocityUnit = physics->computedData[physics->dataIndex][i].velocity.unitIndex;
-							physics->computedData[j][i].velocity.ConvertToUnits(newVelocityUnit);
-						}
+					bool refining = progressiveThread.joinable();
+					if (refining) {
+						CancelProgressive();
+						MergeProgressiveChunks(physics);
 					}
+					physics->computedData.ConvertUnits(i, massUnitsChanged ? objects[i].mass.unitIndex : -1,
+						positionUnitsChanged ? objects[i].position.unitIndex : -1, velocityUnitsChanged ? objects[i].velocity.unitIndex : -1);
+
+					if (IsStreaming())
+						RecomputeFrom(physics, physics->computedData.size() - 1);
+					else if (refining)
+						RecomputeFrom(physics, physics->refinedFrames >= 0 ? physics->refinedFrames - 1 : physics->computedData.size() - 1);
 				}
 			}
 			ImGui::End();
@@ -649,4 +1534,738 @@ void UserInterface::CameraWindow(Camera * camera)
 
 	}		
 	ImGui::End();
-}
\ No newline at end of file
+}
+
+void UserInterface::EnsembleWindow(Physics * physics)
+{
+	if (ImGui::Begin("Ensemble", &ShowEnsembleWindow, WindowFlags))
+	{
+		static auto vector_getter = [](void* vec, int idx, const char** out_text)
+		{
+			auto& vector = *static_cast<std::vector<std::string>*>(vec);
+			if (idx < 0 || idx >= static_cast<int>(vector.size())) { return false; }
+			*out_text = vector.at(idx).c_str();
+			return true;
+		};
+
+		bool running = ensembleThread.joinable();
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Scenario       "); ImGui::SameLine();
+		ImGui::PushItemWidth(200);
+		int scenario = std::find(saveFiles.begin(), saveFiles.end(), ensembleScenario) - saveFiles.begin();
+		if (scenario == (int)saveFiles.size())
+			scenario = -1;
+		if (ImGui::Combo("##EnsembleScenario", &scenario, vector_getter, static_cast<void*>(&saveFiles), saveFiles.size()) && scenario >= 0)
+			ensembleScenario = saveFiles[scenario];
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Members        "); ImGui::SameLine();
+		if (ImGui::InputInt("##EnsembleMembers", &ensemble.memberCount))
+			ensemble.memberCount = std::max(ensemble.memberCount, 1);
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Mass Jitter    "); ImGui::SameLine();
+		ImGui::InputFloat("##MassJitter", &ensemble.massJitter, 0.001f);
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Velocity Jitter"); ImGui::SameLine();
+		ImGui::InputFloat("##VelocityJitter", &ensemble.velocityJitter, 0.0001f);
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Seed           "); ImGui::SameLine();
+		int seed = ensemble.seed;
+		if (ImGui::InputInt("##EnsembleSeed", &seed))
+			ensemble.seed = std::max(seed, 0);
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Memory (MB)    "); ImGui::SameLine();
+		if (ImGui::InputInt("##EnsembleMemory", &ensemble.memoryBudgetMB))
+			ensemble.memoryBudgetMB = std::max(ensemble.memoryBudgetMB, 1);
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Batched        "); ImGui::SameLine();
+		ImGui::Checkbox("##EnsembleBatched", &ensemble.batched);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Small systems run %d members at a time, one per SIMD lane", BATCH_LANES);
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Output         "); ImGui::SameLine();
+		ImGui::InputText("##EnsembleOutput", ensembleOutput, IM_ARRAYSIZE(ensembleOutput));
+		ImGui::PopItemWidth();
+
+		//timestep, total time and algorithm come from the Simulation Controls window
+		ImGui::TextWrapped("Uses the timestep, total time and algorithm from Simulation Controls. Summaries are written to ../ensembles/%s.csv", ensembleOutput);
+
+		if (running && ensemble.finished)
+		{
+			ensembleThread.join();
+			running = false;
+		}
+
+		if (!running)
+		{
+			if (!ensemble.error.empty())
+				ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", ensemble.error.c_str());
+			if (ImGui::Button("Run Ensemble", ImVec2(ImGui::GetWindowContentRegionWidth(), 30)) && scenario >= 0)
+			{
+				CreateDirectory("../ensembles", NULL);
+
+				std::string scenarioFile = "../saves/" + ensembleScenario;
+				std::string outputFile = "../ensembles/" + std::string(ensembleOutput) + ".csv";
+				int algorithm = physics->selectedAlgorithm;
+				float dt = physics->timestep.GetBaseValue();
+				int steps = round(physics->totalTime.GetBaseValue() / dt);
+
+				ensemble.cancel = false;
+				ensemble.finished = false;
+				ensembleThread = std::thread([this, scenarioFile, outputFile, algorithm, dt, steps]() {
+					ensemble.Run(scenarioFile, outputFile, algorithm, dt, steps);
+				});
+			}
+		}
+		else
+		{
+			char progressString[32];
+			sprintf_s(progressString, "%d/%d", ensemble.membersDone.load(), ensemble.memberCount);
+			ImGui::ProgressBar((float)ensemble.membersDone / ensemble.memberCount, ImVec2(0.f, 0.f), progressString);
+
+			if (ImGui::Button("Cancel##Ensemble"))
+				CancelEnsemble();
+		}
+	}
+	ImGui::End();
+}
+
+void UserInterface::CancelEnsemble()
+{
+	if (!ensembleThread.joinable())
+		return;
+
+	ensemble.cancel = true;
+	ensembleThread.join();
+}
+
+void UserInterface::StabilityWindow(Physics * physics)
+{
+	if (ImGui::Begin("Stability Map", &ShowStabilityWindow, WindowFlags))
+	{
+		std::vector<PhysObject> objects = physics->getCurrentObjects();
+		std::vector<std::string> names = {};
+		for (int i = 0; i < objects.size(); i++)
+			names.push_back(objects[i].name);
+		stabilityPrimary = clip(stabilityPrimary, 0, std::max(0, (int)objects.size() - 1));
+
+		static auto vector_getter = [](void* vec, int idx, const char** out_text)
+		{
+			auto& vector = *static_cast<std::vector<std::string>*>(vec);
+			if (idx < 0 || idx >= static_cast<int>(vector.size())) { return false; }
+			*out_text = vector.at(idx).c_str();
+			return true;
+		};
+
+		bool running = stabilityThread.joinable();
+
+		ImGui::PushItemWidth(100);
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Primary         "); ImGui::SameLine();
+		ImGui::Combo("##StabilityPrimary", &stabilityPrimary, vector_getter, static_cast<void*>(&names), names.size());
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Cells           "); ImGui::SameLine();
+		if (ImGui::InputInt("##StabilityWidth", &stabilityMap.width))
+			stabilityMap.width = clip(stabilityMap.width, 1, 1024);
+		ImGui::SameLine();
+		if (ImGui::InputInt("##StabilityHeight", &stabilityMap.height))
+			stabilityMap.height = clip(stabilityMap.height, 1, 1024);
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Semimajor Axis  "); ImGui::SameLine();
+		ImGui::InputFloat("##MinSemimajorAxis", &stabilityMap.minSemimajorAxis.value, 0.1f); ImGui::SameLine();
+		UnitCombo<UnitType::Distance>("##MinSemimajorAxisUnits", &stabilityMap.minSemimajorAxis);
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("             to "); ImGui::SameLine();
+		ImGui::InputFloat("##MaxSemimajorAxis", &stabilityMap.maxSemimajorAxis.value, 0.1f); ImGui::SameLine();
+		UnitCombo<UnitType::Distance>("##MaxSemimajorAxisUnits", &stabilityMap.maxSemimajorAxis);
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Eccentricity    "); ImGui::SameLine();
+		if (ImGui::InputFloat("##MinEccentricity", &stabilityMap.minEccentricity, 0.01f))
+			stabilityMap.minEccentricity = clip(stabilityMap.minEccentricity, 0.0f, 0.99f);
+		ImGui::SameLine();
+		if (ImGui::InputFloat("##MaxEccentricity", &stabilityMap.maxEccentricity, 0.01f))
+			stabilityMap.maxEccentricity = clip(stabilityMap.maxEccentricity, 0.0f, 0.99f);
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Inclination (deg)"); ImGui::SameLine();
+		ImGui::InputFloat("##StabilityInclination", &stabilityMap.inclination.value, 1.0f);
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Mean Anomaly (deg)"); ImGui::SameLine();
+		ImGui::InputFloat("##StabilityMeanAnomaly", &stabilityMap.meanAnomaly.value, 1.0f);
+		ImGui::PopItemWidth();
+
+		ImGui::TextWrapped("Each cell is integrated over the total time with the timestep from Simulation Controls.");
+
+		if (running && stabilityMap.finished)
+		{
+			stabilityThread.join();
+			running = false;
+			UpdateStabilityTexture();
+		}
+
+		if (!running)
+		{
+			if (ImGui::Button("Compute Map", ImVec2(ImGui::GetWindowContentRegionWidth(), 30)) && !objects.empty())
+			{
+				Physics::ConvertObjectsToBaseUnits(&objects);
+				int primary = stabilityPrimary;
+				float dt = physics->timestep.GetBaseValue();
+				int steps = round(physics->totalTime.GetBaseValue() / dt);
+
+				stabilityColumns = stabilityMap.width;
+				stabilityRows = stabilityMap.height;
+				stabilityMap.cancel = false;
+				stabilityMap.finished = false;
+				stabilityThread = std::thread([this, physics, objects, primary, dt, steps]() {
+					stabilityMap.Run(physics, objects, primary, dt, steps);
+				});
+			}
+		}
+		else
+		{
+			int cellCount = stabilityColumns * stabilityRows;
+			char progressString[32];
+			sprintf_s(progressString, "%d/%d", stabilityMap.cellsDone.load(), cellCount);
+			ImGui::ProgressBar((float)stabilityMap.cellsDone / cellCount, ImVec2(0.f, 0.f), progressString);
+
+			if (ImGui::Button("Cancel##StabilityMap"))
+				CancelStabilityMap();
+		}
+
+		//the cells only match the settings until the size is changed
+		if (stabilityTexture != 0 && !running && stabilityMap.cells.size() == stabilityMap.width * stabilityMap.height)
+		{
+			//eccentricity increases upwards, semimajor axis to the right
+			float mapWidth = ImGui::GetWindowContentRegionWidth();
+			ImVec2 mapStart = ImGui::GetCursorScreenPos();
+			ImGui::Image((void*)(intptr_t)stabilityTexture, ImVec2(mapWidth, mapWidth), ImVec2(0, 1), ImVec2(1, 0));
+
+			if (ImGui::IsItemHovered())
+			{
+				ImVec2 mouse = ImGui::GetMousePos();
+				int column = clip((int)((mouse.x - mapStart.x) / mapWidth * stabilityMap.width), 0, stabilityMap.width - 1);
+				int row = clip((int)((1.0f - (mouse.y - mapStart.y) / mapWidth) * stabilityMap.height), 0, stabilityMap.height - 1);
+				StabilityCell cell = stabilityMap.cells[row * stabilityMap.width + column];
+
+				float minA = stabilityMap.minSemimajorAxis.GetBaseValue() / stabilityMap.maxSemimajorAxis.unitData.positionConversions[stabilityMap.maxSemimajorAxis.unitIndex];
+				float maxA = stabilityMap.maxSemimajorAxis.value;
+				float semimajorAxis = minA + (maxA - minA) * (column + 0.5f) / stabilityMap.width;
+				float eccentricity = stabilityMap.minEccentricity + (stabilityMap.maxEccentricity - stabilityMap.minEccentricity) * (row + 0.5f) / stabilityMap.height;
+
+				ImGui::BeginTooltip();
+				ImGui::Text("a = %.3f %s, e = %.3f", semimajorAxis, stabilityMap.maxSemimajorAxis.unitData.positionUnits[stabilityMap.maxSemimajorAxis.unitIndex], eccentricity);
+				ImGui::Text("MEGNO %.2f, lyapunov exponent %.3g / year%s", cell.megno, cell.lyapunov, cell.escaped ? " (escaped)" : "");
+				ImGui::EndTooltip();
+			}
+
+			ImGui::Text("Blue: regular (MEGNO 2)   Red: chaotic (MEGNO 8+)   Black: escaped or collided");
+		}
+	}
+	ImGui::End();
+}
+
+//colors each cell by its MEGNO value, and uploads the map as a texture for ImGui::Image
+void UserInterface::UpdateStabilityTexture()
+{
+	if (stabilityMap.cells.size() != stabilityColumns * stabilityRows || stabilityMap.cells.empty())
+		return;
+
+	std::vector<unsigned char> pixels = {};
+	for (int i = 0; i < stabilityMap.cells.size(); i++) {
+		const StabilityCell& cell = stabilityMap.cells[i];
+		float chaos = clip((cell.megno - 2.0f) / 6.0f, 0.0f, 1.0f);
+		if (cell.escaped)
+			pixels.insert(pixels.end(), { 0, 0, 0, 255 });
+		else
+			pixels.insert(pixels.end(), { (unsigned char)(255 * chaos), (unsigned char)(64 * (1.0f - chaos)), (unsigned char)(255 * (1.0f - chaos)), 255 });
+	}
+
+	if (stabilityTexture == 0)
+		glGenTextures(1, &stabilityTexture);
+
+	GLint lastTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &lastTexture);
+	glBindTexture(GL_TEXTURE_2D, stabilityTexture);
+	//no filtering, so every cell stays a sharp square
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, stabilityColumns, stabilityRows, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glBindTexture(GL_TEXTURE_2D, lastTexture);
+}
+
+void UserInterface::CancelStabilityMap()
+{
+	if (!stabilityThread.joinable())
+		return;
+
+	stabilityMap.cancel = true;
+	stabilityThread.join();
+}
+
+void UserInterface::AutotuneControls(Physics * physics)
+{
+	ImGui::AlignFirstTextHeightToWidgets();
+	ImGui::Text("Max Error "); ImGui::SameLine();
+	ImGui::PushItemWidth(200);
+	if (ImGui::InputFloat("##TargetError", &autotuner.targetError, 0.0f, 0.0f, 8))
+		autotuner.targetError = std::max(autotuner.targetError, 0.0f);
+	ImGui::PopItemWidth();
+	ImGui::SameLine();
+
+	if (autotuneThread.joinable() && autotuner.finished)
+	{
+		autotuneThread.join();
+
+		//switch to the winner, keeping whatever units the timestep was shown in
+		if (!autotuner.candidates.empty())
+		{
+			int units = physics->timestep.unitIndex;
+			physics->selectedAlgorithm = autotuner.best.algorithm;
+			physics->timestep.value = autotuner.best.timestep;
+			physics->timestep.unitIndex = 0;
+			physics->timestep.ConvertToUnits(units);
+		}
+	}
+
+	if (!autotuneThread.joinable())
+	{
+		if (ImGui::Button("Autotune", ImVec2(80, 0)))
+		{
+			std::vector<PhysObject> objects = physics->getCurrentObjects();
+			float timestep = physics->timestep.GetBaseValue();
+			float totalTime = physics->totalTime.GetBaseValue();
+
+			autotuner.cancel = false;
+			autotuner.finished = false;
+			autotuneThread = std::thread([this, physics, objects, timestep, totalTime]() {
+				autotuner.Run(physics, objects, timestep, totalTime);
+			});
+		}
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Runs short pilot integrations to find the cheapest algorithm and timestep that keep\nenergy and angular momentum within the max relative error over the total time");
+
+		if (!autotuner.candidates.empty())
+		{
+			ImGui::Text("%s%s, %.3g years: error %.2g, about %.2g s", autotuner.found ? "" : "Target not reached. Best: ",
+				physics->algorithms[autotuner.best.algorithm], autotuner.best.timestep, autotuner.best.predictedError, autotuner.best.predictedSeconds);
+
+			if (ImGui::TreeNode("Pilot Runs"))
+			{
+				for (int i = 0; i < autotuner.candidates.size(); i++)
+				{
+					const AutotuneCandidate& candidate = autotuner.candidates[i];
+					ImGui::Text("%-28s %10.3g years  energy %.2g  ang. mom. %.2g  predicted %.2g  %.2g s", physics->algorithms[candidate.algorithm],
+						candidate.timestep, candidate.energyError, candidate.angularMomentumError, candidate.predictedError, candidate.predictedSeconds);
+				}
+				ImGui::TreePop();
+			}
+		}
+	}
+	else
+	{
+		char progressString[32];
+		sprintf_s(progressString, "%d/%d", autotuner.candidatesDone.load(), autotuner.candidateCount.load());
+		ImGui::ProgressBar((float)autotuner.candidatesDone / std::max(autotuner.candidateCount.load(), 1), ImVec2(120, 0), progressString);
+		ImGui::SameLine();
+		if (ImGui::Button("Cancel##Autotune"))
+			CancelAutotune();
+	}
+}
+
+void UserInterface::CancelAutotune()
+{
+	if (!autotuneThread.joinable())
+		return;
+
+	autotuner.cancel = true;
+	autotuneThread.join();
+	autotuner.candidates = {};
+}
+
+void UserInterface::ComparisonWindow(Physics * physics)
+{
+	if (ImGui::Begin("Compare Integrators", &ShowComparisonWindow, WindowFlags))
+	{
+		bool running = comparisonThread.joinable();
+		if (running && comparison.finished)
+		{
+			comparisonThread.join();
+			running = false;
+		}
+
+		//start with the current settings against a 4x bigger timestep
+		if (comparison.configs.empty())
+		{
+			ComparisonConfig reference, fast;
+			reference.algorithm = fast.algorithm = physics->selectedAlgorithm;
+			reference.timestep = fast.timestep = physics->timestep;
+			fast.timestep.value *= 4.0f;
+			comparison.configs = { reference, fast };
+		}
+
+		//settings can't change while the runs are using them
+		int removed = -1;
+		for (int c = 0; c < comparison.configs.size(); c++)
+		{
+			ImGui::PushID(c);
+			ImGui::AlignFirstTextHeightToWidgets();
+			ImGui::Text(c == 0 ? "Reference" : "Config %d ", c); ImGui::SameLine();
+			ImGui::PushItemWidth(200);
+			if (running)
+				ImGui::Text("%-28s %g %s", physics->algorithms[comparison.configs[c].algorithm], comparison.configs[c].timestep.value,
+					comparison.configs[c].timestep.unitData.timeUnits[comparison.configs[c].timestep.unitIndex]);
+			else
+			{
+				ImGui::Combo("##Algorithm", &comparison.configs[c].algorithm, physics->algorithms, IM_ARRAYSIZE(physics->algorithms)); ImGui::SameLine();
+				ImGui::PushItemWidth(100);
+				ImGui::InputFloat("##Timestep", &comparison.configs[c].timestep.value, 0.001f); ImGui::SameLine();
+				ImGui::PushItemWidth(80);
+				UnitCombo<UnitType::Time>("##TimestepUnits", &comparison.configs[c].timestep);
+				ImGui::PopItemWidth();
+				ImGui::PopItemWidth();
+				if (comparison.configs.size() > 2)
+				{
+					ImGui::SameLine();
+					if (ImGui::Button("Remove"))
+						removed = c;
+				}
+			}
+			ImGui::PopItemWidth();
+			ImGui::PopID();
+		}
+		if (removed != -1)
+			comparison.configs.erase(comparison.configs.begin() + removed);
+
+		if (!running)
+		{
+			if (ImGui::Button("Add Config"))
+				comparison.configs.push_back(comparison.configs.back());
+			ImGui::SameLine();
+			ImGui::PushItemWidth(100);
+			if (ImGui::InputInt("Frames", &comparison.frameCount))
+				comparison.frameCount = clip(comparison.frameCount, 1, 10000);
+			ImGui::PopItemWidth();
+
+			if (ImGui::Button("Run Comparison", ImVec2(ImGui::GetWindowContentRegionWidth(), 30)))
+			{
+				std::vector<PhysObject> objects = physics->getCurrentObjects();
+				float totalTime = physics->totalTime.GetBaseValue();
+
+				comparison.cancel = false;
+				comparison.started = false;
+				comparison.finished = false;
+				comparisonThread = std::thread([this, physics, objects, totalTime]() {
+					comparison.Run(physics, objects, totalTime);
+				});
+				running = true;
+			}
+		}
+		else if (ImGui::Button("Cancel##Comparison"))
+		{
+			CancelComparison();
+			running = false;
+		}
+
+		ImGui::TextWrapped("Each config runs over the total time on its own thread, starting from the current frame.");
+
+		if (comparison.started && comparison.series.size() == comparison.configs.size())
+		{
+			comparison.UpdateDivergences();
+
+			//log10 of every finished frame of one metric, on a scale shared by all configs so the plots can be compared by eye
+			auto plotMetric = [&](const char* title, int metric, bool skipReference)
+			{
+				std::vector<std::vector<float>> values(comparison.series.size());
+				float lowest = INFINITY, highest = -INFINITY;
+				for (int c = skipReference ? 1 : 0; c < comparison.series.size(); c++)
+				{
+					const ComparisonSeries& series = comparison.series[c];
+					int done = metric == 0 ? series.divergencesDone : comparison.framesDone[c].load();
+					for (int frame = 1; frame < done; frame++)
+					{
+						float value = metric == 0 ? series.divergences[frame] : (metric == 1 ? series.energyErrors[frame] : series.seconds[frame]);
+						values[c].push_back(log10f(std::max(value, 1e-12f)));
+						lowest = std::min(lowest, values[c].back());
+						highest = std::max(highest, values[c].back());
+					}
+				}
+
+				ImGui::Text("%s (log10)", title);
+				for (int c = skipReference ? 1 : 0; c < comparison.series.size(); c++)
+				{
+					char label[64];
+					sprintf_s(label, "%s##%s%d", c == 0 ? "Reference" : ("Config " + std::to_string(c)).c_str(), title, c);
+					std::string overlay = values[c].empty() ? "" : std::to_string(values[c].back()).substr(0, 6);
+					ImGui::PlotLines(label, values[c].data(), values[c].size(), 0, overlay.c_str(), lowest, highest, ImVec2(ImGui::GetWindowContentRegionWidth() - 100, 40));
+				}
+			};
+
+			if (comparison.configs.size() > 1)
+				plotMetric("Max divergence from reference (Gm)", 0, true);
+			plotMetric("Relative energy error", 1, false);
+			plotMetric("Wall clock time (s)", 2, false);
+		}
+	}
+	ImGui::End();
+}
+
+void UserInterface::CancelComparison()
+{
+	if (!comparisonThread.joinable())
+		return;
+
+	comparison.cancel = true;
+	comparisonThread.join();
+}
+
+void UserInterface::CancelSave()
+{
+	if (!saveThread.joinable())
+		return;
+
+	saver.cancel = true;
+	saveThread.join();
+}
+
+void UserInterface::EventsWindow(Physics * physics)
+{
+	if (ImGui::Begin("Events", &ShowEventsWindow, WindowFlags))
+	{
+		static auto vector_getter = [](void* vec, int idx, const char** out_text)
+		{
+			auto& vector = *static_cast<std::vector<std::string>*>(vec);
+			if (idx < 0 || idx >= static_cast<int>(vector.size())) { return false; }
+			*out_text = vector.at(idx).c_str();
+			return true;
+		};
+
+		//GetObjectNames starts with "None", which the event functions don't have
+		Events* events = &physics->events;
+		std::vector<std::string> names = physics->GetObjectNames();
+		names.erase(names.begin());
+
+		//changing a function forgets what it found. Rescan looks through the frames again
+		for (int f = 0; f < events->functions.size(); f++)
+		{
+			EventFunction* function = &events->functions[f];
+			bool changed = false;
+			ImGui::PushID(f);
+
+			ImGui::PushItemWidth(120);
+			changed |= ImGui::Combo("##EventType", &function->type, events->types, IM_ARRAYSIZE(events->types));
+			ImGui::SameLine();
+			changed |= ImGui::Combo("##EventObject", &function->object, vector_getter, static_cast<void*>(&names), names.size());
+			ImGui::SameLine();
+			ImGui::Text(function->type == EVENT_ECLIPSE ? "by" : "and"); ImGui::SameLine();
+			changed |= ImGui::Combo("##EventOther", &function->other, vector_getter, static_cast<void*>(&names), names.size());
+			if (function->type == EVENT_ECLIPSE)
+			{
+				ImGui::SameLine();
+				ImGui::Text("of"); ImGui::SameLine();
+				changed |= ImGui::Combo("##EventSource", &function->source, vector_getter, static_cast<void*>(&names), names.size());
+			}
+			else if (function->type == EVENT_WITHIN_DISTANCE)
+			{
+				ImGui::SameLine();
+				changed |= ImGui::InputFloat("Gm##EventThreshold", &function->threshold, 0.0f, 0.0f, 3);
+			}
+			ImGui::PopItemWidth();
+
+			ImGui::SameLine();
+			bool remove = ImGui::Button("Remove");
+			ImGui::PopID();
+
+			if (remove)
+			{
+				events->RemoveFunction(f);
+				break;
+			}
+			if (changed)
+				events->ClearFunction(f);
+		}
+
+		if (ImGui::Button("Add Event", ImVec2(97, 0)))
+			events->functions.push_back(EventFunction());
+		ImGui::SameLine();
+		if (ImGui::Button("Rescan", ImVec2(97, 0)))
+		{
+			//preview frames are left for the refined chunks to scan as they come in
+			int last = physics->refinedFrames >= 0 ? physics->refinedFrames - 1 : physics->computedData.size() - 1;
+			events->log = {};
+			events->ScanFrames(physics->computedData, 1, last);
+		}
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Looks for events in all the frames computed so far");
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Output"); ImGui::SameLine();
+		ImGui::PushItemWidth(200);
+		ImGui::InputText("##EventsOutput", eventsOutput, IM_ARRAYSIZE(eventsOutput));
+		ImGui::PopItemWidth();
+		ImGui::SameLine();
+		if (ImGui::Button("Save Log", ImVec2(97, 0)))
+		{
+			CreateDirectory("../events", NULL);
+			events->WriteLog("../events/" + std::string(eventsOutput) + ".csv", names);
+		}
+
+		ImGui::Separator();
+		ImGui::Text("%d events", (int)events->log.size());
+
+		//clicking an event jumps to the frame it happened in
+		ImGui::BeginChild("##EventLog", ImVec2(0, 0), true);
+		ImGuiListClipper clipper(events->log.size());
+		while (clipper.Step())
+		{
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+			{
+				const EventRecord& event = events->log[i];
+				char label[256];
+				sprintf_s(label, "%12.6f y  %s##Event%d", event.time, events->Describe(event, names).c_str(), i);
+				if (ImGui::Selectable(label))
+					physics->dataIndex = physics->computedData.FindFrame(event.time);
+			}
+		}
+		clipper.End();
+		ImGui::EndChild();
+	}
+	ImGui::End();
+}
+
+//marks the logged events on the playback slider just drawn. Several events on the same pixel are drawn once
+void UserInterface::EventMarkers(Physics * physics)
+{
+	const std::vector<EventRecord>& log = physics->events.log;
+	int lastFrame = physics->computedData.size() - 1;
+	if (log.empty() || lastFrame < 1)
+		return;
+
+	//lines up with the middle of the slider's grab, which is wider when there are only a few frames
+	ImVec2 min = ImGui::GetItemRectMin();
+	ImVec2 max = ImGui::GetItemRectMax();
+	float width = max.x - min.x - 4.0f;
+	float grab = std::min(std::max(width / (lastFrame + 1), ImGui::GetStyle().GrabMinSize), width);
+	float left = min.x + 2.0f + grab / 2.0f;
+	float span = width - grab;
+
+	double firstTime = physics->computedData.GetTime(0);
+	double lastTime = physics->computedData.GetTime(lastFrame);
+	ImU32 color = ImGui::GetColorU32(ImVec4(1.0f, 0.6f, 0.1f, 1.0f));
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+	int lastX = INT_MIN;
+	for (int i = 0; i < log.size(); i++)
+	{
+		if (log[i].time < firstTime || log[i].time > lastTime)
+			continue;
+
+		int x = (int)(left + span * physics->computedData.FindFrame(log[i].time) / lastFrame);
+		if (x == lastX)
+			continue;
+		lastX = x;
+		drawList->AddLine(ImVec2((float)x, min.y), ImVec2((float)x, min.y + 4.0f), color);
+		drawList->AddLine(ImVec2((float)x, max.y - 4.0f), ImVec2((float)x, max.y), color);
+	}
+}
+
+void UserInterface::ProximityWindow(Physics * physics)
+{
+	if (ImGui::Begin("Close Approaches", &ShowProximityWindow, WindowFlags))
+	{
+		static auto vector_getter = [](void* vec, int idx, const char** out_text)
+		{
+			auto& vector = *static_cast<std::vector<std::string>*>(vec);
+			if (idx < 0 || idx >= static_cast<int>(vector.size())) { return false; }
+			*out_text = vector.at(idx).c_str();
+			return true;
+		};
+
+		std::vector<std::string> names = physics->GetObjectNames();
+		names.erase(names.begin());
+
+		ImGui::PushItemWidth(200);
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Object     "); ImGui::SameLine();
+		ImGui::Combo("##ProximityA", &proximityA, vector_getter, static_cast<void*>(&names), names.size());
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("And        "); ImGui::SameLine();
+		ImGui::Combo("##ProximityB", &proximityB, vector_getter, static_cast<void*>(&names), names.size());
+
+		ImGui::AlignFirstTextHeightToWidgets();
+		ImGui::Text("Radius (Gm)"); ImGui::SameLine();
+		if (ImGui::InputFloat("##ProximityRadius", &proximityRadius, 0.0f, 0.0f, 3))
+			proximityRadius = std::max(proximityRadius, 0.0f);
+		ImGui::PopItemWidth();
+
+		int query = -1;
+		if (ImGui::Button("Closest Approach", ImVec2(130, 0)))
+			query = 0;
+		ImGui::SameLine();
+		if (ImGui::Button("First Within", ImVec2(130, 0)))
+			query = 1;
+		ImGui::SameLine();
+		if (ImGui::Button("All Pairs Within", ImVec2(130, 0)))
+			query = 2;
+
+		if (query != -1)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			if (query == 0)
+				proximityResults = { physics->proximity.MinimumDistance(physics->computedData, proximityA, proximityB) };
+			else if (query == 1)
+				proximityResults = { physics->proximity.FirstWithin(physics->computedData, proximityA, proximityB, proximityRadius) };
+			else
+				proximityResults = physics->proximity.AllWithin(physics->computedData, proximityRadius);
+			proximityMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			proximityQuery = query;
+		}
+
+		ImGui::Text("%d frames indexed. Last query took %.3f ms", physics->proximity.IndexedFrames(), proximityMilliseconds);
+		ImGui::Separator();
+
+		//clicking a result jumps to it
+		ImGui::BeginChild("##ProximityResults", ImVec2(0, 0), true);
+		for (int i = 0; i < proximityResults.size(); i++)
+		{
+			const ProximityResult& result = proximityResults[i];
+			if (result.a < 0 || result.a >= names.size() || result.b < 0 || result.b >= names.size())
+				continue;
+
+			std::string pair = names[result.a] + " and " + names[result.b];
+			char label[256];
+			double time = result.time;
+			if (proximityQuery == 1 && result.within)
+			{
+				sprintf_s(label, "%s: first within %.3f Gm at %.6f y##Proximity%d", pair.c_str(), proximityRadius, result.firstTime, i);
+				time = result.firstTime;
+			}
+			else if (proximityQuery == 1)
+				sprintf_s(label, "%s: never within %.3f Gm##Proximity%d", pair.c_str(), proximityRadius, i);
+			else if (proximityQuery == 2)
+				sprintf_s(label, "%s: first within at %.6f y, closest %.6f Gm at %.6f y##Proximity%d", pair.c_str(), result.firstTime, result.distance, result.time, i);
+			else if (result.distance == INFINITY)
+				sprintf_s(label, "%s: no frames indexed##Proximity%d", pair.c_str(), i);
+			else
+				sprintf_s(label, "%s: closest %.6f Gm at %.6f y##Proximity%d", pair.c_str(), result.distance, result.time, i);
+
+			if (ImGui::Selectable(label) && (result.within || (proximityQuery == 0 && result.distance != INFINITY)))
+				physics->dataIndex = physics->computedData.FindFrame(time);
+		}
+		ImGui::EndChild();
+	}
+	ImGui::End();
+}
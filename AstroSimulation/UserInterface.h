@@ -4,14 +4,51 @@
 #include "ImguiUtil.h"
 #include "Physics.h"
 #include "Graphics.h"
+#include "Parareal.h"
+#include "Bidirectional.h"
+#include "Ensemble.h"
+#include "StabilityMap.h"
+#include "Secular.h"
+#include "Autotuner.h"
+#include "Comparison.h"
+#include "Streaming.h"
+#include "Progressive.h"
+#include "Snapshot.h"
+#include "Saver.h"
+#include "SaveCatalog.h"
 
+#include <chrono>
+#include <climits>
 #include <list>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#define COMPUTE_SERIAL 0
+#define COMPUTE_PARAREAL 1
+#define COMPUTE_BIDIRECTIONAL 2
+#define COMPUTE_SECULAR 3
+#define COMPUTE_STREAMING 4
+#define COMPUTE_PROGRESSIVE 5
+
+//how long the object data inputs have to be left alone before an edit is computed from
+#define RECOMPUTE_DELAY_MS 300
 
 class UserInterface
 {
 public:
 	UserInterface() {};
-	~UserInterface() {};
+	~UserInterface()
+	{
+		CancelBackgroundCompute();
+		CancelStreaming();
+		CancelProgressive();
+		CancelEnsemble();
+		CancelStabilityMap();
+		CancelAutotune();
+		CancelComparison();
+		CancelSave();
+	};
 
 	void InitUserInterface(GLFWwindow * window);
 	void InitObjectDataWindows(std::vector<PhysObject> objects);
@@ -21,9 +58,24 @@ public:
 	std::vector<std::string> GetAllFoldersInFolder(std::string folderPath);
 
 	bool isPaused = true;
+	//while streaming, playback stops at the last frame instead of looping, and waits for more
+	bool IsStreaming() { return streamingThread.joinable(); }
+	//set when a serial computation stops itself because the energy error passed physics->conservationWarning
+	bool conservationPaused = false;
+	bool ignoreConservationWarning = false;
 
+	//files in ../saves, from saveCatalog. saveEntries has what the catalog found out about each one
+	SaveCatalog saveCatalog;
+	std::vector<SaveCatalog::Entry> saveEntries;
+	int saveEntriesVersion = -1;
 	std::vector<std::string> saveFiles;
 	std::vector<bool> selected;
+	void UpdateSaveFiles();
+	//.hist files in ../histories, listed under the saves. -1 = none selected
+	std::vector<std::string> historyFiles;
+	int selectedHistory = -1;
+	//why the last load failed. The Load popup stays open to show it
+	std::string loadError;
 	std::vector<std::string> textureFolders;
 	std::map<std::string, bool> ShowDataWindow;
 
@@ -44,6 +96,102 @@ private:
 	bool ShowLoadPopup = false;
 	bool ShowSavePopup = false;
 	bool ShowTopLeftOverlay = true;
+	bool ShowEnsembleWindow = false;
+	bool ShowStabilityWindow = false;
+	bool ShowComparisonWindow = false;
+	bool ShowEventsWindow = false;
+	bool ShowProximityWindow = false;
+
+	ValueWithUnits<UnitType::Time> goToTime = ValueWithUnits<UnitType::Time>(0.0f, 0);
+
+	ReductionBenchmark reductionBenchmark;
+	bool hasReductionBenchmark = false;
+
+	//everything except serial mode runs on its own thread, so the progress popup keeps drawing while it works.
+	//Streaming and progressive modes show their frames as they come in, without a popup
+	int computeMode = COMPUTE_PROGRESSIVE;
+	const char* computeModes[6] = { "Serial", "Parareal", "Bidirectional", "Secular", "Streaming", "Progressive" };
+	Parareal parareal;
+	//set once a parareal run has finished, so how it ended can be shown
+	bool pararealDone = false;
+	Bidirectional bidirectional;
+	Secular secular;
+	std::thread computeThread;
+	std::vector<std::vector<PhysObject>> backgroundFrames;
+	void CancelBackgroundCompute();
+
+	Streaming streaming;
+	std::thread streamingThread;
+	//frames dropped from the front of computedData since streaming started
+	long long streamingDropped = 0;
+	char streamingOutput[128] = "stream";
+	//the file being recorded, for reading the frames behind playback back from. Null when not recording
+	std::shared_ptr<HistoryFile> recordingReader;
+	bool checkpointUnreadable = false;
+	void BeginStreaming(Physics* physics, std::vector<PhysObject> objects, const Checkpoint::State* resumed);
+	void StartStreaming(Physics* physics, std::vector<PhysObject> objects, long long firstFrame, double startTime);
+	void UpdateStreaming(Physics* physics);
+	void CancelStreaming();
+
+	Progressive progressive;
+	std::thread progressiveThread;
+	//frame the current run started from, and the number of frames it ends with
+	int progressiveStart = 0;
+	int progressiveFrames = 0;
+	//preview frames from before an edit stay marked as a preview from this frame on, since the recompute starts after them
+	int progressiveRefinedLimit = INT_MAX;
+	void UpdateProgressive(Physics* physics);
+	void MergeProgressiveChunks(Physics* physics);
+	void CancelProgressive();
+	//computes the frames after frame again in the background, after frame was edited
+	void RecomputeFrom(Physics* physics, int frame);
+	//the earliest edited frame still waiting for RECOMPUTE_DELAY_MS to pass, or -1. Kept pointing at the same frame when streaming drops some
+	int recomputeFrame = -1;
+	std::chrono::steady_clock::time_point recomputeTime;
+	void UpdateRecompute(Physics* physics);
+
+	Ensemble ensemble;
+	std::thread ensembleThread;
+	//by name, since the list of saves can change under it
+	std::string ensembleScenario = "";
+	char ensembleOutput[128] = "ensemble";
+	void CancelEnsemble();
+
+	//the log is written to ../events/eventsOutput.csv
+	char eventsOutput[128] = "events";
+
+	int proximityA = 3;
+	int proximityB = 0;
+	float proximityRadius = 1.0f;
+	//which button the results came from
+	int proximityQuery = 0;
+	std::vector<ProximityResult> proximityResults;
+	double proximityMilliseconds = 0.0;
+
+	StabilityMap stabilityMap;
+	std::thread stabilityThread;
+	int stabilityPrimary = 0;
+	//size of the running or last map. The settings can be changed while it runs
+	int stabilityColumns = 0;
+	int stabilityRows = 0;
+	GLuint stabilityTexture = 0;
+	void CancelStabilityMap();
+	void UpdateStabilityTexture();
+
+	Saver saver;
+	std::thread saveThread;
+	//name of the file being saved, in ../saves
+	std::string savingFile;
+	void CancelSave();
+
+	Autotuner autotuner;
+	std::thread autotuneThread;
+	void AutotuneControls(Physics* physics);
+	void CancelAutotune();
+
+	Comparison comparison;
+	std::thread comparisonThread;
+	void CancelComparison();
 
 	void LoadPopup(Physics* physics);
 	void TopLeftOverlay(Physics* physics);
@@ -53,7 +201,15 @@ private:
 	void ObjectsTreeNode(std::string name, std::list<PhysObject> satelliteObjects, Graphics * graphics);
 	void ObjectDataWindows(Physics * physics);
 	void CameraWindow(Camera* camera);
+	void EnsembleWindow(Physics* physics);
+	void StabilityWindow(Physics* physics);
+	void ComparisonWindow(Physics* physics);
+	void EventsWindow(Physics* physics);
+	void EventMarkers(Physics* physics);
+	void ProximityWindow(Physics* physics);
 	void SimulationWindow(Physics* physics, Graphics * graphics);
+	void ComputeControls(Physics* physics, std::vector<PhysObject> objects);
+	void TimelineControls(Physics* physics);
 	void OriginDropdown(Physics * physics, Graphics * graphics);
 
 	void UpdateStyle();
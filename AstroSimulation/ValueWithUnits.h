@@ -127,11 +127,11 @@ public:
 	int unitIndex;
 	UnitData unitData;
 
+	//unitData is all const, so the default assignment operator doesn't exist. Only the value and units need copying anyway
 	ValueWithUnits& operator=(const ValueWithUnits& rhs) {
-		ValueWithUnits<type> lhs;
-		lhs.value = rhs.value;
-		lhs.unitIndex = rhs.unitIndex;
-		return lhs;
+		value = rhs.value;
+		unitIndex = rhs.unitIndex;
+		return *this;
 	};
 };
 
@@ -244,11 +244,10 @@ public:
 	UnitData unitData;
 
 	ValueWithUnits3& operator=(const ValueWithUnits3& rhs) {
-		ValueWithUnits3<type> lhs;
 		for(int i = 0; i < 3; i++)
-			lhs.value[i] = rhs.value[i];
-		lhs.unitIndex = rhs.unitIndex;
-		return lhs;
+			value[i] = rhs.value[i];
+		unitIndex = rhs.unitIndex;
+		return *this;
 	};
 };
 
@@ -0,0 +1,414 @@
+#include "XmlImport.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+//part of the file, which isn't null terminated
+struct Span
+{
+	const char* begin;
+	size_t length;
+	bool Is(const char* text) const { return std::strlen(text) == length && std::memcmp(begin, text, length) == 0; }
+};
+
+static bool StartsWith(const char* position, const char* end, const char* text)
+{
+	size_t length = std::strlen(text);
+	return end - position >= (ptrdiff_t)length && std::memcmp(position, text, length) == 0;
+}
+
+static const char* Find(const char* position, const char* end, const char* text)
+{
+	size_t length = std::strlen(text);
+	while (end - position >= (ptrdiff_t)length) {
+		position = (const char*)std::memchr(position, text[0], end - position - length + 1);
+		if (!position)
+			return nullptr;
+		if (std::memcmp(position, text, length) == 0)
+			return position;
+		position++;
+	}
+	return nullptr;
+}
+
+//skips whitespace and comments. Returns where anything else starts, or end
+static const char* SkipSpace(const char* position, const char* end)
+{
+	while (position < end) {
+		if (*position == ' ' || *position == '\t' || *position == '\r' || *position == '\n')
+			position++;
+		else if (StartsWith(position, end, "<!--")) {
+			const char* close = Find(position + 4, end, "-->");
+			if (!close)
+				return end;
+			position = close + 3;
+		}
+		else
+			return position;
+	}
+	return end;
+}
+
+//where ScanElements stopped
+struct ScanState
+{
+	//the elements still open, and how many
+	Span names[8];
+	int depth = 0;
+	//set by a start tag, and cleared by the next tag, so it's still set at the end tag of an element with only text
+	bool leaf = false;
+	//after the last start tag
+	const char* text = nullptr;
+};
+
+//calls found(names, text) for every element without child elements between begin and end, with the names of the elements
+//it is inside of (starting below the element begin is in), and its text. Returns false if the xml is cut off, or has CDATA,
+//which pugixml reads differently. state, if there is one, gets where it stopped
+template <typename Callback> static bool ScanElements(const char* begin, const char* end, Callback found, ScanState* state = nullptr)
+{
+	ScanState scan;
+	Span* names = scan.names;
+	int& depth = scan.depth;
+	bool& leaf = scan.leaf;
+	const char*& text = scan.text;
+	text = begin;
+
+	const char* position = begin;
+	while ((position = (const char*)std::memchr(position, '<', end - position))) {
+		const char* close;
+		if (StartsWith(position, end, "<!--")) {
+			close = Find(position + 4, end, "-->");
+			if (!close)
+				return false;
+			position = close + 3;
+			continue;
+		}
+		if (StartsWith(position, end, "<![CDATA["))
+			return false;
+		close = (const char*)std::memchr(position, '>', end - position);
+		if (!close)
+			return false;
+
+		if (position[1] == '?' || position[1] == '!') {
+			leaf = false;
+		}
+		else if (position[1] == '/') {
+			if (leaf && depth > 0 && depth <= 8)
+				found(names, depth, text, position);
+			depth = std::max(depth - 1, 0);
+			leaf = false;
+		}
+		else if (close[-1] != '/') {
+			const char* nameEnd = position + 1;
+			while (nameEnd < close && *nameEnd != ' ' && *nameEnd != '\t' && *nameEnd != '\r' && *nameEnd != '\n')
+				nameEnd++;
+			if (depth < 8)
+				names[depth] = { position + 1, (size_t)(nameEnd - position - 1) };
+			depth++;
+			leaf = true;
+			text = close + 1;
+		}
+		else
+			leaf = false;
+		position = close + 1;
+	}
+	if (state)
+		*state = scan;
+	return true;
+}
+
+//text the way pugixml gives it: entities replaced, and line endings made \n
+static std::string DecodeText(const char* begin, const char* end)
+{
+	std::string text = "";
+	text.reserve(end - begin);
+	for (const char* c = begin; c < end; c++) {
+		if (*c == '\r') {
+			text += '\n';
+			if (c + 1 < end && c[1] == '\n')
+				c++;
+		}
+		else if (*c == '&') {
+			const char* semicolon = (const char*)std::memchr(c, ';', std::min(end - c, (ptrdiff_t)12));
+			Span entity = { c + 1, semicolon ? (size_t)(semicolon - c - 1) : 0 };
+			if (!semicolon) {
+				text += *c;
+				continue;
+			}
+			if (entity.Is("lt"))
+				text += '<';
+			else if (entity.Is("gt"))
+				text += '>';
+			else if (entity.Is("amp"))
+				text += '&';
+			else if (entity.Is("quot"))
+				text += '"';
+			else if (entity.Is("apos"))
+				text += '\'';
+			else if (entity.length > 1 && entity.begin[0] == '#') {
+				long code = entity.begin[1] == 'x' ? std::strtol(entity.begin + 2, nullptr, 16) : std::strtol(entity.begin + 1, nullptr, 10);
+				//names only need ascii, anything else is kept as it is
+				if (code <= 0 || code > 127) {
+					text.append(c, semicolon + 1);
+					c = semicolon;
+					continue;
+				}
+				text += (char)code;
+			}
+			else {
+				text.append(c, semicolon + 1);
+				c = semicolon;
+				continue;
+			}
+			c = semicolon;
+		}
+		else
+			text += *c;
+	}
+	return text;
+}
+
+//the number parsing stops at the < of the end tag, so the text doesn't need copying
+static float ParseFloat(const char* text)
+{
+	return (float)std::strtod(text, nullptr);
+}
+
+static int ParseInt(const char* text)
+{
+	while (*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n')
+		text++;
+	bool negative = *text == '-';
+	const char* digits = negative || *text == '+' ? text + 1 : text;
+	bool hex = digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X');
+	long value = std::strtol(hex ? digits + 2 : digits, nullptr, hex ? 16 : 10);
+	return (int)(negative ? -value : value);
+}
+
+//one PhysObject element, from the end of its start tag to the start of its end tag
+static bool ParseObject(const char* begin, const char* end, const std::vector<std::string>& textureFolders, PhysObject* object, ObjectSettings* settings)
+{
+	std::string name = "", satellites = "", displayType = "", color = "", texture = "", historyPolicy = "";
+	float mass = 0.0f, rotationPeriod = 0.0f, axialTilt = 0.0f, radius = 0.0f;
+	float position[3] = { 0.0f, 0.0f, 0.0f }, velocity[3] = { 0.0f, 0.0f, 0.0f };
+	bool showHistory = false;
+	int historyFrames = -1;
+	float historyAngle = -1.0f;
+	bool hasHistoryFrames = false, hasHistoryAngle = false;
+
+	bool complete = ScanElements(begin, end, [&](const Span* names, int depth, const char* text, const char* textEnd) {
+		const Span& element = names[depth - 1];
+		if (depth == 1) {
+			if (element.Is("Name"))
+				name = DecodeText(text, textEnd);
+			else if (element.Is("Mass"))
+				mass = ParseFloat(text);
+			else if (element.Is("RotationPeriod"))
+				rotationPeriod = ParseFloat(text);
+			else if (element.Is("AxialTilt"))
+				axialTilt = ParseFloat(text);
+			else if (element.Is("Radius"))
+				radius = ParseFloat(text);
+			else if (element.Is("Satellites"))
+				satellites = DecodeText(text, textEnd);
+		}
+		else if (depth == 2 && names[0].Is("Position")) {
+			if (element.Is("x"))
+				position[0] = ParseFloat(text);
+			else if (element.Is("y"))
+				position[1] = ParseFloat(text);
+			else if (element.Is("z"))
+				position[2] = ParseFloat(text);
+		}
+		else if (depth == 2 && names[0].Is("Velocity")) {
+			if (element.Is("Vx"))
+				velocity[0] = ParseFloat(text);
+			else if (element.Is("Vy"))
+				velocity[1] = ParseFloat(text);
+			else if (element.Is("Vz"))
+				velocity[2] = ParseFloat(text);
+		}
+		else if (depth == 2 && names[0].Is("Settings")) {
+			if (element.Is("ShowHistory"))
+				showHistory = text < textEnd && (*text == '1' || *text == 't' || *text == 'T' || *text == 'y' || *text == 'Y');
+			else if (element.Is("DisplayType"))
+				displayType = DecodeText(text, textEnd);
+			else if (element.Is("Color"))
+				color = DecodeText(text, textEnd);
+			else if (element.Is("Texture"))
+				texture = DecodeText(text, textEnd);
+			else if (element.Is("HistoryPolicy"))
+				historyPolicy = DecodeText(text, textEnd);
+			else if (element.Is("HistoryFrames")) {
+				historyFrames = ParseInt(text);
+				hasHistoryFrames = true;
+			}
+			else if (element.Is("HistoryAngle")) {
+				historyAngle = ParseFloat(text);
+				hasHistoryAngle = true;
+			}
+		}
+	});
+	if (!complete)
+		return false;
+
+	//the same defaults as FromXml
+	if (radius <= 0)
+		radius = 1.0;
+	int textureIndex = -1;
+	if (texture != "") {
+		for (int i = 0; i < textureFolders.size(); i++) {
+			if (textureFolders[i] == texture) {
+				textureIndex = i;
+				break;
+			}
+		}
+	}
+
+	*object = PhysObject(name, mass, position, velocity, radius, rotationPeriod, axialTilt, Physics::SplitString(satellites, ","));
+	*settings = ObjectSettings(showHistory, displayType, color, textureIndex);
+	settings->texture = texture;
+	if (historyPolicy != "")
+		settings->SetHistoryPolicy(historyPolicy);
+	if (hasHistoryFrames)
+		settings->historyFrames = std::max(historyFrames, 1);
+	if (hasHistoryAngle)
+		settings->historyAngle = historyAngle;
+	return true;
+}
+
+bool XmlImport::Read(Physics* physics, std::string filename, std::vector<std::string> textureFolders)
+{
+	float time;
+	int objectCount;
+	std::vector<PhysObject> objects;
+	std::vector<ObjectSettings> objectSettings;
+	if (!Scan(filename, textureFolders, &time, &objectCount, &objects, &objectSettings))
+		return false;
+
+	Physics::LoadScenario(physics, time, std::move(objects), std::move(objectSettings));
+	return true;
+}
+
+bool XmlImport::Check(std::string filename, std::string* error, int* objectCount, float* time)
+{
+	if (Scan(filename, {}, time, objectCount, nullptr, nullptr))
+		return true;
+
+	pugi::xml_document doc;
+	pugi::xml_parse_result result = doc.load_file(filename.c_str());
+	if (!result) {
+		*error = result.description();
+		return false;
+	}
+	*objectCount = doc.select_nodes("/SavedState/Physics/Objects/PhysObject").size();
+	*time = doc.select_node("/SavedState/Physics/Time").node().text().as_float();
+	return true;
+}
+
+bool XmlImport::Scan(std::string filename, const std::vector<std::string>& textureFolders, float* time, int* objectCount,
+	std::vector<PhysObject>* objects, std::vector<ObjectSettings>* objectSettings)
+{
+	MappedFile file;
+	if (!file.Open(filename))
+		return false;
+	const char* data = file.Data();
+	const char* end = data + file.Size();
+	const char* tag = "<PhysObject";
+	size_t tagLength = std::strlen(tag);
+
+	//every region finds the objects whose start tag starts in it, skipping comments and CDATA. Put back in region order, that's the order of the file.
+	//a region can start inside a comment or CDATA, and not know it, so what it found before the end of an earlier region's one is dropped.
+	//Whatever a region gets wrong anyway shows up as something other than whitespace between the objects, and is checked below
+	int regionCount = (int)std::min((file.Size() + XML_IMPORT_REGION_BYTES - 1) / XML_IMPORT_REGION_BYTES, (uint64_t)INT_MAX);
+	std::vector<std::vector<const char*>> regionStarts(regionCount);
+	std::vector<const char*> regionCommentEnds(regionCount, data);
+	ThreadPool::Shared().ParallelFor(regionCount, [&](int region) {
+		const char* position = data + (uint64_t)region * XML_IMPORT_REGION_BYTES;
+		const char* regionEnd = std::min(position + XML_IMPORT_REGION_BYTES, end);
+		while (position < regionEnd && (position = (const char*)std::memchr(position, '<', regionEnd - position))) {
+			bool comment = StartsWith(position, end, "<!--");
+			if (comment || StartsWith(position, end, "<![CDATA[")) {
+				const char* close = comment ? Find(position + 4, end, "-->") : Find(position + 9, end, "]]>");
+				position = close ? close + 3 : end;
+				regionCommentEnds[region] = position;
+				continue;
+			}
+			char next = position + tagLength < end ? position[tagLength] : 0;
+			if (StartsWith(position, end, tag) && (next == '>' || next == '/' || next == ' ' || next == '\t' || next == '\r' || next == '\n'))
+				regionStarts[region].push_back(position);
+			position++;
+		}
+	});
+
+	std::vector<const char*> starts = {};
+	const char* commentEnd = data;
+	for (int i = 0; i < regionCount; i++) {
+		for (const char* start : regionStarts[i]) {
+			if (start >= commentEnd)
+				starts.push_back(start);
+		}
+		commentEnd = std::max(commentEnd, regionCommentEnds[i]);
+	}
+	regionStarts = {};
+	if (starts.empty())
+		return false;
+
+	//the time is the only thing needed from before the objects. The first object has to come right after <Objects>
+	*time = 0.0f;
+	ScanState before;
+	if (!ScanElements(data, starts[0], [&](const Span* names, int depth, const char* text, const char* /*textEnd*/) {
+		if (depth == 3 && names[0].Is("SavedState") && names[1].Is("Physics") && names[2].Is("Time"))
+			*time = ParseFloat(text);
+	}, &before))
+		return false;
+	if (before.depth != 3 || !before.names[0].Is("SavedState") || !before.names[1].Is("Physics") || !before.names[2].Is("Objects")
+		|| !before.leaf || SkipSpace(before.text, starts[0]) != starts[0])
+		return false;
+
+	if (objects) {
+		objects->assign(starts.size(), PhysObject());
+		objectSettings->assign(starts.size(), ObjectSettings(false, "", "", -1));
+	}
+	//just past the end tag of each object
+	std::vector<const char*> ends(starts.size());
+	std::atomic<bool> failed = { false };
+	int batchCount = (starts.size() + XML_IMPORT_BATCH_OBJECTS - 1) / XML_IMPORT_BATCH_OBJECTS;
+	ThreadPool::Shared().ParallelFor(batchCount, [&](int batch) {
+		int last = std::min((batch + 1) * XML_IMPORT_BATCH_OBJECTS, (int)starts.size());
+		for (int i = batch * XML_IMPORT_BATCH_OBJECTS; i < last && !failed; i++) {
+			const char* close = (const char*)std::memchr(starts[i], '>', end - starts[i]);
+			if (!close) {
+				failed = true;
+				return;
+			}
+			//<PhysObject/> has nothing in it, and gets the defaults
+			const char* objectEnd = close[-1] == '/' ? close + 1 : Find(close + 1, end, "</PhysObject>");
+			const char* contentEnd = close[-1] == '/' ? close + 1 : objectEnd;
+			bool parsed = objectEnd && (objects ? ParseObject(close + 1, contentEnd, textureFolders, &(*objects)[i], &(*objectSettings)[i])
+				: ScanElements(close + 1, contentEnd, [](const Span* /*names*/, int /*depth*/, const char* /*text*/, const char* /*textEnd*/) {}));
+			if (!parsed)
+				failed = true;
+			else
+				ends[i] = close[-1] == '/' ? objectEnd : objectEnd + std::strlen("</PhysObject>");
+		}
+	});
+	if (failed)
+		return false;
+
+	//only whitespace and comments between the objects, and </Objects> after them. Anything else, such as an object found
+	//inside another one or inside CDATA, or another element among them, means the objects weren't all siblings in Objects
+	for (int i = 0; i + 1 < starts.size(); i++) {
+		if (starts[i + 1] < ends[i] || SkipSpace(ends[i], starts[i + 1]) != starts[i + 1])
+			return false;
+	}
+	if (!StartsWith(SkipSpace(ends.back(), end), end, "</Objects>"))
+		return false;
+
+	*objectCount = starts.size();
+	return true;
+}
@@ -0,0 +1,37 @@
+#ifndef XMLIMPORT_H
+#define XMLIMPORT_H
+
+#pragma once
+#include "Physics.h"
+
+#include <string>
+#include <vector>
+
+//bytes of file per region the object search is split into
+#define XML_IMPORT_REGION_BYTES (4 << 20)
+//objects parsed per task
+#define XML_IMPORT_BATCH_OBJECTS 1024
+
+//Reads xml save files without building a document, for files too big to hold twice in memory. The file is mapped, and split into
+//regions that are searched for PhysObject elements in parallel. Then every object is parsed on its own, straight into its place in the
+//list of objects, also in parallel. Memory is the objects themselves and the pages of the file the OS has loaded.
+//It reads the values FromXml would (the same elements, parsed the same way). The objects have to be the only children of the
+//Objects element in SavedState/Physics, apart from comments, and nothing before or in them can be CDATA. Anything else fails,
+//and is left to the document. Files bigger than a few GB need a 64 bit build
+class XmlImport
+{
+public:
+	//false if the file couldn't be read, in which case physics is left alone
+	static bool Read(Physics* physics, std::string filename, std::vector<std::string> textureFolders);
+	//what loading the file would find, without keeping the objects. Files Read can't handle are checked with the document instead,
+	//as loading them would be. Sets error and returns false if neither can read it
+	static bool Check(std::string filename, std::string* error, int* objectCount, float* time);
+
+private:
+	//finds the objects, and makes sure they're all there and where they should be. They're parsed into objects and objectSettings,
+	//or only checked if those are null
+	static bool Scan(std::string filename, const std::vector<std::string>& textureFolders, float* time, int* objectCount,
+		std::vector<PhysObject>* objects, std::vector<ObjectSettings>* objectSettings);
+};
+
+#endif